@@ -0,0 +1,32 @@
+#version 110
+
+uniform sampler2D heightMap;
+uniform float seaLevel;
+uniform float radarPixelRadius;
+uniform float softEdge;
+uniform float sweepOpacity;
+
+varying vec2 heightMapCoordInterpol;
+varying vec2 sweepCoordInterpol;
+
+void main() {
+	// land above sea level, shaded by height, with the coastline blended
+	float height = texture2D(heightMap, heightMapCoordInterpol).r;
+	float terrainAlpha = smoothstep(seaLevel - max(fwidth(height), 1.0 / 255.0), seaLevel, height);
+
+	// shade which deepens around the sweep, fading out at the radar's rim
+	float angle = -degrees(atan(sweepCoordInterpol.y, sweepCoordInterpol.x));
+	if(angle < 0.0)
+		angle += 360.0;
+
+	float rimDistance = (1.0 - length(sweepCoordInterpol)) * radarPixelRadius;
+	float sweepAlpha = sweepOpacity * clamp(rimDistance / softEdge, 0.0, 1.0) * angle / 360.0;
+
+	// the sweep shade composited over the land
+	float alpha = terrainAlpha + sweepAlpha - terrainAlpha * sweepAlpha;
+
+	gl_FragColor = vec4(
+			vec3(height * terrainAlpha * (1.0 - sweepAlpha) / max(alpha, 0.0001)),
+			alpha
+		);
+}
@@ -0,0 +1,17 @@
+#version 110
+
+uniform mat4 mvpMatrix;
+uniform mat4 heightMapMatrix;
+uniform mat4 sweepMatrix;
+
+attribute vec2 position;
+
+varying vec2 heightMapCoordInterpol;
+varying vec2 sweepCoordInterpol;
+
+void main() {
+	gl_Position = mvpMatrix * vec4(position, 0.0, 1.0);
+
+	heightMapCoordInterpol = (heightMapMatrix * vec4(position, 0.0, 1.0)).xy;
+	sweepCoordInterpol = (sweepMatrix * vec4(position, 0.0, 1.0)).xy;
+}
@@ -0,0 +1,19 @@
+#version 110
+
+uniform vec4 insideColor;
+uniform vec4 outsideColor;
+uniform float softEdge;
+
+varying vec2 spotCoordInterpol;
+
+void main() {
+	gl_FragColor = mix(
+			insideColor,
+			outsideColor,
+			smoothstep(
+					1.0 - softEdge,
+					1.0,
+					length(spotCoordInterpol)
+				)
+		);
+}
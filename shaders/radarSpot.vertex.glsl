@@ -0,0 +1,12 @@
+#version 110
+
+attribute vec2 position;
+attribute vec2 spotCoord;
+
+varying vec2 spotCoordInterpol;
+
+void main() {
+	spotCoordInterpol = spotCoord;
+
+	gl_Position = vec4(position, 0.0, 1.0);
+}
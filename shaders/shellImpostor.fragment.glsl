@@ -0,0 +1,44 @@
+#version 110
+
+uniform mat4 pMatrix;
+uniform float radius;
+uniform vec3 ambientColor;
+uniform vec3 diffuseColor;
+uniform vec3 specularColor;
+uniform vec3 lightPosition;
+uniform float shininess;
+
+varying vec3 positionInterpol;
+varying vec3 centerInterpol;
+
+void main() {
+	// find where the ray from the eye through this point meets the sphere
+	vec3 position = normalize(positionInterpol);
+	float centerProjection = dot(position, centerInterpol);
+	float discriminant = centerProjection * centerProjection - dot(centerInterpol, centerInterpol) + radius * radius;
+
+	if(discriminant < 0.0)
+		discard;
+
+	vec3 surfacePosition = position * (centerProjection - sqrt(discriminant));
+
+	// light it as the sphere mesh is lit
+	vec4 calculatedColor = vec4(1.0);
+
+	vec3 normal = (surfacePosition - centerInterpol) / radius;
+	vec3 lightDirection = normalize(lightPosition);
+	vec3 reflection = reflect(lightDirection, normal);
+	vec3 diffuse = max(dot(normal, lightDirection), 0.0) * diffuseColor;
+
+	calculatedColor *= vec4(diffuse + ambientColor, 1.0);
+
+	vec3 specular = pow(max(dot(reflection, position), 0.0), shininess) * specularColor;
+	calculatedColor += vec4(specular, 1.0);
+
+	calculatedColor = min(calculatedColor, vec4(1.0));
+	gl_FragColor = calculatedColor;
+
+	// and at the depth of the sphere rather than the quad
+	vec4 clipPosition = pMatrix * vec4(surfacePosition, 1.0);
+	gl_FragDepth = clipPosition.z / clipPosition.w * 0.5 + 0.5;
+}
@@ -0,0 +1,30 @@
+#version 110
+
+uniform mat4 mvMatrix;
+uniform mat4 pMatrix;
+uniform float radius;
+
+attribute vec3 center;
+attribute vec2 corner;
+
+varying vec3 positionInterpol;
+varying vec3 centerInterpol;
+
+void main() {
+	vec4 eyeCenter = mvMatrix * vec4(center, 1.0);
+
+	// face the quad toward the eye and size it to the cone of rays which
+	// touch the sphere, so it covers the whole silhouette
+	vec3 forward = normalize(eyeCenter.xyz);
+	vec3 right = normalize(abs(forward.y) < 0.99 ? cross(vec3(0.0, 1.0, 0.0), forward) : cross(vec3(1.0, 0.0, 0.0), forward));
+	vec3 up = cross(forward, right);
+
+	float centerDistance = length(eyeCenter.xyz);
+	float extent = radius * centerDistance / sqrt(max(centerDistance * centerDistance - radius * radius, 0.0001));
+
+	vec3 eyePosition = eyeCenter.xyz + (right * corner.x + up * corner.y) * extent;
+	gl_Position = pMatrix * vec4(eyePosition, 1.0);
+
+	positionInterpol = eyePosition;
+	centerInterpol = eyeCenter.xyz;
+}
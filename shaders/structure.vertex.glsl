@@ -0,0 +1,33 @@
+#version 110
+
+uniform mat4 mvMatrices[3];
+uniform mat4 pMatrix;
+
+attribute vec3 position;
+attribute vec3 normal;
+attribute vec2 texCoord;
+attribute vec4 color;
+attribute float layer;
+attribute float part;
+
+varying vec3 positionInterpol;
+varying vec3 normalInterpol;
+varying vec2 texCoordInterpol;
+varying vec4 colorInterpol;
+varying float layerInterpol;
+
+void main() {
+	mat4 mvMatrix = mvMatrices[int(part + 0.5)];
+
+	vec4 eyePosition = mvMatrix * vec4(position, 1.0);
+	gl_Position = pMatrix * eyePosition;
+
+	positionInterpol = eyePosition.xyz;
+	normalInterpol = (mvMatrix * vec4(normal, 0.0)).xyz;
+
+	texCoordInterpol = texCoord;
+
+	colorInterpol = color;
+
+	layerInterpol = layer;
+}
@@ -7,98 +7,324 @@
 #include <cstring>
 #include <sstream>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "audio/MusicStream.h"
+#include "core/Atomic.h"
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
 #include "platform/Platform.h"
 
-extern GameAudio* gameAudio;
 extern GameSystem* gameSystem;
+extern JobSystem* jobSystem;
 extern Platform* platform;
 
-void mixAudio(void* userData, uint8_t* stream, int length) {
-	// play the background music
-	if(gameAudio->musicPlaying.sound == NULL)
-		return;
+class GameAudio::SoundJob : public Job {
+	GameAudio* audio;
+	std::string file;
+	SDL_AudioSpec deviceSpec;
+	GameSound sound;
+
+public:
+	SoundJob(GameAudio* audio, std::string file) : Job("sound decode"), audio(audio), file(file), deviceSpec(audio->deviceSpec) {
+		sound.samples = NULL;
+	}
+	~SoundJob() { free(sound.samples); }
+
+	void run() { sound = decodeSound(file, deviceSpec); }
+
+	void finish() {
+		audio->soundJobs.erase(file);
+		audio->sounds[file] = sound;
+		sound.samples = NULL;
+	}
+};
+
+// add interleaved stereo samples into the bus with separate channel gains
+static void mixSamples(float* bus, const int16_t* samples, size_t count, float leftGain, float rightGain) {
+	size_t i = 0;
+
+#ifdef __SSE2__
+	__m128 gains = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
 
-	if(gameAudio->musicPlaying.position == gameAudio->musicPlaying.sound->length)
-		gameAudio->musicPlaying.position = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m128i packed = _mm_loadu_si128((const __m128i*) &samples[i]);
 
-	uint32_t amount = gameAudio->musicPlaying.sound->length - gameAudio->musicPlaying.position;
-	if(amount > length)
-		amount = length;
+		// sign-extend each half to 32 bits by unpacking into the high words
+		__m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+		__m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16));
 
-	SDL_MixAudio(
-			stream,
-			&gameAudio->musicPlaying.sound->buffer[gameAudio->musicPlaying.position],
-			amount,
-			(int) (gameSystem->getFloat("audioMusicVolume") * gameAudio->musicPlaying.volume * (float) SDL_MIX_MAXVOLUME)
-		);
+		_mm_storeu_ps(&bus[i], _mm_add_ps(_mm_loadu_ps(&bus[i]), _mm_mul_ps(low, gains)));
+		_mm_storeu_ps(&bus[i + 4], _mm_add_ps(_mm_loadu_ps(&bus[i + 4]), _mm_mul_ps(high, gains)));
+	}
+#endif
 
-	gameAudio->musicPlaying.position += amount;
+	for(; i + 2 <= count; i += 2) {
+		bus[i] += (float) samples[i] * leftGain;
+		bus[i + 1] += (float) samples[i + 1] * rightGain;
+	}
+}
 
-	// play audio effects in queue
+// convert the bus to 16-bit output, saturating once at the very end
+static void convertBus(const float* bus, int16_t* output, size_t count) {
 	size_t i = 0;
-	while(i < gameAudio->effectsPlaying.size()) {
-		if(gameAudio->effectsPlaying[i].position == gameAudio->effectsPlaying[i].sound->length) {
-			gameAudio->effectsPlaying.erase(gameAudio->effectsPlaying.begin() + i);
 
-			continue;
+#ifdef __SSE2__
+	// clamp, then round halves away from zero exactly as the loop below does
+	// (the default conversion would round them to even instead)
+	const __m128 lowest = _mm_set1_ps(-32768.0f), highest = _mm_set1_ps(32767.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 positiveHalf = _mm_set1_ps(0.5f), negativeHalf = _mm_set1_ps(-0.5f);
+
+	for(; i + 8 <= count; i += 8) {
+		__m128 lowSamples = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&bus[i]), lowest), highest);
+		__m128 highSamples = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&bus[i + 4]), lowest), highest);
+
+		__m128 lowSigns = _mm_cmpge_ps(lowSamples, zero);
+		__m128 highSigns = _mm_cmpge_ps(highSamples, zero);
+		lowSamples = _mm_add_ps(lowSamples, _mm_or_ps(_mm_and_ps(lowSigns, positiveHalf), _mm_andnot_ps(lowSigns, negativeHalf)));
+		highSamples = _mm_add_ps(highSamples, _mm_or_ps(_mm_and_ps(highSigns, positiveHalf), _mm_andnot_ps(highSigns, negativeHalf)));
+
+		__m128i low = _mm_cvttps_epi32(lowSamples);
+		__m128i high = _mm_cvttps_epi32(highSamples);
+
+		_mm_storeu_si128((__m128i*) &output[i], _mm_packs_epi32(low, high));
+	}
+#endif
+
+	for(; i < count; ++i) {
+		float sample = bus[i];
+
+		if(sample > 32767.0f)
+			output[i] = 32767;
+		else if(sample < -32768.0f)
+			output[i] = -32768;
+		else
+			output[i] = (int16_t) (sample + (sample >= 0.0f ? 0.5f : -0.5f));
+	}
+}
+
+void GameAudio::mixAudio(void* userData, uint8_t* stream, int length) {
+	// runs on the audio thread, so it must not allocate, lock or call into
+	// GameSystem; everything it needs arrives through the command queue or
+	// the published volumes
+	GameAudio* audio = (GameAudio*) userData;
+
+	audio->applyCommands();
+
+	float musicLevel = atomicLoadFloat(&audio->musicVolume);
+	float effectsLevel = atomicLoadFloat(&audio->effectsVolume);
+
+	int16_t* output = (int16_t*) stream;
+	size_t outputLength = (size_t) length / sizeof(int16_t);
+	float* bus = &audio->mixBus[0];
+
+	// mix in chunks of at most one bus, in case the device asks for more
+	while(outputLength > 0) {
+		size_t chunkLength = outputLength;
+		if(chunkLength > audio->mixBus.size())
+			chunkLength = audio->mixBus.size();
+
+		for(size_t i = 0; i < chunkLength; ++i)
+			bus[i] = 0.0f;
+
+		// play whatever background music has been decoded so far
+		if(audio->musicStream != NULL) {
+			size_t amount = audio->musicStream->read(&audio->musicBuffer[0], chunkLength);
+
+			mixSamples(bus, &audio->musicBuffer[0], amount, musicLevel, musicLevel);
 		}
 
-		amount = gameAudio->effectsPlaying[i].sound->length - gameAudio->effectsPlaying[i].position;
-		if(amount > length)
-			amount = length;
+		// play audio effects, retiring finished voices by swapping in the last one
+		size_t i = 0;
+		while(i < audio->effectVoiceCount) {
+			Voice& voice = audio->effectVoices[i];
+
+			size_t amount = voice.sound->length - voice.position;
+			if(amount > chunkLength)
+				amount = chunkLength;
+
+			mixSamples(
+					bus,
+					&voice.sound->samples[voice.position],
+					amount,
+					effectsLevel * voice.leftGain,
+					effectsLevel * voice.rightGain
+				);
+
+			voice.position += amount;
+
+			if(voice.position == voice.sound->length)
+				voice = audio->effectVoices[--audio->effectVoiceCount];
+			else
+				++i;
+		}
+
+		convertBus(bus, output, chunkLength);
+
+		output += chunkLength;
+		outputLength -= chunkLength;
+	}
+}
+
+// whether the first voice should be stolen before the second
+static bool isLessImportant(
+		const GameAudio::SoundPriority firstPriority, float firstVolume, uint32_t firstPosition,
+		const GameAudio::SoundPriority secondPriority, float secondVolume, uint32_t secondPosition
+	) {
+	if(firstPriority != secondPriority)
+		return firstPriority < secondPriority;
+
+	// quieter (usually more distant) voices go first, then older ones
+	if(firstVolume != secondVolume)
+		return firstVolume < secondVolume;
+
+	return firstPosition > secondPosition;
+}
+
+void GameAudio::startEffect(const Voice& voice) {
+	// find the least important voice overall and among this sound's voices
+	size_t sameSoundCount = 0;
+	int weakestSameSound = -1;
+	int weakest = -1;
+
+	for(size_t i = 0; i < effectVoiceCount; ++i) {
+		const Voice& playing = effectVoices[i];
+
+		if(
+				weakest < 0 ||
+				isLessImportant(
+						playing.priority, playing.volume, playing.position,
+						effectVoices[weakest].priority, effectVoices[weakest].volume, effectVoices[weakest].position
+					)
+			)
+			weakest = i;
+
+		if(playing.sound != voice.sound)
+			continue;
+
+		++sameSoundCount;
+
+		if(
+				weakestSameSound < 0 ||
+				isLessImportant(
+						playing.priority, playing.volume, playing.position,
+						effectVoices[weakestSameSound].priority,
+						effectVoices[weakestSameSound].volume,
+						effectVoices[weakestSameSound].position
+					)
+			)
+			weakestSameSound = i;
+	}
+
+	int victim = -1;
+	if(sameSoundCount >= MAX_VOICES_PER_SOUND)
+		victim = weakestSameSound;
+	else if(effectVoiceCount >= MAX_EFFECT_VOICES)
+		victim = weakest;
+
+	if(victim < 0) {
+		effectVoices[effectVoiceCount++] = voice;
+
+		return;
+	}
+
+	// a new voice counts as more important than a playing one of equal standing
+	if(
+			isLessImportant(
+					voice.priority, voice.volume, 0,
+					effectVoices[victim].priority, effectVoices[victim].volume, 0
+				)
+		)
+		return;
+
+	effectVoices[victim] = voice;
+}
+
+void GameAudio::applyCommands() {
+	Command command;
+
+	while(commands.pop(command)) {
+		switch(command.type) {
+		case COMMAND_PLAY_EFFECT:
+			if(command.voice.sound->length > 0)
+				startEffect(command.voice);
+
+			break;
+		case COMMAND_STOP_EFFECTS:
+			effectVoiceCount = 0;
 
-		SDL_MixAudio(
-				stream,
-				&gameAudio->effectsPlaying[i].sound->buffer[gameAudio->effectsPlaying[i].position],
-				amount,
-				(int) (gameSystem->getFloat("audioEffectsVolume") * gameAudio->effectsPlaying[i].volume * (float) SDL_MIX_MAXVOLUME)
-			);
+			break;
+		case COMMAND_SET_MUSIC:
+		case COMMAND_STOP_MUSIC:
+			// the retired queue is drained before every music command is
+			// sent, so it holds at most one stream per command that was
+			// queued at the time, which its size allows for
+			if(musicStream != NULL)
+				retiredStreams.push(musicStream);
 
-		gameAudio->effectsPlaying[i].position += amount;
+			musicStream = command.stream;
 
-		++i;
+			break;
+		}
 	}
 }
 
 GameAudio::GameAudio() {
 	// initialize the sound device
-	SDL_AudioSpec audioDeviceSpec;
-	audioDeviceSpec.freq = 44100;
-	audioDeviceSpec.format = AUDIO_S16LSB;
-	audioDeviceSpec.channels = 2;
-	audioDeviceSpec.samples = 512;
-	audioDeviceSpec.callback = mixAudio;
-	audioDeviceSpec.userdata = NULL;
-
-	if(SDL_OpenAudio(&audioDeviceSpec, NULL) < 0)
-		gameSystem->log(GameSystem::LOG_FATAL, "Unable to open the audio device.");
-
-	// load sound files
-	loadSound("alterDownEffect", audioDeviceSpec);
-	loadSound("alterUpEffect", audioDeviceSpec);
-	loadSound("backEffect", audioDeviceSpec);
-	loadSound("empEffect", audioDeviceSpec);
-	loadSound("explosionEffect", audioDeviceSpec);
-	loadSound("menuSong", audioDeviceSpec);
-	loadSound("missileEffect", audioDeviceSpec);
-	loadSound("playingSong", audioDeviceSpec);
-	loadSound("selectEffect", audioDeviceSpec);
-	loadSound("shellEffect", audioDeviceSpec);
-
-	musicPlaying.sound = NULL;
-
-	SDL_PauseAudio(0);
+	deviceSpec.freq = 44100;
+	deviceSpec.format = AUDIO_S16SYS;
+	deviceSpec.channels = 2;
+	deviceSpec.samples = 512;
+	deviceSpec.callback = mixAudio;
+	deviceSpec.userdata = this;
+
+	// prepare the mixer state before the device starts calling back
+	musicStream = NULL;
+	effectVoiceCount = 0;
+	mixBus.resize(deviceSpec.samples * deviceSpec.channels, 0.0f);
+	musicBuffer.resize(mixBus.size(), 0);
+	setMusicVolume(gameSystem->getFloat("audioMusicVolume"));
+	setEffectsVolume(gameSystem->getFloat("audioEffectsVolume"));
+
+	// start decoding sound effects (music is streamed when it is played)
+	loadSound("alterDownEffect");
+	loadSound("alterUpEffect");
+	loadSound("backEffect");
+	loadSound("empEffect");
+	loadSound("explosionEffect");
+	loadSound("missileEffect");
+	loadSound("selectEffect");
+	loadSound("shellEffect");
+
+	// start the output, falling back to a silent one if there is no device
+	std::string output = gameSystem->getString("audioOutput");
+	outputMode = (output == "null" ? OUTPUT_NULL : (output == "file" ? OUTPUT_FILE : OUTPUT_DEVICE));
+	outputRunning = false;
+
+	startOutput();
 }
 
 GameAudio::~GameAudio() {
-	SDL_CloseAudio();
+	stopOutput();
+
+	// the audio thread is gone, so its state and any unapplied commands can
+	// be cleaned up from here (once any sounds still decoding are done)
+	waitForSounds();
+	delete musicStream;
+	freeRetiredStreams();
+
+	Command command;
+	while(commands.pop(command))
+		delete command.stream;
 
 	for(std::map<std::string,GameSound>::iterator itr = sounds.begin(); itr != sounds.end(); ++itr)
-		free(itr->second.buffer);
+		free(itr->second.samples);
 }
 
-void GameAudio::loadSound(std::string file, SDL_AudioSpec audioDeviceSpec) {
+GameAudio::GameSound GameAudio::decodeSound(std::string file, SDL_AudioSpec deviceSpec) {
 	SDL_AudioSpec originalAudioSpec;
 	uint8_t* buffer;
 	uint32_t length;
@@ -115,9 +341,9 @@ void GameAudio::loadSound(std::string file, SDL_AudioSpec audioDeviceSpec) {
 					originalAudioSpec.format,
 					originalAudioSpec.channels,
 					originalAudioSpec.freq,
-					audioDeviceSpec.format,
-					audioDeviceSpec.channels,
-					audioDeviceSpec.freq
+					deviceSpec.format,
+					deviceSpec.channels,
+					deviceSpec.freq
 				) < 0
 		)
 		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to convert audio file " + fullFilePath.str()));
@@ -130,33 +356,294 @@ void GameAudio::loadSound(std::string file, SDL_AudioSpec audioDeviceSpec) {
 	SDL_FreeWAV(buffer);
 
 	GameSound sound;
-	sound.buffer = conversionInfo.buf;
-	sound.length = conversionInfo.len_cvt;
+	sound.samples = (int16_t*) conversionInfo.buf;
+	sound.length = conversionInfo.len_cvt / sizeof(int16_t);
 
-	sounds[file] = sound;
+	return sound;
 }
 
-void GameAudio::setBackgroundMusic(std::string choice) {
-	if(sounds.find(choice) == sounds.end())
-		gameSystem->log(GameSystem::LOG_FATAL, std::string("Non-existent sound " + choice + " requested."));
+void GameAudio::loadSound(std::string file) {
+	SoundJob* job = new SoundJob(this, file);
+	soundJobs[file] = job;
+	jobSystem->submit(job);
+}
 
-	SDL_LockAudio();
-	musicPlaying.sound = &sounds[choice];
-	musicPlaying.volume = 1.0f;
-	musicPlaying.position = 0;
-	SDL_UnlockAudio();
+void GameAudio::waitForSounds() {
+	while(soundJobs.size() > 0)
+		jobSystem->wait(soundJobs.begin()->second);
 }
 
-void GameAudio::playSound(std::string choice, float volume) {
-	if(sounds.find(choice) == sounds.end())
+const GameAudio::GameSound* GameAudio::getSound(std::string choice) {
+	std::map<std::string,SoundJob*>::iterator jobItr = soundJobs.find(choice);
+
+	if(jobItr != soundJobs.end())
+		jobSystem->wait(jobItr->second);
+
+	std::map<std::string,GameSound>::iterator itr = sounds.find(choice);
+
+	if(itr == sounds.end())
 		gameSystem->log(GameSystem::LOG_FATAL, std::string("Non-existent sound " + choice + " requested."));
 
-	GameSoundPlaying playingSound;
-	playingSound.sound = &sounds[choice];
-	playingSound.volume = volume;
-	playingSound.position = 0;
+	return &itr->second;
+}
+
+// write a 44-byte canonical WAVE header for 16-bit PCM data
+static void writeWaveHeader(FILE* file, const SDL_AudioSpec& spec, uint32_t dataLength) {
+	uint8_t header[44];
+	uint32_t blockAlign = spec.channels * sizeof(int16_t);
+	uint32_t fields[][2] = {
+			{ 4, 36 + dataLength },
+			{ 16, 16 },	// format chunk length
+			{ 20, 1 },	// PCM
+			{ 22, spec.channels },
+			{ 24, (uint32_t) spec.freq },
+			{ 28, spec.freq * blockAlign },
+			{ 32, blockAlign },
+			{ 34, 16 },	// bits per sample
+			{ 40, dataLength }
+		};
+
+	memcpy(&header[0], "RIFF", 4);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	memcpy(&header[36], "data", 4);
+
+	for(size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+		size_t width = (fields[i][0] == 20 || fields[i][0] == 22 || fields[i][0] == 32 || fields[i][0] == 34 ? 2 : 4);
+
+		for(size_t p = 0; p < width; ++p)
+			header[fields[i][0] + p] = (uint8_t) (fields[i][1] >> (p * 8));
+	}
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(header, 1, sizeof(header), file);
+}
+
+void GameAudio::startOutput() {
+	if(outputMode == OUTPUT_DEVICE) {
+		if(SDL_OpenAudio(&deviceSpec, NULL) == 0) {
+			SDL_PauseAudio(0);
+			outputRunning = true;
+
+			return;
+		}
+
+		gameSystem->log(GameSystem::LOG_INFO, std::string("Unable to open the audio device, so audio will not be heard; Error: ") + SDL_GetError());
+		outputMode = OUTPUT_NULL;
+	}
+
+	outputFile = NULL;
+	outputFileLength = 0;
+
+	if(outputMode == OUTPUT_FILE) {
+		std::string path = gameSystem->getString("audioOutputFile");
+
+		outputFile = fopen(path.c_str(), "wb");
+		if(outputFile == NULL)
+			gameSystem->log(GameSystem::LOG_FATAL, "Unable to open audio output file " + path);
+
+		writeWaveHeader(outputFile, deviceSpec, 0);
+	}
+
+	renderBuffer.resize(deviceSpec.samples * deviceSpec.channels, 0);
+	renderStopRequested = 0;
+
+	renderThread = SDL_CreateThread(renderOutput, this);
+	if(renderThread == NULL)
+		gameSystem->log(GameSystem::LOG_FATAL, "Unable to start the audio output thread.");
+
+	outputRunning = true;
+}
+
+void GameAudio::stopOutput() {
+	if(! outputRunning)
+		return;
+
+	outputRunning = false;
+
+	if(outputMode == OUTPUT_DEVICE) {
+		SDL_CloseAudio();
+
+		return;
+	}
+
+	atomicStore(&renderStopRequested, (uint32_t) 1);
+	SDL_WaitThread(renderThread, NULL);
+
+	if(outputFile != NULL) {
+		writeWaveHeader(outputFile, deviceSpec, outputFileLength);
+		fclose(outputFile);
+		outputFile = NULL;
+	}
+}
+
+int GameAudio::renderOutput(void* userData) {
+	// stands in for the device's audio thread, with the same restrictions
+	GameAudio* audio = (GameAudio*) userData;
+	uint32_t bufferLength = audio->renderBuffer.size() * sizeof(int16_t);
+	uint64_t bufferNanos = (uint64_t) audio->deviceSpec.samples * 1000000000 / audio->deviceSpec.freq;
+	uint64_t nextBufferTime = platform->getExecNanos();
+
+	while(atomicLoad(&audio->renderStopRequested) == 0) {
+		mixAudio(audio, (uint8_t*) &audio->renderBuffer[0], bufferLength);
+
+		if(audio->outputFile != NULL) {
+			// WAVE data is little-endian
+			if(SDL_BYTEORDER == SDL_BIG_ENDIAN) {
+				for(size_t i = 0; i < audio->renderBuffer.size(); ++i)
+					audio->renderBuffer[i] = (int16_t) SDL_Swap16((uint16_t) audio->renderBuffer[i]);
+			}
+
+			audio->outputFileLength += fwrite(&audio->renderBuffer[0], 1, bufferLength, audio->outputFile);
+		}
+
+		nextBufferTime += bufferNanos;
+
+		uint64_t now = platform->getExecNanos();
+		if(nextBufferTime > now)
+			platform->sleepMills((unsigned int) ((nextBufferTime - now) / 1000000));
+	}
+
+	return 0;
+}
+
+void GameAudio::benchmark() {
+	// nothing else may pull from the mixer while this runs
+	stopOutput();
+
+	setEffectsVolume(1.0f);
+	setMusicVolume(0.0f);
+
+	waitForSounds();
+
+	std::vector<std::string> effectNames;
+	for(std::map<std::string,GameSound>::iterator itr = sounds.begin(); itr != sounds.end(); ++itr)
+		effectNames.push_back(itr->first);
+
+	const unsigned int buffersPerRun = 2048;	// about 24 seconds of audio
+	std::vector<int16_t> output(deviceSpec.samples * deviceSpec.channels);
+	double audioSeconds = (double) buffersPerRun * deviceSpec.samples / deviceSpec.freq;
+
+	for(unsigned int voiceCount = 1; voiceCount <= 256; voiceCount *= 2) {
+		Command command;
+		command.type = COMMAND_STOP_EFFECTS;
+		command.stream = NULL;
+		sendCommand(command);
+		mixAudio(this, (uint8_t*) &output[0], output.size() * sizeof(int16_t));
+
+		// keep requesting effects until the requested count would be playing,
+		// in a fixed pattern so every run mixes identical audio
+		unsigned int requestCount = 0;
+		uint64_t activeVoices = 0;
+		uint32_t checksum = 0;
+		uint64_t startTime = platform->getExecNanos();
+
+		for(unsigned int i = 0; i < buffersPerRun; ++i) {
+			for(size_t p = effectVoiceCount; p < voiceCount; ++p) {
+				playSound(
+						effectNames[requestCount % effectNames.size()],
+						1.0f - (float) (requestCount % 8) / 8.0f,
+						(float) ((int) (requestCount % 5) - 2) / 2.0f,
+						(requestCount % 16 == 0 ? PRIORITY_INTERFACE : PRIORITY_WORLD)
+					);
+
+				++requestCount;
+			}
+
+			mixAudio(this, (uint8_t*) &output[0], output.size() * sizeof(int16_t));
+
+			activeVoices += effectVoiceCount;
+			for(size_t p = 0; p < output.size(); ++p)
+				checksum = checksum * 31 + (uint16_t) output[p];
+		}
+
+		uint64_t elapsedNanos = platform->getExecNanos() - startTime;
+
+		std::stringstream logMessage;
+		logMessage.precision(4);
+		logMessage <<
+				"Audio benchmark: " << voiceCount << " voices requested, " <<
+				(double) activeVoices / buffersPerRun << " mixed on average, " <<
+				(double) elapsedNanos / 1000000.0 / audioSeconds << " ms per second of audio (" <<
+				(double) elapsedNanos / 10000000.0 / audioSeconds << "% of one core), checksum " <<
+				std::hex << checksum << ".";
+
+		// the log is only shown in the game, so report results directly too
+		gameSystem->log(GameSystem::LOG_INFO, logMessage.str());
+		Platform::consoleOut(logMessage.str() + "\n");
+	}
+
+	setMusicVolume(gameSystem->getFloat("audioMusicVolume"));
+	setEffectsVolume(gameSystem->getFloat("audioEffectsVolume"));
+}
+
+bool GameAudio::sendCommand(const Command& command) {
+	// the queue only fills if the audio thread has stalled for many buffers
+	if(! commands.push(command)) {
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Audio command queue full; request dropped.");
+
+		return false;
+	}
+
+	return true;
+}
+
+void GameAudio::freeRetiredStreams() {
+	MusicStream* stream;
+	while(retiredStreams.pop(stream))
+		delete stream;
+}
+
+void GameAudio::setBackgroundMusic(std::string choice) {
+	freeRetiredStreams();
+
+	Command command;
+	command.type = COMMAND_SET_MUSIC;
+	command.stream = new MusicStream(choice, deviceSpec);
+
+	if(! sendCommand(command))
+		delete command.stream;
+}
+
+void GameAudio::stopBackgroundMusic() {
+	freeRetiredStreams();
+
+	Command command;
+	command.type = COMMAND_STOP_MUSIC;
+	command.stream = NULL;
+
+	sendCommand(command);
+}
+
+void GameAudio::playSound(std::string choice, float volume, float pan, SoundPriority priority) {
+	Command command;
+	command.type = COMMAND_PLAY_EFFECT;
+	command.stream = NULL;
+	command.voice.sound = getSound(choice);
+	command.voice.volume = volume;
+	command.voice.priority = priority;
+	command.voice.position = 0;
+
+	// balance panning, which leaves centered sounds at full volume in both
+	// channels and fades out the far channel as a sound moves to one side
+	pan = (pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan));
+	command.voice.leftGain = volume * (pan > 0.0f ? 1.0f - pan : 1.0f);
+	command.voice.rightGain = volume * (pan < 0.0f ? 1.0f + pan : 1.0f);
+
+	sendCommand(command);
+}
+
+void GameAudio::stopSounds() {
+	Command command;
+	command.type = COMMAND_STOP_EFFECTS;
+	command.stream = NULL;
+
+	sendCommand(command);
+}
+
+void GameAudio::setMusicVolume(float volume) {
+	atomicStoreFloat(&musicVolume, volume);
+}
 
-	SDL_LockAudio();
-	effectsPlaying.push_back(playingSound);
-	SDL_UnlockAudio();
+void GameAudio::setEffectsVolume(float volume) {
+	atomicStoreFloat(&effectsVolume, volume);
 }
@@ -4,39 +4,144 @@
 #ifndef GAMEAUDIO_H
 #define GAMEAUDIO_H
 
+#include <cstdio>
 #include <map>
 #include <SDL/SDL.h>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
+#include "core/LockFreeQueue.h"
+
+class MusicStream;
+
 class GameAudio {
 public:
+	// interleaved stereo samples in the device's native byte order
 	struct GameSound {
-		uint8_t* buffer;
-		uint32_t length;
+		int16_t* samples;
+		uint32_t length;	// in samples, not frames
 	};
 
 	std::map<std::string,GameSound> sounds;
 
-	struct GameSoundPlaying {
-		GameSound* sound;
+	// when the voice pool (or a sound's share of it) is full, a new effect
+	// replaces the least important playing one, or is dropped if it is
+	// itself the least important
+	enum SoundPriority {
+		PRIORITY_WORLD,
+		PRIORITY_INTERFACE
+	};
+
+	enum {
+		MAX_EFFECT_VOICES = 32,
+		MAX_VOICES_PER_SOUND = 6
+	};
+
+private:
+	// mixer state, touched only by the audio thread once the device is running
+	struct Voice {
+		const GameSound* sound;
 		float volume;
+		float leftGain, rightGain;
+		SoundPriority priority;
 		uint32_t position;
 	};
 
-	GameSoundPlaying musicPlaying;
-	std::vector<GameSoundPlaying> effectsPlaying;
+	MusicStream* musicStream;
+	Voice effectVoices[MAX_EFFECT_VOICES];
+	size_t effectVoiceCount;
 
-private:
-	void loadSound(std::string file, SDL_AudioSpec audioDeviceSpec);
+	// 32-bit float accumulation bus, and music read from its stream, each
+	// sized for one device buffer
+	std::vector<float> mixBus;
+	std::vector<int16_t> musicBuffer;
+
+	// requests from the main thread, applied at the start of each mix
+	enum CommandType {
+		COMMAND_PLAY_EFFECT,
+		COMMAND_STOP_EFFECTS,
+		COMMAND_SET_MUSIC,
+		COMMAND_STOP_MUSIC
+	};
+
+	struct Command {
+		CommandType type;
+		Voice voice;
+		MusicStream* stream;
+	};
+
+	static const uint32_t commandCapacity = 256;
+	LockFreeQueue<Command, commandCapacity> commands;
+
+	// streams replaced by the audio thread, returned to be freed on the main
+	// thread since closing them waits for their decoding threads; each
+	// command retires at most one, so this holds as many as can be queued
+	LockFreeQueue<MusicStream*, commandCapacity> retiredStreams;
+	void freeRetiredStreams();
+
+	SDL_AudioSpec deviceSpec;
+
+	// without a sound device, a thread pulls buffers from the mixer at the
+	// device's rate and discards them or writes them to a WAVE file
+	enum OutputMode {
+		OUTPUT_DEVICE,
+		OUTPUT_NULL,
+		OUTPUT_FILE
+	};
+
+	OutputMode outputMode;
+	bool outputRunning;
+	SDL_Thread* renderThread;
+	volatile uint32_t renderStopRequested;
+	std::vector<int16_t> renderBuffer;
+	FILE* outputFile;
+	uint32_t outputFileLength;
+
+	void startOutput();
+	void stopOutput();
+	static int renderOutput(void* userData);
+
+	// float bit patterns published to the audio thread (see Atomic.h)
+	volatile uint32_t musicVolume;
+	volatile uint32_t effectsVolume;
+
+	// sound effects are decoded on the job system, and waited for only if
+	// they are played before they are ready
+	class SoundJob;
+	friend class SoundJob;
+	std::map<std::string,SoundJob*> soundJobs;
+
+	static GameSound decodeSound(std::string file, SDL_AudioSpec deviceSpec);
+	void loadSound(std::string file);
+	void waitForSounds();
+	const GameSound* getSound(std::string choice);
+	bool sendCommand(const Command& command);
+
+	static void mixAudio(void* userData, uint8_t* stream, int length);
+	void applyCommands();
+	void startEffect(const Voice& voice);
 
 public:
 	GameAudio();
 	~GameAudio();
 
 	void setBackgroundMusic(std::string choice);
-	void playSound(std::string choice, float volume = 1.0f);
+	void stopBackgroundMusic();
+	void playSound(
+			std::string choice,
+			float volume = 1.0f,
+			float pan = 0.0f,
+			SoundPriority priority = PRIORITY_INTERFACE
+		);
+	void stopSounds();
+
+	void setMusicVolume(float volume);
+	void setEffectsVolume(float volume);
+
+	// stops output and mixes a scripted sequence of effects as fast as
+	// possible at increasing voice counts, logging the cost of each
+	void benchmark();
 };
 
 #endif // GAMEAUDIO_H
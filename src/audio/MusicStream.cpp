@@ -0,0 +1,235 @@
+// MusicStream.cpp
+// Dominicus
+
+#include "audio/MusicStream.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "core/Atomic.h"
+#include "core/GameSystem.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern Platform* platform;
+
+static uint32_t readLittleEndian(const uint8_t* bytes, size_t length) {
+	uint32_t value = 0;
+	for(size_t i = 0; i < length; ++i)
+		value |= (uint32_t) bytes[i] << (i * 8);
+
+	return value;
+}
+
+MusicStream::MusicStream(std::string name, SDL_AudioSpec deviceSpec) :
+		sourceFile(NULL), waveDataOffset(0), waveDataLength(0), waveDataPosition(0), stopRequested(0) {
+	// prefer a compressed track, falling back to an uncompressed one
+	std::stringstream basePath;
+	basePath << platform->dataPath << "/data/audio/" << name;
+
+	if(! openVorbis(basePath.str() + ".ogg", deviceSpec) && ! openWave(basePath.str() + ".wav", deviceSpec))
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to open music track " + basePath.str()));
+
+	conversionBuffer.resize(CHUNK_FRAMES * sourceFrameSize * conversionInfo.len_mult);
+
+	decodeThread = SDL_CreateThread(decode, this);
+	if(decodeThread == NULL)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to start decoding music track " + name));
+}
+
+MusicStream::~MusicStream() {
+	atomicStore(&stopRequested, (uint32_t) 1);
+	SDL_WaitThread(decodeThread, NULL);
+
+	if(sourceFormat == SOURCE_VORBIS)
+		ov_clear(&vorbisFile);	// also closes the file
+	else
+		fclose(sourceFile);
+}
+
+bool MusicStream::openWave(std::string path, SDL_AudioSpec deviceSpec) {
+	sourceFile = fopen(path.c_str(), "rb");
+	if(sourceFile == NULL)
+		return false;
+
+	// walk the RIFF chunks for the format description and the sample data
+	uint8_t header[12];
+	if(
+			fread(header, 1, 12, sourceFile) != 12 ||
+			memcmp(header, "RIFF", 4) != 0 ||
+			memcmp(&header[8], "WAVE", 4) != 0
+		)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Audio file " + path + " is not a WAVE file."));
+
+	uint16_t channels = 0, bitsPerSample = 0;
+	uint32_t frequency = 0;
+	bool formatFound = false;
+
+	while(waveDataOffset == 0) {
+		uint8_t chunkHeader[8];
+		if(fread(chunkHeader, 1, 8, sourceFile) != 8)
+			gameSystem->log(GameSystem::LOG_FATAL, std::string("Audio file " + path + " has no sample data."));
+
+		uint32_t chunkLength = readLittleEndian(&chunkHeader[4], 4);
+
+		if(memcmp(chunkHeader, "fmt ", 4) == 0 && chunkLength >= 16) {
+			uint8_t format[16];
+			if(fread(format, 1, 16, sourceFile) != 16 || readLittleEndian(format, 2) != 1)
+				gameSystem->log(GameSystem::LOG_FATAL, std::string("Audio file " + path + " is not uncompressed PCM."));
+
+			channels = readLittleEndian(&format[2], 2);
+			frequency = readLittleEndian(&format[4], 4);
+			bitsPerSample = readLittleEndian(&format[14], 2);
+			formatFound = true;
+
+			fseek(sourceFile, chunkLength - 16 + (chunkLength & 1), SEEK_CUR);
+		} else if(memcmp(chunkHeader, "data", 4) == 0 && formatFound) {
+			waveDataOffset = ftell(sourceFile);
+			waveDataLength = chunkLength;
+		} else {
+			fseek(sourceFile, chunkLength + (chunkLength & 1), SEEK_CUR);
+		}
+	}
+
+	if(channels == 0 || (bitsPerSample != 8 && bitsPerSample != 16))
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Audio file " + path + " has an unsupported sample format."));
+
+	sourceFrameSize = channels * bitsPerSample / 8;
+	waveDataLength -= waveDataLength % sourceFrameSize;
+
+	if(
+			SDL_BuildAudioCVT(
+					&conversionInfo,
+					(bitsPerSample == 8 ? AUDIO_U8 : AUDIO_S16LSB),
+					channels,
+					frequency,
+					deviceSpec.format,
+					deviceSpec.channels,
+					deviceSpec.freq
+				) < 0
+		)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to convert audio file " + path));
+
+	sourceFormat = SOURCE_WAVE;
+
+	return true;
+}
+
+bool MusicStream::openVorbis(std::string path, SDL_AudioSpec deviceSpec) {
+	sourceFile = fopen(path.c_str(), "rb");
+	if(sourceFile == NULL)
+		return false;
+
+	if(ov_open(sourceFile, &vorbisFile, NULL, 0) != 0)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Audio file " + path + " is not an Ogg Vorbis file."));
+
+	vorbis_info* info = ov_info(&vorbisFile, -1);
+
+	// the decoder produces native-endian 16-bit samples
+	sourceFrameSize = info->channels * sizeof(int16_t);
+
+	if(
+			SDL_BuildAudioCVT(
+					&conversionInfo,
+					AUDIO_S16SYS,
+					info->channels,
+					info->rate,
+					deviceSpec.format,
+					deviceSpec.channels,
+					deviceSpec.freq
+				) < 0
+		)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to convert audio file " + path));
+
+	sourceFormat = SOURCE_VORBIS;
+
+	return true;
+}
+
+size_t MusicStream::readSource(uint8_t* buffer, size_t length) {
+	// reads whole frames, looping back to the start at the end of the track,
+	// and returns zero only on an error or an empty track
+	if(sourceFormat == SOURCE_WAVE) {
+		if(waveDataLength == 0)
+			return 0;
+
+		if(waveDataPosition == waveDataLength) {
+			fseek(sourceFile, waveDataOffset, SEEK_SET);
+			waveDataPosition = 0;
+		}
+
+		if(length > waveDataLength - waveDataPosition)
+			length = waveDataLength - waveDataPosition;
+
+		size_t amount = fread(buffer, 1, length, sourceFile);
+		amount -= amount % sourceFrameSize;
+		waveDataPosition += amount;
+
+		return amount;
+	}
+
+	bool rewound = false;
+
+	while(true) {
+		int bitstream;
+		long amount = ov_read(
+				&vorbisFile,
+				(char*) buffer,
+				length,
+				(SDL_BYTEORDER == SDL_BIG_ENDIAN ? 1 : 0),
+				sizeof(int16_t),
+				1,
+				&bitstream
+			);
+
+		if(amount > 0)
+			return (size_t) amount;
+
+		if(amount == OV_HOLE)
+			continue;
+
+		if(amount < 0 || rewound || ov_pcm_seek(&vorbisFile, 0) != 0)
+			return 0;
+
+		rewound = true;
+	}
+}
+
+int MusicStream::decode(void* userData) {
+	MusicStream* stream = (MusicStream*) userData;
+	int16_t* samples = (int16_t*) &stream->conversionBuffer[0];
+	uint32_t pending = 0, written = 0;
+
+	while(atomicLoad(&stream->stopRequested) == 0) {
+		// convert another chunk once the last one is entirely in the ring
+		if(written == pending) {
+			size_t length = stream->readSource(
+					&stream->conversionBuffer[0],
+					CHUNK_FRAMES * stream->sourceFrameSize
+				);
+
+			if(length == 0)
+				break;
+
+			stream->conversionInfo.buf = &stream->conversionBuffer[0];
+			stream->conversionInfo.len = length;
+			if(SDL_ConvertAudio(&stream->conversionInfo) < 0)
+				break;
+
+			pending = stream->conversionInfo.len_cvt / sizeof(int16_t);
+			written = 0;
+		}
+
+		written += stream->ring.push(&samples[written], pending - written);
+
+		// sleep for a fraction of the ring's duration while it is full
+		if(written < pending)
+			SDL_Delay(20);
+	}
+
+	return 0;
+}
+
+uint32_t MusicStream::read(int16_t* samples, uint32_t count) {
+	return ring.pop(samples, count);
+}
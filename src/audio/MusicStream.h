@@ -0,0 +1,61 @@
+// MusicStream.h
+// Dominicus
+
+#ifndef MUSICSTREAM_H
+#define MUSICSTREAM_H
+
+#include <cstdio>
+#include <SDL/SDL.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <vorbis/vorbisfile.h>
+
+#include "core/LockFreeQueue.h"
+
+// a looping music track decoded and converted on a background thread into a
+// small ring, so memory use does not depend on the length of the track
+class MusicStream {
+public:
+	enum {
+		RING_CAPACITY = 65536,	// in samples (about 0.75 seconds at 44.1 kHz stereo)
+		CHUNK_FRAMES = 4096
+	};
+
+private:
+	enum SourceFormat {
+		SOURCE_WAVE,
+		SOURCE_VORBIS
+	};
+
+	SourceFormat sourceFormat;
+	FILE* sourceFile;
+	OggVorbis_File vorbisFile;
+	uint32_t waveDataOffset;
+	uint32_t waveDataLength;
+	uint32_t waveDataPosition;
+	size_t sourceFrameSize;
+
+	SDL_AudioCVT conversionInfo;
+	std::vector<uint8_t> conversionBuffer;
+
+	LockFreeQueue<int16_t, RING_CAPACITY> ring;
+
+	SDL_Thread* decodeThread;
+	volatile uint32_t stopRequested;
+
+	bool openWave(std::string path, SDL_AudioSpec deviceSpec);
+	bool openVorbis(std::string path, SDL_AudioSpec deviceSpec);
+	size_t readSource(uint8_t* buffer, size_t length);
+
+	static int decode(void* userData);
+
+public:
+	MusicStream(std::string name, SDL_AudioSpec deviceSpec);
+	~MusicStream();
+
+	// for the audio thread only; returns how many samples were available
+	uint32_t read(int16_t* samples, uint32_t count);
+};
+
+#endif // MUSICSTREAM_H
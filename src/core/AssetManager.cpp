@@ -0,0 +1,247 @@
+// AssetManager.cpp
+// Dominicus
+
+#include "core/AssetManager.h"
+
+#include <sstream>
+#include <vector>
+
+#include "core/GameSystem.h"
+#include "core/JobSystem.h"
+#include "math/ScalarMath.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern JobSystem* jobSystem;
+extern Platform* platform;
+
+class AssetManager::MeshJob : public Job {
+	AssetManager* manager;
+	std::string name;
+	Mesh* mesh;
+
+public:
+	MeshJob(AssetManager* manager, std::string name) : Job("model decode"), manager(manager), name(name), mesh(NULL) { }
+	~MeshJob() { delete mesh; }
+
+	void run() { mesh = new Mesh(name); }
+
+	void finish() {
+		manager->meshJobs.erase(name);
+		manager->loadMesh(name, mesh);
+		mesh = NULL;
+	}
+};
+
+class AssetManager::TextureJob : public Job {
+	AssetManager* manager;
+	std::string name;
+	uint32_t compression;
+	Texture* texture;
+
+public:
+	TextureJob(AssetManager* manager, std::string name) :
+			Job("texture decode"),
+			manager(manager),
+			name(name),
+			compression(manager->getTextureCompression()),
+			texture(NULL) { }
+	~TextureJob() { delete texture; }
+
+	void run() { texture = new Texture(getTexturePath(name), compression); }
+
+	void finish() {
+		manager->textureJobs.erase(name);
+
+		manager->textures[name] = texture;
+		texture = NULL;
+	}
+};
+
+std::string AssetManager::getTexturePath(std::string name) {
+	std::stringstream filenameStream;
+	filenameStream <<
+			platform->dataPath <<
+			"/data/textures/" <<
+			name <<
+			".png";
+
+	return filenameStream.str();
+}
+
+uint32_t AssetManager::getTextureCompression() {
+	if(! textureCompressionSupported)
+		return 0;
+
+	return (uint32_t) gameSystem->getFloat("renderingTextureCompression");
+}
+
+AssetManager::AssetManager() : textureCompressionSupported(true) { }
+
+AssetManager::~AssetManager() {
+	// background decodes refer back to us, so let them complete first
+	while(meshJobs.size() > 0)
+		jobSystem->wait(meshJobs.begin()->second);
+
+	while(textureJobs.size() > 0)
+		jobSystem->wait(textureJobs.begin()->second);
+
+	for(
+			std::map<std::string, MeshEntry>::iterator itr = meshes.begin();
+			itr != meshes.end();
+			++itr
+		)
+		delete itr->second.mesh;
+
+	for(
+			std::map<std::string, Texture*>::iterator itr = textures.begin();
+			itr != textures.end();
+			++itr
+		)
+		delete itr->second;
+}
+
+AssetManager::MeshEntry& AssetManager::loadMesh(std::string name, Mesh* decodedMesh) {
+	// rather than decoding it again, wait for any decode already underway,
+	// which finishes by calling back here with its mesh
+	std::map<std::string, MeshJob*>::iterator jobItr = meshJobs.find(name);
+
+	if(decodedMesh == NULL && jobItr != meshJobs.end()) {
+		jobSystem->wait(jobItr->second);
+
+		return meshes.find(name)->second;
+	}
+
+	std::map<std::string, MeshEntry>::iterator itr = meshes.find(name);
+
+	if(itr != meshes.end()) {
+		delete decodedMesh;
+
+		return itr->second;
+	}
+
+	MeshEntry& entry = meshes[name];
+	entry.mesh = (decodedMesh != NULL ? decodedMesh : new Mesh(name));
+
+	// derive bounds and anchor points
+	Mesh* mesh = entry.mesh;
+
+	if(mesh->vertices.size() > 0) {
+		entry.info.boundsMin = mesh->vertices[0];
+		entry.info.boundsMax = mesh->vertices[0];
+	} else {
+		entry.info.boundsMin = Vector3(0.0f, 0.0f, 0.0f);
+		entry.info.boundsMax = Vector3(0.0f, 0.0f, 0.0f);
+	}
+
+	for(size_t i = 0; i < mesh->vertices.size(); ++i) {
+		entry.info.boundsMin = Vector3(
+				minimum(entry.info.boundsMin.x, mesh->vertices[i].x),
+				minimum(entry.info.boundsMin.y, mesh->vertices[i].y),
+				minimum(entry.info.boundsMin.z, mesh->vertices[i].z)
+			);
+		entry.info.boundsMax = Vector3(
+				maximum(entry.info.boundsMax.x, mesh->vertices[i].x),
+				maximum(entry.info.boundsMax.y, mesh->vertices[i].y),
+				maximum(entry.info.boundsMax.z, mesh->vertices[i].z)
+			);
+	}
+
+	for(
+			std::map< std::string,std::vector<Mesh::Face> >::iterator groupItr = mesh->faceGroups.begin();
+			groupItr != mesh->faceGroups.end();
+			++groupItr
+		) {
+		if(groupItr->second.size() == 0)
+			continue;
+
+		GroupInfo& groupInfo = entry.info.groups[groupItr->first];
+
+		const Mesh::Face& firstFace = groupItr->second[0];
+		groupInfo.anchor = (
+				mesh->vertices[firstFace.vertices[0]] +
+				mesh->vertices[firstFace.vertices[1]] +
+				mesh->vertices[firstFace.vertices[2]]
+			) / 3.0f;
+		groupInfo.anchorRadius = distance(groupInfo.anchor, mesh->vertices[firstFace.vertices[0]]);
+
+		groupInfo.boundsMin = mesh->vertices[firstFace.vertices[0]];
+		groupInfo.boundsMax = mesh->vertices[firstFace.vertices[0]];
+
+		for(size_t i = 0; i < groupItr->second.size(); ++i) {
+			for(size_t p = 0; p < 3; ++p) {
+				const Vector3& vertex = mesh->vertices[groupItr->second[i].vertices[p]];
+
+				groupInfo.boundsMin = Vector3(
+						minimum(groupInfo.boundsMin.x, vertex.x),
+						minimum(groupInfo.boundsMin.y, vertex.y),
+						minimum(groupInfo.boundsMin.z, vertex.z)
+					);
+				groupInfo.boundsMax = Vector3(
+						maximum(groupInfo.boundsMax.x, vertex.x),
+						maximum(groupInfo.boundsMax.y, vertex.y),
+						maximum(groupInfo.boundsMax.z, vertex.z)
+					);
+			}
+		}
+	}
+
+	return entry;
+}
+
+Mesh* AssetManager::getMesh(std::string name) {
+	return loadMesh(name).mesh;
+}
+
+Texture* AssetManager::getTexture(std::string name) {
+	std::map<std::string, TextureJob*>::iterator jobItr = textureJobs.find(name);
+
+	if(jobItr != textureJobs.end())
+		jobSystem->wait(jobItr->second);
+
+	std::map<std::string, Texture*>::iterator itr = textures.find(name);
+
+	if(itr == textures.end())
+		itr = textures.insert(std::make_pair(name, new Texture(getTexturePath(name), getTextureCompression()))).first;
+
+	return itr->second;
+}
+
+void AssetManager::prefetchMesh(std::string name) {
+	std::map<std::string, MeshEntry>::iterator itr = meshes.find(name);
+
+	if((itr != meshes.end() && itr->second.mesh != NULL) || meshJobs.find(name) != meshJobs.end())
+		return;
+
+	MeshJob* job = new MeshJob(this, name);
+	meshJobs[name] = job;
+	jobSystem->submit(job);
+}
+
+void AssetManager::prefetchTexture(std::string name) {
+	if(textures.find(name) != textures.end() || textureJobs.find(name) != textureJobs.end())
+		return;
+
+	TextureJob* job = new TextureJob(this, name);
+	textureJobs[name] = job;
+	jobSystem->submit(job);
+}
+
+const AssetManager::ModelInfo& AssetManager::getModelInfo(std::string name) {
+	std::map<std::string, MeshEntry>::iterator itr = meshes.find(name);
+
+	if(itr != meshes.end())
+		return itr->second.info;
+
+	return loadMesh(name).info;
+}
+
+const AssetManager::GroupInfo& AssetManager::getGroupInfo(std::string model, std::string group) {
+	const ModelInfo& info = getModelInfo(model);
+	std::map<std::string, GroupInfo>::const_iterator itr = info.groups.find(group);
+
+	if(itr == info.groups.end())
+		gameSystem->log(GameSystem::LOG_FATAL, "Model " + model + " has no face group " + group + ".");
+
+	return itr->second;
+}
@@ -0,0 +1,79 @@
+// AssetManager.h
+// Dominicus
+
+#ifndef ASSETMANAGER_H
+#define ASSETMANAGER_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#include "geometry/Mesh.h"
+#include "graphics/texture/Texture.h"
+#include "math/VectorMath.h"
+
+class AssetManager {
+public:
+	// metadata derived once from a model when it is first loaded
+	struct GroupInfo {
+		Vector3 anchor;	// centroid of the first face in the group
+		float anchorRadius;	// distance from the anchor to the first face's first vertex
+		Vector3 boundsMin, boundsMax;
+	};
+
+	struct ModelInfo {
+		Vector3 boundsMin, boundsMax;
+		std::map<std::string, GroupInfo> groups;
+	};
+
+private:
+	struct MeshEntry {
+		Mesh* mesh;
+		ModelInfo info;
+	};
+
+	class MeshJob;
+	class TextureJob;
+	friend class MeshJob;
+	friend class TextureJob;
+
+	std::map<std::string, MeshEntry> meshes;
+	std::map<std::string, Texture*> textures;
+
+	// decodes in progress on the job system, which a lookup waits for
+	std::map<std::string, MeshJob*> meshJobs;
+	std::map<std::string, TextureJob*> textureJobs;
+
+	MeshEntry& loadMesh(std::string name, Mesh* decodedMesh = NULL);
+
+	// the graphics context can't always use the compressed formats the
+	// renderingTextureCompression standard asks for
+	bool textureCompressionSupported;
+
+	uint32_t getTextureCompression();
+
+public:
+	AssetManager();
+	~AssetManager();
+
+	// cook textures loaded from here on uncompressed
+	void disableTextureCompression() { textureCompressionSupported = false; }
+
+	static std::string getTexturePath(std::string name);
+
+	// shared assets, decoded on first use and owned by the manager for the
+	// life of the process; there is nothing to release, since every one is
+	// needed again soon after its users go away (such as when the graphics
+	// are recreated or a new game starts)
+	Mesh* getMesh(std::string name);
+	Texture* getTexture(std::string name);
+
+	// start decoding assets in the background ahead of their first use
+	void prefetchMesh(std::string name);
+	void prefetchTexture(std::string name);
+
+	const ModelInfo& getModelInfo(std::string name);
+	const GroupInfo& getGroupInfo(std::string model, std::string group);
+};
+
+#endif // ASSETMANAGER_H
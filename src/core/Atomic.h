@@ -0,0 +1,44 @@
+// Atomic.h
+// Dominicus
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+
+// C++98 has no atomic types, so these wrap the GCC/Clang __sync builtins;
+// every operation is a full memory barrier
+
+template <typename T> inline T atomicLoad(volatile T* value) {
+	return __sync_add_and_fetch(value, 0);
+}
+
+template <typename T> inline void atomicStore(volatile T* value, T newValue) {
+	__sync_synchronize();
+	*value = newValue;
+	__sync_synchronize();
+}
+
+template <typename T> inline T atomicAdd(volatile T* value, T amount) {
+	return __sync_add_and_fetch(value, amount);
+}
+
+template <typename T> inline bool atomicCompareAndSwap(volatile T* value, T expected, T newValue) {
+	return __sync_bool_compare_and_swap(value, expected, newValue);
+}
+
+// floats are published through their bit patterns
+inline float atomicLoadFloat(volatile uint32_t* value) {
+	union { uint32_t bits; float number; } conversion;
+	conversion.bits = atomicLoad(value);
+
+	return conversion.number;
+}
+
+inline void atomicStoreFloat(volatile uint32_t* value, float number) {
+	union { uint32_t bits; float number; } conversion;
+	conversion.number = number;
+	atomicStore(value, conversion.bits);
+}
+
+#endif // ATOMIC_H
@@ -24,6 +24,9 @@ GameSystem::StandardEntry GameSystem::getStandard(const char* key) {
 }
 
 GameSystem::GameSystem() {
+	// background jobs may log too
+	logMutex = SDL_CreateMutex();
+
 	// set the build version string
 	std::stringstream versionStream;
 	versionStream <<
@@ -122,6 +125,7 @@ GameSystem::GameSystem() {
 	setStandard("stateAmmoReloadMultiplier", 4.0f, "Multiplier of reload rate for amount of ammo actually needed to counter missile firing rate.");
 	setStandard("stateShellSpeed", 500.0f, "Shell speed in world units per second.");
 	setStandard("stateShellExpirationDistance", 1500.0f, "Distance at which shells are deleted.");
+	setStandard("stateShellCapacity", 256.0f, "Maximum number of shells in flight at once.");
 	setStandard("stateEMPFiringCost", 0.5f, "Portion of total ammunition capacity depleted by firing one EMP.");
 	setStandard("stateEMPHealthCost", 0.5f, "Portion of total health capacity depleted by firing one EMP.");
 	setStandard("stateEMPChargingTime", 3.0f, "Time in seconds required for EMP charge.");
@@ -142,6 +146,7 @@ GameSystem::GameSystem() {
 
 	// logic standards
 	setStandard("logicUpdateFrequency", 120.0f, "Number of times per second to update game logic.");
+	setStandard("logicJobThreads", 0.0f, "Number of background threads for loading and generating assets (0 for one per processor beyond the first).");
 
 	// display and drawing standards
 	setStandard("displayFramerateLimiting", (float) LIMIT_VSYNC, "How to limit framerate (vsync, fps count, or off).");
@@ -156,6 +161,10 @@ GameSystem::GameSystem() {
 	setStandard("renderingPerspectiveBinocularsFOV", 10.0f, "Field-of-view angle for perspective projection while binoculars enabled.");
 	setStandard("renderingPerspectiveNearClip", 0.5f, "Near clip distance for perspective projection.");
 	setStandard("renderingPerspectiveFarClip", 9000.0f, "Far clip distance for perspective projection.");
+	setStandard("renderingTextureCompression", 1.0f, "Block compression of cooked textures (0 for none, 1 for opaque textures only, 2 for translucent textures too).");
+	setStandard("renderingModelDetailLevels", 4.0f, "Number of successively simplified levels of detail to build for ship and fortress models.");
+	setStandard("renderingModelDetailError", 0.5f, "Largest distance in pixels a simplified model surface may stray from the original before a more detailed level is drawn.");
+	setStandard("renderingShaderPrograms", "color,colorLighting,colorTexture,colorTextureLighting,explosion,hudContainer,missileTrail,radar,radarSpot,shellImpostor,sky,terrain,water", "Shader programs prepared at startup (any others are compiled when first used).");
 	setStandard("waterColor", Vector4(0.025f, 0.05f, 0.15f, 1.0f), "Water color.");
 	setStandard("horizonColor", Vector4(0.88f, 0.88f, 0.88f, 1.0f), "Horizon color.");
 	setStandard("baseSkyColor", Vector4(0.76f, 0.88f, 1.0f, 1.0f), "Sky color at approximately halfway up.");
@@ -166,7 +175,9 @@ GameSystem::GameSystem() {
 	setStandard("terrainNoiseTextureDensity", 512.0f, "Terrain mixing noise texture resolution.");
 	setStandard("terrainNoiseTextureRoughness", 0.6f, "Terrain mixing noise texture roughness factor.");
 	setStandard("terrainNoiseTextureDepth", 4.0f, "Terrain mixing noise texture color depth.");
+	setStandard("terrainNoiseTextureVariants", 4.0f, "Number of terrain mixing noise textures to cache and choose among (zero for a new uncached one every time).");
 	setStandard("shellDensity", 32.0f, "Number of segments for shell sphere.");
+	setStandard("shellImpostorMaximumSize", 24.0f, "Largest on-screen radius in pixels of a shell drawn as a shaded sprite rather than a sphere mesh.");
 	setStandard("missileTrailLength", 100.0f, "Length of missile trail.");
 	setStandard("explosionRadius", 25.0f, "Radius of missile explosion.");
 	setStandard("explosionDuration", 2.0f, "Duration in seconds of missile explosion.");
@@ -227,6 +238,8 @@ GameSystem::GameSystem() {
 	setStandard("audioMusicVolume", 0.5f, "Music volume.");
 	setStandard("audioEffectsVolume", 0.5f, "Audio effects volume.");
 	setStandard("audioVolumeDropOffDistance", 1500.0f, "Distance it takes for an object's effect volume to fade to zero.");
+	setStandard("audioOutput", "device", "Where to send audio (device, null to discard it, or file to record it).");
+	setStandard("audioOutputFile", "dominicus.wav", "WAVE file to record audio into when audio output is set to file.");
 
 	// general game standards
 	setStandard("preferencesVersion", 6.0f, "Version of preferences file format.");
@@ -283,6 +296,10 @@ GameSystem::GameSystem() {
 	this->log(LOG_INFO, buildInfo.str().c_str());
 }
 
+GameSystem::~GameSystem() {
+	SDL_DestroyMutex(logMutex);
+}
+
 void GameSystem::log(LogDetail detail, std::string report) {
 	std::stringstream fullReport;
 
@@ -298,7 +315,9 @@ void GameSystem::log(LogDetail detail, std::string report) {
 	else
 		fullReport << "FATAL: " << report;
 
-		logLines.push_back(fullReport.str());
+	SDL_LockMutex(logMutex);
+	logLines.push_back(fullReport.str());
+	SDL_UnlockMutex(logMutex);
 
 	if(detail == LOG_FATAL) {
 		Platform::consoleOut(fullReport.str() + "\n");
@@ -376,6 +395,9 @@ void GameSystem::flushPreferences() {
 		stringStream << "\"";
 		platform->setPreference("highScores", stringStream.str().c_str());
 	}
+
+	// commit all of the above to storage at once
+	platform->flushPreferences();
 }
 
 unsigned int GameSystem::extractScoreFromLine(std::string scoreString) {
@@ -15,6 +15,7 @@
 
 #include <cstdlib>
 #include <map>
+#include <SDL/SDL.h>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,6 +24,7 @@
 
 class GameSystem {
 	std::vector<std::string> logLines;
+	SDL_mutex* logMutex;
 
 	struct StandardEntry {
 		std::string value;
@@ -38,6 +40,7 @@ public:
 	std::string buildDate;
 
 	GameSystem();
+	~GameSystem();
 
 	enum LogDetail {
 		LOG_INFO, // critical game information that is always displayed
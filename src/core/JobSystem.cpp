@@ -0,0 +1,447 @@
+// JobSystem.cpp
+// Dominicus
+
+#include "core/JobSystem.h"
+
+#include <algorithm>
+#include <set>
+
+#include "core/Atomic.h"
+#include "core/GameSystem.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern Platform* platform;
+
+// one tile of a parallelFor() range
+class RangeJob : public Job {
+	RangeTask* task;
+	unsigned int beginX, endX, beginY, endY;
+
+public:
+	RangeJob(const char* name, RangeTask* task, unsigned int beginX, unsigned int endX, unsigned int beginY, unsigned int endY) :
+			Job(name),
+			task(task),
+			beginX(beginX),
+			endX(endX),
+			beginY(beginY),
+			endY(endY) { }
+
+	void run() { task->run(beginX, endX, beginY, endY); }
+};
+
+Job::Job(const char* name) :
+		name(name),
+		owner(NULL),
+		detached(false),
+		released(false),
+		done(0),
+		unmetPrerequisites(0),
+		queuedNanos(0) { }
+
+void Job::dependsOn(Job* prerequisite) {
+	prerequisite->dependents.push_back(this);
+	++unmetPrerequisites;
+}
+
+int JobSystem::runWorker(void* userData) {
+	Worker* worker = (Worker*) userData;
+	JobSystem* jobSystem = worker->jobSystem;
+
+	atomicStore(&worker->threadID, (uint32_t) SDL_ThreadID());
+
+	int index = 0;
+	while(jobSystem->workers[index] != worker)
+		++index;
+
+	while(atomicLoad(&jobSystem->stopping) == 0) {
+		Job* job = jobSystem->take(index);
+
+		if(job != NULL) {
+			jobSystem->execute(job);
+
+			continue;
+		}
+
+		SDL_LockMutex(jobSystem->mutex);
+		while(atomicLoad(&jobSystem->stopping) == 0 && atomicLoad(&jobSystem->queuedCount) == 0)
+			SDL_CondWait(jobSystem->changed, jobSystem->mutex);
+		SDL_UnlockMutex(jobSystem->mutex);
+	}
+
+	return 0;
+}
+
+JobSystem::JobSystem(unsigned int threadCount) :
+		nextWorker(0),
+		queuedCount(0),
+		stopping(0),
+		submittedCount(0),
+		finishedCount(0),
+		timingHook(NULL) {
+	mutex = SDL_CreateMutex();
+	changed = SDL_CreateCond();
+
+	if(mutex == NULL || changed == NULL)
+		gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to create job system locks; Error: ") + SDL_GetError());
+
+	// jobs nobody waits on still need somewhere to run
+	if(threadCount == 0)
+		threadCount = 1;
+
+	// every worker exists before any starts, since they look at each other
+	for(unsigned int i = 0; i < threadCount; ++i) {
+		Worker* worker = new Worker;
+		worker->jobSystem = this;
+		worker->threadID = 0;
+		worker->thread = NULL;
+		worker->lock = SDL_CreateMutex();
+
+		if(worker->lock == NULL)
+			gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to create job queue lock; Error: ") + SDL_GetError());
+
+		workers.push_back(worker);
+	}
+
+	for(unsigned int i = 0; i < threadCount; ++i) {
+		workers[i]->thread = SDL_CreateThread(runWorker, workers[i]);
+
+		if(workers[i]->thread == NULL)
+			gameSystem->log(GameSystem::LOG_FATAL, std::string("Unable to start job worker thread; Error: ") + SDL_GetError());
+	}
+}
+
+JobSystem::~JobSystem() {
+	// let running jobs complete, but abandon everything else
+	atomicStore(&stopping, (uint32_t) 1);
+
+	SDL_LockMutex(mutex);
+	SDL_CondBroadcast(changed);
+	SDL_UnlockMutex(mutex);
+
+	for(size_t i = 0; i < workers.size(); ++i)
+		SDL_WaitThread(workers[i]->thread, NULL);
+
+	// along with what was queued, free what was still waiting on it
+	std::set<Job*> abandonedJobs;
+	std::vector<Job*> searchJobs;
+
+	for(size_t i = 0; i < workers.size(); ++i)
+		searchJobs.insert(searchJobs.end(), workers[i]->jobs.begin(), workers[i]->jobs.end());
+
+	while(searchJobs.size() > 0) {
+		Job* job = searchJobs.back();
+		searchJobs.pop_back();
+
+		if(abandonedJobs.insert(job).second)
+			searchJobs.insert(searchJobs.end(), job->dependents.begin(), job->dependents.end());
+	}
+
+	for(std::set<Job*>::iterator itr = abandonedJobs.begin(); itr != abandonedJobs.end(); ++itr)
+		if((*itr)->released && ! (*itr)->detached)
+			delete *itr;
+
+	for(size_t i = 0; i < completedJobs.size(); ++i)
+		delete completedJobs[i];
+
+	for(size_t i = 0; i < workers.size(); ++i) {
+		SDL_DestroyMutex(workers[i]->lock);
+		delete workers[i];
+	}
+
+	SDL_DestroyCond(changed);
+	SDL_DestroyMutex(mutex);
+}
+
+int JobSystem::getWorkerIndex() {
+	uint32_t threadID = (uint32_t) SDL_ThreadID();
+
+	for(size_t i = 0; i < workers.size(); ++i)
+		if(atomicLoad(&workers[i]->threadID) == threadID)
+			return (int) i;
+
+	return -1;
+}
+
+void JobSystem::release(Job* job) {
+	SDL_LockMutex(mutex);
+	job->owner = this;
+	job->released = true;
+	bool ready = (job->unmetPrerequisites == 0);
+	if(! job->detached)
+		++submittedCount;
+	SDL_UnlockMutex(mutex);
+
+	if(ready)
+		queue(job);
+}
+
+void JobSystem::queue(Job* job) {
+	// workers keep what they create, and other threads deal jobs out in turn
+	int index = getWorkerIndex();
+	if(index < 0)
+		index = (int) (atomicAdd(&nextWorker, (uint32_t) 1) % workers.size());
+
+	job->queuedNanos = platform->getExecNanos();
+
+	// count it first, so a worker looking for it never sees a count of zero
+	atomicAdd(&queuedCount, (uint32_t) 1);
+
+	SDL_LockMutex(workers[index]->lock);
+	workers[index]->jobs.push_back(job);
+	SDL_UnlockMutex(workers[index]->lock);
+
+	SDL_LockMutex(mutex);
+	SDL_CondBroadcast(changed);
+	SDL_UnlockMutex(mutex);
+}
+
+Job* JobSystem::take(int workerIndex) {
+	Job* job = NULL;
+
+	// newest from our own queue, while its data is likely still in the cache
+	if(workerIndex >= 0) {
+		SDL_LockMutex(workers[workerIndex]->lock);
+		if(workers[workerIndex]->jobs.size() > 0) {
+			job = workers[workerIndex]->jobs.back();
+			workers[workerIndex]->jobs.pop_back();
+		}
+		SDL_UnlockMutex(workers[workerIndex]->lock);
+	}
+
+	// otherwise the oldest from someone else's
+	for(size_t i = 0; i < workers.size() && job == NULL; ++i) {
+		size_t victim = (size_t) (workerIndex + 1 + i) % workers.size();
+		if((int) victim == workerIndex)
+			continue;
+
+		SDL_LockMutex(workers[victim]->lock);
+		if(workers[victim]->jobs.size() > 0) {
+			job = workers[victim]->jobs.front();
+			workers[victim]->jobs.pop_front();
+		}
+		SDL_UnlockMutex(workers[victim]->lock);
+	}
+
+	if(job != NULL)
+		atomicAdd(&queuedCount, (uint32_t) -1);
+
+	return job;
+}
+
+bool JobSystem::takeSpecific(Job* job) {
+	for(size_t i = 0; i < workers.size(); ++i) {
+		SDL_LockMutex(workers[i]->lock);
+
+		std::deque<Job*>::iterator itr = std::find(workers[i]->jobs.begin(), workers[i]->jobs.end(), job);
+		bool found = (itr != workers[i]->jobs.end());
+		if(found)
+			workers[i]->jobs.erase(itr);
+
+		SDL_UnlockMutex(workers[i]->lock);
+
+		if(found) {
+			atomicAdd(&queuedCount, (uint32_t) -1);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(Job* job) {
+	uint64_t startNanos = platform->getExecNanos();
+	job->run();
+
+	if(timingHook != NULL)
+		timingHook(job, startNanos - job->queuedNanos, platform->getExecNanos() - startNanos);
+
+	// once it is marked done its owner may delete it, so gather everything
+	// needed from it first
+	std::vector<Job*> readyJobs;
+
+	SDL_LockMutex(mutex);
+
+	for(size_t i = 0; i < job->dependents.size(); ++i)
+		if(--job->dependents[i]->unmetPrerequisites == 0 && job->dependents[i]->released)
+			readyJobs.push_back(job->dependents[i]);
+
+	if(! job->detached)
+		completedJobs.push_back(job);
+	job->done = 1;
+
+	SDL_CondBroadcast(changed);
+	SDL_UnlockMutex(mutex);
+
+	for(size_t i = 0; i < readyJobs.size(); ++i)
+		queue(readyJobs[i]);
+}
+
+void JobSystem::help(Job* job) {
+	// don't wait for a worker to get to it
+	if(takeSpecific(job)) {
+		execute(job);
+
+		return;
+	}
+
+	SDL_LockMutex(mutex);
+	while(job->done == 0)
+		SDL_CondWait(changed, mutex);
+	SDL_UnlockMutex(mutex);
+}
+
+void JobSystem::submit(Job* job) {
+	job->detached = false;
+	release(job);
+}
+
+void JobSystem::wait(Job* job) {
+	help(job);
+
+	SDL_LockMutex(mutex);
+	completedJobs.erase(std::find(completedJobs.begin(), completedJobs.end(), job));
+	SDL_UnlockMutex(mutex);
+
+	// finish only this job, since the caller may be holding others to wait on
+	job->finish();
+	delete job;
+
+	countFinished(1);
+}
+
+void JobSystem::waitAll() {
+	// finishing a job may submit more, so repeat until nothing is left
+	while(! isIdle()) {
+		Job* job = take(-1);
+
+		if(job != NULL) {
+			execute(job);
+		} else {
+			SDL_LockMutex(mutex);
+			while(completedJobs.size() == 0 && atomicLoad(&queuedCount) == 0)
+				SDL_CondWait(changed, mutex);
+			SDL_UnlockMutex(mutex);
+		}
+
+		finishCompleted();
+	}
+}
+
+unsigned int JobSystem::finishCompleted() {
+	// take one job at a time, since finishing one may wait on another
+	SDL_LockMutex(mutex);
+	size_t available = completedJobs.size();
+	SDL_UnlockMutex(mutex);
+
+	unsigned int finished = 0;
+
+	while(finished < available) {
+		SDL_LockMutex(mutex);
+
+		if(completedJobs.size() == 0) {
+			SDL_UnlockMutex(mutex);
+
+			break;
+		}
+
+		Job* job = completedJobs.front();
+		completedJobs.erase(completedJobs.begin());
+
+		SDL_UnlockMutex(mutex);
+
+		job->finish();
+		delete job;
+
+		countFinished(1);
+		++finished;
+	}
+
+	return finished;
+}
+
+void JobSystem::launch(Job* job) {
+	job->detached = true;
+	release(job);
+}
+
+void JobSystem::complete(Job* job) {
+	help(job);
+}
+
+void JobSystem::parallelFor(
+		RangeTask& task,
+		unsigned int width,
+		unsigned int height,
+		unsigned int tileWidth,
+		unsigned int tileHeight,
+		const char* name
+	) {
+	if(width == 0 || height == 0)
+		return;
+
+	if(tileWidth == 0)
+		tileWidth = width;
+	if(tileHeight == 0)
+		tileHeight = height;
+
+	if(tileWidth >= width && tileHeight >= height) {
+		task.run(0, width, 0, height);
+
+		return;
+	}
+
+	std::vector<RangeJob*> jobs;
+
+	for(unsigned int y = 0; y < height; y += tileHeight) {
+		for(unsigned int x = 0; x < width; x += tileWidth) {
+			jobs.push_back(new RangeJob(
+					name,
+					&task,
+					x,
+					std::min(x + tileWidth, width),
+					y,
+					std::min(y + tileHeight, height)
+				));
+
+			launch(jobs.back());
+		}
+	}
+
+	// work through the tiles here too, from the opposite end to the one
+	// other workers steal from
+	for(size_t i = jobs.size(); i > 0; --i)
+		complete(jobs[i - 1]);
+
+	for(size_t i = 0; i < jobs.size(); ++i)
+		delete jobs[i];
+}
+
+void JobSystem::countFinished(unsigned int count) {
+	// start progress over once everything submitted so far is finished
+	SDL_LockMutex(mutex);
+	finishedCount += count;
+	if(finishedCount == submittedCount) {
+		finishedCount = 0;
+		submittedCount = 0;
+	}
+	SDL_UnlockMutex(mutex);
+}
+
+float JobSystem::getProgress() {
+	SDL_LockMutex(mutex);
+	float progress = (submittedCount == 0 ?
+			1.0f : (float) (finishedCount + completedJobs.size()) / (float) submittedCount);
+	SDL_UnlockMutex(mutex);
+
+	return progress;
+}
+
+bool JobSystem::isIdle() {
+	SDL_LockMutex(mutex);
+	bool idle = (finishedCount == submittedCount);
+	SDL_UnlockMutex(mutex);
+
+	return idle;
+}
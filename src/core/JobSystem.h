@@ -0,0 +1,159 @@
+// JobSystem.h
+// Dominicus
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <deque>
+#include <SDL/SDL.h>
+#include <stdint.h>
+#include <vector>
+
+class JobSystem;
+
+// a unit of background work; run() happens on a worker thread and must only
+// touch the job's own data (and read game standards), while finish() happens
+// afterward on the main thread, where OpenGL calls and registration with the
+// rest of the game are safe
+class Job {
+	friend class JobSystem;
+	template <typename T> friend class Future;
+
+	const char* name;
+	JobSystem* owner;
+	bool detached;	// launched by an owner who collects it, rather than submitted
+	bool released;
+	volatile uint32_t done;
+	unsigned int unmetPrerequisites;
+	std::vector<Job*> dependents;
+	uint64_t queuedNanos;
+
+public:
+	Job(const char* name = "job");
+	virtual ~Job() { }
+
+	// both jobs must still be unsubmitted; this one will not run until the
+	// prerequisite's run() has returned (its finish() may come later)
+	void dependsOn(Job* prerequisite);
+
+	const char* getName() const { return name; }
+
+	virtual void run() = 0;
+	virtual void finish() { }
+};
+
+// a value computed in the background for whoever launched it (see launch());
+// unlike a submitted job it is never finished or deleted by the system
+template <typename T> class Future : public Job {
+	T value;
+
+protected:
+	virtual T compute() = 0;
+
+public:
+	Future(const char* name = "future") : Job(name) { }
+
+	void run() { value = compute(); }
+
+	// waits for the computation (or does it, if no worker has started it)
+	T& get();
+};
+
+// work over a 2D range, which parallelFor() splits into tiles
+class RangeTask {
+public:
+	virtual ~RangeTask() { }
+
+	virtual void run(unsigned int beginX, unsigned int endX, unsigned int beginY, unsigned int endY) = 0;
+};
+
+// called on the thread that ran each job, with the time it spent queued and
+// running (detached jobs included)
+typedef void (*JobTimingHook)(const Job* job, uint64_t queuedNanos, uint64_t runNanos);
+
+// a work-stealing pool: each worker takes the newest job from its own queue
+// and otherwise steals the oldest from another's, and a thread waiting on a
+// job nobody has started yet runs it itself (but nothing else, so the main
+// thread is never caught up in unrelated long jobs)
+class JobSystem {
+	struct Worker {
+		JobSystem* jobSystem;
+		volatile uint32_t threadID;
+		SDL_Thread* thread;
+		SDL_mutex* lock;
+		std::deque<Job*> jobs;
+	};
+
+	std::vector<Worker*> workers;
+	volatile uint32_t nextWorker;
+	volatile uint32_t queuedCount;
+
+	// guards everything below, and is signaled whenever a job is queued or done
+	SDL_mutex* mutex;
+	SDL_cond* changed;
+
+	volatile uint32_t stopping;
+	std::vector<Job*> completedJobs;
+
+	// progress of the jobs submitted since the system was last idle
+	unsigned int submittedCount;
+	unsigned int finishedCount;
+
+	JobTimingHook timingHook;
+
+	static int runWorker(void* userData);
+	int getWorkerIndex();
+	void release(Job* job);
+	void queue(Job* job);
+	Job* take(int workerIndex);
+	bool takeSpecific(Job* job);
+	void execute(Job* job);
+	void help(Job* job);
+	void countFinished(unsigned int count);
+
+public:
+	JobSystem(unsigned int threadCount);
+	~JobSystem();
+
+	unsigned int getWorkerCount() { return workers.size(); }
+	void setTimingHook(JobTimingHook hook) { timingHook = hook; }
+
+	// takes ownership of the job, which is deleted after its finish() runs
+	void submit(Job* job);
+
+	// for the main thread only; blocks until the job has run and then
+	// finishes and deletes it, so it must not have been finished already or
+	// be used afterward
+	void wait(Job* job);
+	void waitAll();
+
+	// for the main thread only; returns the number of jobs finished
+	unsigned int finishCompleted();
+
+	// runs a job the caller keeps ownership of, then collects with complete()
+	// (from any thread) before deleting it; finish() is never called
+	void launch(Job* job);
+	void complete(Job* job);
+
+	// splits the range into tiles run across the workers and the calling
+	// thread (which may itself be a worker), returning when all are done
+	void parallelFor(
+			RangeTask& task,
+			unsigned int width,
+			unsigned int height,
+			unsigned int tileWidth,
+			unsigned int tileHeight,
+			const char* name = "parallelFor"
+		);
+
+	float getProgress();
+	bool isIdle();
+};
+
+template <typename T> T& Future<T>::get() {
+	owner->complete(this);
+
+	return value;
+}
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,77 @@
+// LockFreeQueue.h
+// Dominicus
+
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <stdint.h>
+
+#include "core/Atomic.h"
+
+// fixed-capacity ring for exactly one producer thread and one consumer
+// thread; neither side ever blocks or allocates (capacity must be a power
+// of two so the free-running counters wrap cleanly)
+template <typename T, uint32_t capacity> class LockFreeQueue {
+private:
+	T items[capacity];
+	volatile uint32_t head;	// advanced only by the consumer
+	volatile uint32_t tail;	// advanced only by the producer
+
+public:
+	LockFreeQueue() : head(0), tail(0) { }
+
+	bool push(const T& item) {
+		uint32_t currentTail = tail;
+		if(currentTail - atomicLoad(&head) == capacity)
+			return false;
+
+		items[currentTail % capacity] = item;
+		atomicStore(&tail, currentTail + 1);
+
+		return true;
+	}
+
+	bool pop(T& item) {
+		uint32_t currentHead = head;
+		if(atomicLoad(&tail) == currentHead)
+			return false;
+
+		item = items[currentHead % capacity];
+		atomicStore(&head, currentHead + 1);
+
+		return true;
+	}
+
+	// bulk transfers move as many items as currently fit or are available
+	uint32_t push(const T* newItems, uint32_t count) {
+		uint32_t currentTail = tail;
+		uint32_t space = capacity - (currentTail - atomicLoad(&head));
+		if(count > space)
+			count = space;
+
+		for(uint32_t i = 0; i < count; ++i)
+			items[(currentTail + i) % capacity] = newItems[i];
+		atomicStore(&tail, currentTail + count);
+
+		return count;
+	}
+
+	uint32_t pop(T* poppedItems, uint32_t count) {
+		uint32_t currentHead = head;
+		uint32_t available = atomicLoad(&tail) - currentHead;
+		if(count > available)
+			count = available;
+
+		for(uint32_t i = 0; i < count; ++i)
+			poppedItems[i] = items[(currentHead + i) % capacity];
+		atomicStore(&head, currentHead + count);
+
+		return count;
+	}
+
+	uint32_t size() {
+		return atomicLoad(&tail) - atomicLoad(&head);
+	}
+};
+
+#endif // LOCKFREEQUEUE_H
@@ -21,6 +21,9 @@ protected:
 public:
 	unsigned int runRate;
 
+	// members are deleted through this type by the main loop and benchmarks
+	virtual ~MainLoopMember() { }
+
 	// returns milliseconds to sleep
 	virtual unsigned int execute(bool unScheduled = false) = 0;
 
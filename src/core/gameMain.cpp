@@ -4,20 +4,28 @@
 #include "core/gameMain.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <SDL/SDL.h>
+#include <sstream>
 
 #include "audio/GameAudio.h"
+#include "core/AssetManager.h"
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
 #include "core/MainLoopMember.h"
 #include "graphics/DrawingMaster.h"
 #include "graphics/GameGraphics.h"
+#include "graphics/texture/Texture.h"
 #include "input/InputHandler.h"
 #include "logic/GameLogic.h"
+#include "math/MatrixBenchmark.h"
 #include "platform/Platform.h"
 #include "state/GameState.h"
+#include "state/MissileBenchmark.h"
 
 // global variable declarations
+AssetManager* assetManager;
 DrawingMaster* drawingMaster;
 GameAudio* gameAudio;
 GameGraphics* gameGraphics;
@@ -25,6 +33,7 @@ GameLogic* gameLogic;
 GameState* gameState;
 GameSystem* gameSystem;
 InputHandler* inputHandler;
+JobSystem* jobSystem;
 Platform* platform;
 
 // main loop modules (should only be modified by the main loop or GameLogic)
@@ -33,6 +42,20 @@ std::map<MainLoopMember*, unsigned int> mainLoopModules;
 // global main loop continuation flag
 bool keepProgramAlive;
 
+// reports the background jobs worth noticing in development mode
+static void logJobTiming(const Job* job, uint64_t queuedNanos, uint64_t runNanos) {
+	if(runNanos < 1000000)
+		return;
+
+	std::stringstream logMessage;
+	logMessage <<
+			"Job " << job->getName() << " ran for " <<
+			runNanos / 1000 << " us after waiting " <<
+			queuedNanos / 1000 << " us.";
+
+	gameSystem->log(GameSystem::LOG_VERBOSE, logMessage.str());
+}
+
 // main game function
 int gameMain(int argc, char* argv[]) {
 	// finish SDL-related initialization
@@ -40,8 +63,62 @@ int gameMain(int argc, char* argv[]) {
 
 	// initialize our common objects
 	gameState = NULL;
+	gameAudio = NULL;
 	platform = new Platform();
 	gameSystem = new GameSystem();
+
+	unsigned int jobThreads = (unsigned int) gameSystem->getFloat("logicJobThreads");
+	if(jobThreads == 0)
+		jobThreads = Platform::getProcessorCount() - 1;
+	jobSystem = new JobSystem(jobThreads);
+	if(gameSystem->getBool("developmentMode"))
+		jobSystem->setTimingHook(logJobTiming);
+
+	assetManager = new AssetManager();
+
+	// benchmark the audio mixer, missile flight, texture or matrix operations
+	// instead of playing if requested
+	bool benchmarked = false;
+
+	for(int i = 1; i < argc && ! benchmarked; ++i) {
+		benchmarked = true;
+
+		if(strcmp(argv[i], "-audioBenchmark") == 0) {
+			gameSystem->setStandard("audioOutput", "null");
+			gameAudio = new GameAudio();
+			gameAudio->benchmark();
+		} else if(strcmp(argv[i], "-missileBenchmark") == 0) {
+			gameState = new GameState(GameState::getModelMetrics());
+			benchmarkMissiles(*gameState, 10000);
+		} else if(strcmp(argv[i], "-textureBenchmark") == 0) {
+			Texture::benchmark();
+		} else if(strcmp(argv[i], "-mathBenchmark") == 0) {
+			benchmarkMatrixMath();
+		} else {
+			benchmarked = false;
+		}
+	}
+
+	if(benchmarked) {
+		delete gameState;
+		delete gameAudio;
+		delete assetManager;
+		delete jobSystem;
+		delete gameSystem;
+		delete platform;
+
+		return 0;
+	}
+
+	// decode the models and menu textures in the background while the sound
+	// effects, window, fonts and noise textures are prepared
+	assetManager->prefetchMesh("fortress");
+	assetManager->prefetchMesh("missile");
+	assetManager->prefetchMesh("ship");
+	assetManager->prefetchMesh("trail");
+	assetManager->prefetchTexture("branding/logo");
+	assetManager->prefetchTexture("branding/splash");
+
 	gameAudio = new GameAudio();
 	gameGraphics = new GameGraphics(gameSystem->getBool("displayStartFullscreen"), true);
 	drawingMaster = new DrawingMaster();
@@ -98,6 +175,8 @@ int gameMain(int argc, char* argv[]) {
 	delete drawingMaster;
 	delete gameGraphics;
 	delete gameAudio;
+	delete assetManager;
+	delete jobSystem;
 	delete gameSystem;
 	delete platform;
 
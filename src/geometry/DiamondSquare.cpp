@@ -6,7 +6,7 @@
 #include <cmath>
 #include <cstdlib>
 
-DiamondSquare::DiamondSquare(unsigned int size, float roughness) : size(size) {
+DiamondSquare::DiamondSquare(unsigned int size, float roughness, unsigned int seed) : size(size) {
 	// initialize the memory
 	data = new float*[size];
 	for(unsigned int i = 0; i < size; ++i)
@@ -40,7 +40,7 @@ DiamondSquare::DiamondSquare(unsigned int size, float roughness) : size(size) {
 						data[(p + offset >= size ? p + offset - size : p + offset)][j - offset] +
 						data[(p + offset >= size ? p + offset - size : p + offset)]
 								[(j + offset >= size ? j + offset - size : j + offset)]
-					) / 4.0f + ((float) (rand() % 100) / 50.0f - 1.0f) * displaceRange;
+					) / 4.0f + ((float) (rand_r(&seed) % 100) / 50.0f - 1.0f) * displaceRange;
 			}
 		}
 
@@ -95,7 +95,7 @@ DiamondSquare::DiamondSquare(unsigned int size, float roughness) : size(size) {
 										n * jump - jump / 2 + size :
 										n * jump - jump / 2)
 							]
-					) / 4.0f + ((float) (rand() % 100) / 50.0f - 1.0f) * displaceRange;
+					) / 4.0f + ((float) (rand_r(&seed) % 100) / 50.0f - 1.0f) * displaceRange;
 			}
 		}
 
@@ -11,7 +11,9 @@ public:
 	unsigned int size;
 	float** data;
 
-	DiamondSquare(unsigned int size, float roughness);
+	// displacements come from their own generator, so separate heightmaps
+	// can be generated on separate threads
+	DiamondSquare(unsigned int size, float roughness, unsigned int seed);
 	~DiamondSquare();
 };
 
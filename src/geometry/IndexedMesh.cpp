@@ -0,0 +1,230 @@
+// IndexedMesh.cpp
+// Dominicus
+
+#include "geometry/IndexedMesh.h"
+
+#include <sstream>
+#include <utility>
+
+#include "core/GameSystem.h"
+
+extern GameSystem* gameSystem;
+
+void IndexedMesh::reorderTriangles(std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize) {
+	// Tipsify (Sander, Nehab and Barczak, 2007); fans around each vertex in
+	// turn, choosing the next fanning vertex by its remaining cache lifetime
+	size_t triangleCount = indices.size() / 3;
+	if(triangleCount == 0)
+		return;
+
+	// build vertex-triangle adjacency
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for(size_t i = 0; i < indices.size(); ++i)
+		++liveTriangles[indices[i]];
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for(size_t i = 0; i < vertexCount; ++i)
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for(size_t i = 0; i < indices.size(); ++i)
+		adjacency[adjacencyFill[indices[i]]++] = i / 3;
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int time = cacheSize + 1;
+	size_t cursor = 0;
+	int fanningVertex = indices[0];
+
+	while(fanningVertex >= 0) {
+		candidates.clear();
+
+		// emit all remaining triangles around the fanning vertex
+		for(
+				unsigned int i = adjacencyOffsets[fanningVertex];
+				i < adjacencyOffsets[fanningVertex + 1];
+				++i
+			) {
+			unsigned int triangle = adjacency[i];
+			if(emitted[triangle])
+				continue;
+
+			for(size_t p = 0; p < 3; ++p) {
+				unsigned int vertex = indices[triangle * 3 + p];
+
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+
+				if(time - cacheTime[vertex] > cacheSize) {
+					cacheTime[vertex] = time;
+					++time;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// pick the candidate which will still be in the cache after its fan
+		fanningVertex = -1;
+		int bestPriority = -1;
+
+		for(size_t i = 0; i < candidates.size(); ++i) {
+			unsigned int vertex = candidates[i];
+			if(liveTriangles[vertex] == 0)
+				continue;
+
+			int priority = 0;
+			if(time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+				priority = time - cacheTime[vertex];
+
+			if(priority > bestPriority) {
+				bestPriority = priority;
+				fanningVertex = vertex;
+			}
+		}
+
+		// otherwise back up through recently used vertices, then scan
+		while(fanningVertex < 0 && deadEnd.size() > 0) {
+			unsigned int vertex = deadEnd.back();
+			deadEnd.pop_back();
+
+			if(liveTriangles[vertex] > 0)
+				fanningVertex = vertex;
+		}
+
+		while(fanningVertex < 0 && cursor < vertexCount) {
+			if(liveTriangles[cursor] > 0)
+				fanningVertex = cursor;
+			++cursor;
+		}
+	}
+
+	indices = output;
+}
+
+IndexedMesh::IndexedMesh(Mesh& mesh, bool useNormals, bool useTexCoords, size_t cacheSize) :
+		triangleCount(0), originalACMR(0.0f), optimizedACMR(0.0f) {
+	// deduplicate attribute index combinations into shared vertices
+	std::map<std::pair<unsigned int, std::pair<unsigned int, unsigned int> >, unsigned int> uniqueVertices;
+	std::vector<unsigned int> allIndices;
+
+	for(
+			std::map< std::string,std::vector<Mesh::Face> >::iterator groupItr = mesh.faceGroups.begin();
+			groupItr != mesh.faceGroups.end();
+			++groupItr
+		) {
+		std::vector<unsigned int>& indices = groupIndices[groupItr->first];
+		indices.reserve(groupItr->second.size() * 3);
+
+		for(size_t i = 0; i < groupItr->second.size(); ++i) {
+			for(size_t p = 0; p < 3; ++p) {
+				Vertex vertex;
+				vertex.vertex = groupItr->second[i].vertices[p];
+				vertex.normal = (useNormals ? groupItr->second[i].normals[p] : 0);
+				vertex.texCoord = (useTexCoords ? groupItr->second[i].texCoords[p] : 0);
+
+				std::pair<unsigned int, std::pair<unsigned int, unsigned int> > key(
+						vertex.vertex,
+						std::pair<unsigned int, unsigned int>(vertex.normal, vertex.texCoord)
+					);
+
+				std::map<std::pair<unsigned int, std::pair<unsigned int, unsigned int> >, unsigned int>::iterator itr =
+						uniqueVertices.find(key);
+
+				if(itr == uniqueVertices.end()) {
+					itr = uniqueVertices.insert(std::make_pair(key, (unsigned int) vertices.size())).first;
+					vertices.push_back(vertex);
+				}
+
+				indices.push_back(itr->second);
+			}
+		}
+
+		triangleCount += groupItr->second.size();
+		allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+	}
+
+	originalACMR = getACMR(allIndices, cacheSize);
+
+	// reorder each group's triangles for post-transform cache locality
+	allIndices.clear();
+
+	for(
+			std::map< std::string,std::vector<unsigned int> >::iterator itr = groupIndices.begin();
+			itr != groupIndices.end();
+			++itr
+		) {
+		reorderTriangles(itr->second, vertices.size(), cacheSize);
+		allIndices.insert(allIndices.end(), itr->second.begin(), itr->second.end());
+	}
+
+	optimizedACMR = getACMR(allIndices, cacheSize);
+
+	// renumber vertices in order of first use for pre-transform fetch locality
+	std::vector<unsigned int> newIndex(vertices.size(), (unsigned int) -1);
+	std::vector<Vertex> reorderedVertices;
+	reorderedVertices.reserve(vertices.size());
+
+	for(
+			std::map< std::string,std::vector<unsigned int> >::iterator itr = groupIndices.begin();
+			itr != groupIndices.end();
+			++itr
+		) {
+		for(size_t i = 0; i < itr->second.size(); ++i) {
+			if(newIndex[itr->second[i]] == (unsigned int) -1) {
+				newIndex[itr->second[i]] = reorderedVertices.size();
+				reorderedVertices.push_back(vertices[itr->second[i]]);
+			}
+
+			itr->second[i] = newIndex[itr->second[i]];
+		}
+	}
+
+	vertices = reorderedVertices;
+}
+
+float IndexedMesh::getACMR(const std::vector<unsigned int>& indices, size_t cacheSize) {
+	// simulate a FIFO post-transform vertex cache
+	if(indices.size() < 3)
+		return 0.0f;
+
+	std::map<unsigned int, unsigned int> cacheTime;
+	unsigned int time = 0;
+	unsigned int misses = 0;
+
+	for(size_t i = 0; i < indices.size(); ++i) {
+		std::map<unsigned int, unsigned int>::iterator itr = cacheTime.find(indices[i]);
+
+		if(itr == cacheTime.end() || time - itr->second >= cacheSize) {
+			cacheTime[indices[i]] = time;
+			++time;
+			++misses;
+		}
+	}
+
+	return (float) misses / (float) (indices.size() / 3);
+}
+
+void IndexedMesh::logStatistics(std::string name, size_t vertexSize) {
+	size_t unindexedSize = triangleCount * 3 * (vertexSize + sizeof(unsigned int));
+	size_t indexedSize = vertices.size() * vertexSize + triangleCount * 3 * sizeof(unsigned int);
+
+	std::stringstream logMessage;
+	logMessage <<
+			"Model " << name << ": " <<
+			triangleCount << " triangles, " <<
+			triangleCount * 3 << " to " << vertices.size() << " vertices, " <<
+			unindexedSize << " to " << indexedSize << " buffer bytes, ACMR 3.00 unindexed, " <<
+			originalACMR << " indexed, " <<
+			optimizedACMR << " optimized.";
+
+	gameSystem->log(GameSystem::LOG_VERBOSE, logMessage.str());
+}
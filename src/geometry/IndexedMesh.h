@@ -0,0 +1,38 @@
+// IndexedMesh.h
+// Dominicus
+
+#ifndef INDEXEDMESH_H
+#define INDEXEDMESH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "geometry/Mesh.h"
+
+class IndexedMesh {
+public:
+	// a unique combination of source mesh attribute indices
+	struct Vertex {
+		unsigned int vertex;
+		unsigned int normal;
+		unsigned int texCoord;
+	};
+
+	std::vector<Vertex> vertices;
+	std::map< std::string,std::vector<unsigned int> > groupIndices;
+
+	// statistics for reporting (ACMR is the average number of vertex cache
+	// misses per triangle; 3.0 means no reuse at all)
+	size_t triangleCount;
+	float originalACMR;
+	float optimizedACMR;
+
+	IndexedMesh(Mesh& mesh, bool useNormals = true, bool useTexCoords = true, size_t cacheSize = 16);
+
+	static void reorderTriangles(std::vector<unsigned int>& indices, size_t vertexCount, size_t cacheSize);
+	static float getACMR(const std::vector<unsigned int>& indices, size_t cacheSize = 16);
+	void logStatistics(std::string name, size_t vertexSize);
+};
+
+#endif // INDEXEDMESH_H
@@ -3,24 +3,50 @@
 
 #include "geometry/Mesh.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <stdint.h>
 
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
+#include "math/ScalarMath.h"
 #include "platform/Platform.h"
 
 extern GameSystem* gameSystem;
+extern JobSystem* jobSystem;
 extern Platform* platform;
 
-Mesh::Mesh(std::string filename) {
+Mesh::Mesh(std::string filename) : angleWeightedNormals(false) {
+	std::string objPath = platform->dataPath + "/data/models/" + filename + ".obj";
+	std::string cachePath = platform->cachePath + "/" + filename + ".mesh";
+
+	size_t objSize = 0;
+	int64_t objModificationTime = 0;
+	if(! platform->getFileInfo(objPath.c_str(), &objSize, &objModificationTime))
+		gameSystem->log(GameSystem::LOG_FATAL, "Unable to load model " + filename + " from file.");
+
+	// use the compiled model if it is current, otherwise parse the OBJ source
+	// and compile it for next time
+	if(loadCache(cachePath, objSize, objModificationTime))
+		return;
+
+	loadOBJ(objPath);
+	writeCache(cachePath, objSize, objModificationTime);
+}
+
+void Mesh::loadOBJ(std::string path) {
 	std::ifstream objFile;
 	std::string line;
 
 	std::string groupName = "default";
 
-	objFile.open(std::string(platform->dataPath + "/data/models/" + filename + ".obj").c_str());
+	objFile.open(path.c_str());
 	if(! objFile.is_open())
-		gameSystem->log(GameSystem::LOG_FATAL, "Unable to load model " + filename + " from file.");
+		gameSystem->log(GameSystem::LOG_FATAL, "Unable to load model from file " + path + ".");
 
 	while(! objFile.eof()) {
 		std::getline(objFile, line);
@@ -130,10 +156,249 @@ Mesh::Mesh(std::string filename) {
 	objFile.close();
 }
 
-void Mesh::autoNormal() {
-	normals.clear();
+bool Mesh::loadCache(std::string path, size_t sourceSize, int64_t sourceModificationTime) {
+	size_t fileSize = 0;
+	const uint8_t* fileData = (const uint8_t*) platform->mapFile(path.c_str(), &fileSize);
+
+	if(fileData == NULL)
+		return false;
+
+	// validate the header against the current format and source file
+	const CacheHeader* header = (const CacheHeader*) fileData;
+
+	if(
+			fileSize < sizeof(CacheHeader) ||
+			memcmp(header->magic, "DMSH", 4) != 0 ||
+			header->version != cacheVersion ||
+			header->sourceSize != (uint64_t) sourceSize ||
+			header->sourceModificationTime != sourceModificationTime
+		) {
+		platform->unmapFile(fileData, fileSize);
+
+		return false;
+	}
+
+	size_t offset = sizeof(CacheHeader);
+	size_t vertexBytes = header->vertexCount * sizeof(Vector3);
+	size_t normalBytes = header->normalCount * sizeof(Vector3);
+	size_t texCoordBytes = header->texCoordCount * sizeof(Vector2);
+
+	if(offset + vertexBytes + normalBytes + texCoordBytes > fileSize) {
+		platform->unmapFile(fileData, fileSize);
+
+		return false;
+	}
+
+	vertices.resize(header->vertexCount);
+	if(vertexBytes > 0)
+		memcpy((void*) &vertices[0], fileData + offset, vertexBytes);
+	offset += vertexBytes;
+
+	normals.resize(header->normalCount);
+	if(normalBytes > 0)
+		memcpy((void*) &normals[0], fileData + offset, normalBytes);
+	offset += normalBytes;
+
+	texCoords.resize(header->texCoordCount);
+	if(texCoordBytes > 0)
+		memcpy((void*) &texCoords[0], fileData + offset, texCoordBytes);
+	offset += texCoordBytes;
+
+	for(uint32_t i = 0; i < header->groupCount; ++i) {
+		if(offset + 2 * sizeof(uint32_t) > fileSize)
+			break;
+
+		uint32_t nameLength = *(const uint32_t*) (fileData + offset);
+		uint32_t faceCount = *(const uint32_t*) (fileData + offset + sizeof(uint32_t));
+		offset += 2 * sizeof(uint32_t);
+
+		size_t paddedNameLength = (nameLength + 3) & ~3;
+		if(offset + paddedNameLength + faceCount * sizeof(Face) > fileSize)
+			break;
+
+		std::vector<Face>& faces = faceGroups[std::string((const char*) (fileData + offset), nameLength)];
+		offset += paddedNameLength;
+
+		faces.resize(faceCount);
+		if(faceCount > 0)
+			memcpy(&faces[0], fileData + offset, faceCount * sizeof(Face));
+		offset += faceCount * sizeof(Face);
+	}
+
+	bool complete = (faceGroups.size() == header->groupCount && offset == fileSize);
+
+	platform->unmapFile(fileData, fileSize);
+
+	// discard anything read from a truncated or corrupt file
+	if(! complete) {
+		vertices.clear();
+		normals.clear();
+		texCoords.clear();
+		faceGroups.clear();
+	}
+
+	return complete;
+}
+
+void Mesh::writeCache(std::string path, size_t sourceSize, int64_t sourceModificationTime) {
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+
+	memcpy(header.magic, "DMSH", 4);
+	header.version = cacheVersion;
+	header.sourceSize = (uint64_t) sourceSize;
+	header.sourceModificationTime = sourceModificationTime;
+	header.vertexCount = vertices.size();
+	header.normalCount = normals.size();
+	header.texCoordCount = texCoords.size();
+	header.groupCount = faceGroups.size();
+
+	// write to a temporary file and rename it into place so a partially
+	// written cache is never picked up
+	std::string temporaryPath = path + ".tmp";
+	FILE* cacheFile = fopen(temporaryPath.c_str(), "wb");
+
+	if(cacheFile == NULL) {
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write model cache file " + path + ".");
 
-	std::map<unsigned int, std::vector<Vector3> > vertexNormals;
+		return;
+	}
+
+	bool writeSucceeded = fwrite(&header, sizeof(CacheHeader), 1, cacheFile) == 1;
+
+	if(writeSucceeded && vertices.size() > 0)
+		writeSucceeded = fwrite(&vertices[0], sizeof(Vector3), vertices.size(), cacheFile) == vertices.size();
+	if(writeSucceeded && normals.size() > 0)
+		writeSucceeded = fwrite(&normals[0], sizeof(Vector3), normals.size(), cacheFile) == normals.size();
+	if(writeSucceeded && texCoords.size() > 0)
+		writeSucceeded = fwrite(&texCoords[0], sizeof(Vector2), texCoords.size(), cacheFile) == texCoords.size();
+
+	for(
+			std::map< std::string,std::vector<Face> >::iterator groupItr = faceGroups.begin();
+			writeSucceeded && groupItr != faceGroups.end();
+			++groupItr
+		) {
+		uint32_t counts[2] = { (uint32_t) groupItr->first.length(), (uint32_t) groupItr->second.size() };
+		const char padding[4] = { 0, 0, 0, 0 };
+
+		writeSucceeded =
+				fwrite(counts, sizeof(uint32_t), 2, cacheFile) == 2 &&
+				fwrite(groupItr->first.c_str(), 1, counts[0], cacheFile) == counts[0] &&
+				fwrite(padding, 1, ((counts[0] + 3) & ~3) - counts[0], cacheFile) == ((counts[0] + 3) & ~3) - counts[0];
+
+		if(writeSucceeded && counts[1] > 0)
+			writeSucceeded = fwrite(&groupItr->second[0], sizeof(Face), counts[1], cacheFile) == counts[1];
+	}
+
+	if(fclose(cacheFile) != 0 || ! writeSucceeded || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		remove(temporaryPath.c_str());
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write model cache file " + path + ".");
+	}
+}
+
+// determine a face's weighted normal contribution to each of its corners
+static void getFaceNormalContributions(
+		const Vector3* vertices,
+		const unsigned int* triangle,
+		bool angleWeighted,
+		Vector3* contributions
+	) {
+	Vector3 v1(vertices[triangle[1]] - vertices[triangle[0]]);
+	Vector3 v2(vertices[triangle[2]] - vertices[triangle[1]]);
+
+	// the cross product's magnitude is twice the face area, so summing it
+	// unnormalized gives area weighting
+	Vector3 faceNormal = cross(v1, v2);
+
+	if(! angleWeighted) {
+		contributions[0] = faceNormal;
+		contributions[1] = faceNormal;
+		contributions[2] = faceNormal;
+
+		return;
+	}
+
+	faceNormal.norm();
+
+	for(size_t p = 0; p < 3; ++p) {
+		Vector3 edge1 = vertices[triangle[(p + 1) % 3]] - vertices[triangle[p]];
+		Vector3 edge2 = vertices[triangle[(p + 2) % 3]] - vertices[triangle[p]];
+		float lengths = mag(edge1) * mag(edge2);
+
+		if(lengths > 0.0f)
+			contributions[p] = faceNormal * acos(maximum(-1.0f, minimum(1.0f, dot(edge1, edge2) / lengths)));
+		else
+			contributions[p] = Vector3(0.0f, 0.0f, 0.0f);
+	}
+}
+
+static void accumulateFaceNormals(
+		const Vector3* vertices,
+		const unsigned int* triangles,
+		size_t firstTriangle,
+		size_t lastTriangle,
+		bool angleWeighted,
+		Vector3* normals
+	) {
+	Vector3 contributions[3];
+
+	for(size_t i = firstTriangle; i < lastTriangle; ++i) {
+		getFaceNormalContributions(vertices, triangles + i * 3, angleWeighted, contributions);
+
+		normals[triangles[i * 3 + 0]] += contributions[0];
+		normals[triangles[i * 3 + 1]] += contributions[1];
+		normals[triangles[i * 3 + 2]] += contributions[2];
+	}
+}
+
+// accumulates each slice of the faces into its own array
+class NormalSliceTask : public RangeTask {
+public:
+	const Vector3* vertices;
+	const unsigned int* triangles;
+	size_t triangleCount;
+	size_t vertexCount;
+	bool angleWeighted;
+	std::vector< std::vector<Vector3> > sliceNormals;
+
+	// one dimensional, so the Y range is unused
+	void run(unsigned int beginX, unsigned int endX, unsigned int, unsigned int) {
+		for(unsigned int slice = beginX; slice < endX; ++slice) {
+			sliceNormals[slice].assign(vertexCount, Vector3(0.0f, 0.0f, 0.0f));
+
+			accumulateFaceNormals(
+					vertices,
+					triangles,
+					triangleCount * slice / sliceNormals.size(),
+					triangleCount * (slice + 1) / sliceNormals.size(),
+					angleWeighted,
+					&sliceNormals[slice][0]
+				);
+		}
+	}
+};
+
+// sums the slices for a range of vertices and normalizes the results
+class NormalSumTask : public RangeTask {
+public:
+	const std::vector< std::vector<Vector3> >* sliceNormals;
+	Vector3* normals;
+
+	// one dimensional, so the Y range is unused
+	void run(unsigned int beginX, unsigned int endX, unsigned int, unsigned int) {
+		for(unsigned int i = beginX; i < endX; ++i) {
+			Vector3 sum(0.0f, 0.0f, 0.0f);
+			for(size_t slice = 0; slice < sliceNormals->size(); ++slice)
+				sum += (*sliceNormals)[slice][i];
+
+			sum.norm();
+			normals[i] = sum;
+		}
+	}
+};
+
+void Mesh::flattenTriangles(std::vector<unsigned int>& triangles) {
+	triangles.clear();
 
 	for(
 			std::map< std::string,std::vector<Face> >::iterator groupItr =
@@ -146,39 +411,173 @@ void Mesh::autoNormal() {
 				index < groupItr->second.size();
 				++index
 			) {
-			Vector3 v1(
-					vertices[groupItr->second[index].vertices[1]] -
-					vertices[groupItr->second[index].vertices[0]]
-				);
-			Vector3 v2(
-					vertices[groupItr->second[index].vertices[2]] -
-					vertices[groupItr->second[index].vertices[1]]
-				);
+			for(size_t p = 0; p < 3; ++p)
+				triangles.push_back(groupItr->second[index].vertices[p]);
+		}
+	}
+}
+
+bool Mesh::normalTopologyCurrent() {
+	if(
+			normals.size() != vertices.size() ||
+			vertexTriangleOffsets.size() != vertices.size() + 1
+		)
+		return false;
+
+	// every face must still be the triangle autoNormal() saw in its place,
+	// with its normals still pointing at the per-vertex normals
+	size_t position = 0;
+
+	for(
+			std::map< std::string,std::vector<Face> >::iterator groupItr =
+					faceGroups.begin();
+			groupItr != faceGroups.end();
+			++groupItr
+		) {
+		for(
+				size_t index = 0;
+				index < groupItr->second.size();
+				++index
+			) {
+			const Face& face = groupItr->second[index];
 
-			Vector3 normal = cross(v1, v2);
-			normal.norm();
+			if(position + 3 > normalTriangles.size())
+				return false;
 
-			vertexNormals[groupItr->second[index].vertices[0]].push_back(normal);
-			vertexNormals[groupItr->second[index].vertices[1]].push_back(normal);
-			vertexNormals[groupItr->second[index].vertices[2]].push_back(normal);
+			for(size_t p = 0; p < 3; ++p) {
+				if(
+						face.vertices[p] != normalTriangles[position + p] ||
+						face.normals[p] != face.vertices[p]
+					)
+					return false;
+			}
 
-			groupItr->second[index].normals[0] = groupItr->second[index].vertices[0];
-			groupItr->second[index].normals[1] = groupItr->second[index].vertices[1];
-			groupItr->second[index].normals[2] = groupItr->second[index].vertices[2];
+			position += 3;
 		}
 	}
 
-	for(size_t i = 0; i < vertices.size(); ++i) {
-		unsigned int count = 0;
+	return position == normalTriangles.size();
+}
+
+void Mesh::autoNormal(NormalWeighting weighting, unsigned int sliceCount) {
+	angleWeightedNormals = (weighting == WEIGHT_ANGLE);
+
+	// flatten the faces and point their normals at the per-vertex normals
+	flattenTriangles(normalTriangles);
+
+	for(
+			std::map< std::string,std::vector<Face> >::iterator groupItr =
+					faceGroups.begin();
+			groupItr != faceGroups.end();
+			++groupItr
+		) {
+		for(
+				size_t index = 0;
+				index < groupItr->second.size();
+				++index
+			) {
+			for(size_t p = 0; p < 3; ++p)
+				groupItr->second[index].normals[p] = groupItr->second[index].vertices[p];
+		}
+	}
+
+	size_t triangleCount = normalTriangles.size() / 3;
+
+	// build the vertex to triangle adjacency for incremental updates, each
+	// vertex's triangles in ascending order so an update sums them in the
+	// same order as the unsliced pass below
+	vertexTriangleOffsets.assign(vertices.size() + 1, 0);
+	for(size_t i = 0; i < normalTriangles.size(); ++i)
+		++vertexTriangleOffsets[normalTriangles[i] + 1];
+	for(size_t i = 0; i < vertices.size(); ++i)
+		vertexTriangleOffsets[i + 1] += vertexTriangleOffsets[i];
+
+	std::vector<unsigned int> fill(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+	vertexTriangles.resize(normalTriangles.size());
+	for(size_t i = 0; i < normalTriangles.size(); ++i)
+		vertexTriangles[fill[normalTriangles[i]]++] = i / 3;
+
+	// accumulate weighted face normals, splitting the faces into slices run
+	// on the job system which each sum into their own array if requested
+	normals.assign(vertices.size(), Vector3(0.0f, 0.0f, 0.0f));
+
+	if(triangleCount == 0)
+		return;
+
+	if(sliceCount <= 1 || triangleCount < sliceCount * 1024) {
+		accumulateFaceNormals(&vertices[0], &normalTriangles[0], 0, triangleCount, angleWeightedNormals, &normals[0]);
+
+		for(size_t i = 0; i < normals.size(); ++i)
+			normals[i].norm();
+	} else {
+		NormalSliceTask sliceTask;
+		sliceTask.vertices = &vertices[0];
+		sliceTask.triangles = &normalTriangles[0];
+		sliceTask.triangleCount = triangleCount;
+		sliceTask.vertexCount = vertices.size();
+		sliceTask.angleWeighted = angleWeightedNormals;
+		sliceTask.sliceNormals.resize(sliceCount);
+
+		jobSystem->parallelFor(sliceTask, sliceCount, 1, 1, 1, "autoNormal slices");
+
+		NormalSumTask sumTask;
+		sumTask.sliceNormals = &sliceTask.sliceNormals;
+		sumTask.normals = &normals[0];
+
+		jobSystem->parallelFor(sumTask, vertices.size(), 1, 16384, 1, "autoNormal sum");
+	}
+}
+
+void Mesh::updateNormals(const std::vector<unsigned int>& changedVertices) {
+	// without current adjacency (no autoNormal() yet, or the faces or vertex
+	// count changed since) do a full rebuild
+	if(! normalTopologyCurrent()) {
+		autoNormal(angleWeightedNormals ? WEIGHT_ANGLE : WEIGHT_AREA);
+
+		return;
+	}
+
+	// a moved vertex changes the faces around it, which changes the normals
+	// of every vertex of those faces
+	std::vector<unsigned int> affectedVertices;
+
+	for(size_t i = 0; i < changedVertices.size(); ++i) {
+		unsigned int vertex = changedVertices[i];
+
+		if(vertex >= vertices.size())
+			continue;
+
+		for(unsigned int t = vertexTriangleOffsets[vertex]; t < vertexTriangleOffsets[vertex + 1]; ++t)
+			for(size_t p = 0; p < 3; ++p)
+				affectedVertices.push_back(normalTriangles[vertexTriangles[t] * 3 + p]);
+	}
+
+	std::sort(affectedVertices.begin(), affectedVertices.end());
+	affectedVertices.erase(std::unique(affectedVertices.begin(), affectedVertices.end()), affectedVertices.end());
+
+	// re-accumulate only those vertices' normals from their own faces
+	Vector3 contributions[3];
+
+	for(size_t i = 0; i < affectedVertices.size(); ++i) {
+		unsigned int vertex = affectedVertices[i];
 		Vector3 total(0.0f, 0.0f, 0.0f);
 
-		for(size_t p = 0; p < vertexNormals[i].size(); ++p) {
-			++count;
-			total += vertexNormals[i][p];
+		for(unsigned int t = vertexTriangleOffsets[vertex]; t < vertexTriangleOffsets[vertex + 1]; ++t) {
+			// a triangle using the vertex twice is listed twice in a row, but
+			// its contributions are all gathered on the first visit
+			if(t > vertexTriangleOffsets[vertex] && vertexTriangles[t] == vertexTriangles[t - 1])
+				continue;
+
+			const unsigned int* triangle = &normalTriangles[vertexTriangles[t] * 3];
+			getFaceNormalContributions(&vertices[0], triangle, angleWeightedNormals, contributions);
+
+			for(size_t p = 0; p < 3; ++p)
+				if(triangle[p] == vertex)
+					total += contributions[p];
 		}
 
-		total /= count;
-		normals.push_back(total);
+		total.norm();
+		normals[vertex] = total;
 	}
 }
 
@@ -201,3 +600,33 @@ void Mesh::autoTexCoord(unsigned int index, std::string group = "") {
 		));
 	faceGroups[group][index].texCoords[2] = texCoords.size() - 1;
 }
+
+void Mesh::getBoundingSphere(Vector3* center, float* radius) {
+	if(vertices.size() == 0) {
+		*center = Vector3(0.0f, 0.0f, 0.0f);
+		*radius = 0.0f;
+
+		return;
+	}
+
+	Vector3 boundsMin = vertices[0], boundsMax = vertices[0];
+
+	for(size_t i = 1; i < vertices.size(); ++i) {
+		boundsMin = Vector3(
+				minimum(boundsMin.x, vertices[i].x),
+				minimum(boundsMin.y, vertices[i].y),
+				minimum(boundsMin.z, vertices[i].z)
+			);
+		boundsMax = Vector3(
+				maximum(boundsMax.x, vertices[i].x),
+				maximum(boundsMax.y, vertices[i].y),
+				maximum(boundsMax.z, vertices[i].z)
+			);
+	}
+
+	*center = (boundsMin + boundsMax) / 2.0f;
+	*radius = 0.0f;
+
+	for(size_t i = 0; i < vertices.size(); ++i)
+		*radius = maximum(*radius, distance(*center, vertices[i]));
+}
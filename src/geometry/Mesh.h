@@ -5,13 +5,50 @@
 #define MESH_H
 
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
 #include "math/VectorMath.h"
 
 class Mesh {
+private:
+	// compiled binary model cache file layout (native byte order): header,
+	// vertex/normal/texcoord arrays, then per group the name length, face
+	// count, name (padded to four bytes), and face array
+	static const uint32_t cacheVersion = 1;
+
+	struct CacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceModificationTime;
+		uint32_t vertexCount;
+		uint32_t normalCount;
+		uint32_t texCoordCount;
+		uint32_t groupCount;
+	};
+
+	// triangle adjacency retained by autoNormal() for incremental updates
+	// (flattened face vertex triples, plus the triangles using each vertex)
+	std::vector<unsigned int> normalTriangles;
+	std::vector<unsigned int> vertexTriangleOffsets;
+	std::vector<unsigned int> vertexTriangles;
+	bool angleWeightedNormals;
+
+	void flattenTriangles(std::vector<unsigned int>& triangles);
+	bool normalTopologyCurrent();
+
+	void loadOBJ(std::string path);
+	bool loadCache(std::string path, size_t sourceSize, int64_t sourceModificationTime);
+	void writeCache(std::string path, size_t sourceSize, int64_t sourceModificationTime);
+
 public:
+	enum NormalWeighting {
+		WEIGHT_AREA,
+		WEIGHT_ANGLE
+	};
+
 	struct Face {
 		unsigned int vertices[3];
 		unsigned int normals[3];
@@ -25,7 +62,7 @@ public:
 	std::map< std::string,std::vector<Face> > faceGroups;
 
 	// constructors
-	Mesh() { };
+	Mesh() : angleWeightedNormals(false) { };
 	Mesh(std::string filename);
 
 	// vertex manipulation
@@ -131,8 +168,14 @@ public:
 	}
 
 	// utility methods
-	void autoNormal();
+	void autoNormal(NormalWeighting weighting = WEIGHT_AREA, unsigned int sliceCount = 1);
+	// recomputes only the normals around moved vertices, falling back to a
+	// full autoNormal() if the faces changed since the last one
+	void updateNormals(const std::vector<unsigned int>& changedVertices);
 	void autoTexCoord(unsigned int index, std::string group);
+
+	// a sphere enclosing every vertex, centered on their bounding box
+	void getBoundingSphere(Vector3* center, float* radius);
 };
 
 #endif // MESH_H
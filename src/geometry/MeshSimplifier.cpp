@@ -0,0 +1,402 @@
+// MeshSimplifier.cpp
+// Dominicus
+
+#include "geometry/MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <sstream>
+#include <utility>
+
+#include "core/GameSystem.h"
+#include "math/VectorMath.h"
+
+extern GameSystem* gameSystem;
+
+void MeshSimplifier::Quadric::addPlane(double a, double b, double c, double d, double planeWeight) {
+	a2 += planeWeight * a * a; ab += planeWeight * a * b; ac += planeWeight * a * c; ad += planeWeight * a * d;
+	b2 += planeWeight * b * b; bc += planeWeight * b * c; bd += planeWeight * b * d;
+	c2 += planeWeight * c * c; cd += planeWeight * c * d;
+	d2 += planeWeight * d * d;
+
+	weight += planeWeight;
+}
+
+void MeshSimplifier::Quadric::add(const Quadric& quadric) {
+	a2 += quadric.a2; ab += quadric.ab; ac += quadric.ac; ad += quadric.ad;
+	b2 += quadric.b2; bc += quadric.bc; bd += quadric.bd;
+	c2 += quadric.c2; cd += quadric.cd;
+	d2 += quadric.d2;
+
+	weight += quadric.weight;
+}
+
+double MeshSimplifier::Quadric::evaluate(const Vector3& point) const {
+	double x = point.x, y = point.y, z = point.z;
+
+	return
+			a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+			b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+			c2 * z * z + 2.0 * cd * z +
+			d2;
+}
+
+MeshSimplifier::MeshSimplifier(Mesh& mesh, IndexedMesh& indexedMesh, size_t levelCount, float reduction, size_t cacheSize) {
+	// flatten every group into one triangle list
+	std::vector<std::string> groupNames;
+	std::vector<unsigned int> triangles;
+	std::vector<unsigned int> triangleGroups;
+
+	for(
+			std::map< std::string,std::vector<unsigned int> >::iterator itr = indexedMesh.groupIndices.begin();
+			itr != indexedMesh.groupIndices.end();
+			++itr
+		) {
+		for(size_t i = 0; i + 2 < itr->second.size(); i += 3) {
+			triangles.push_back(itr->second[i]);
+			triangles.push_back(itr->second[i + 1]);
+			triangles.push_back(itr->second[i + 2]);
+			triangleGroups.push_back(groupNames.size());
+		}
+
+		groupNames.push_back(itr->first);
+	}
+
+	size_t triangleCount = triangleGroups.size();
+	size_t vertexCount = indexedMesh.vertices.size();
+
+	if(triangleCount == 0 || levelCount == 0)
+		return;
+
+	// vertices sharing a position with another (a texture seam or a normal
+	// crease) can't move without tearing the surface
+	std::vector<unsigned int> positionVertexCounts(mesh.vertices.size(), 0);
+	for(size_t i = 0; i < vertexCount; ++i)
+		++positionVertexCounts[indexedMesh.vertices[i].vertex];
+
+	std::vector<bool> locked(vertexCount, false);
+	for(size_t i = 0; i < vertexCount; ++i)
+		locked[i] = positionVertexCounts[indexedMesh.vertices[i].vertex] > 1;
+
+	// nor can those on an edge without exactly two faces of one group
+	std::map<std::pair<unsigned int, unsigned int>, std::pair<unsigned int, unsigned int> > edgeFaces;
+
+	for(size_t i = 0; i < triangleCount; ++i) {
+		for(size_t p = 0; p < 3; ++p) {
+			unsigned int position1 = indexedMesh.vertices[triangles[i * 3 + p]].vertex;
+			unsigned int position2 = indexedMesh.vertices[triangles[i * 3 + (p + 1) % 3]].vertex;
+
+			std::pair<unsigned int, unsigned int> key(std::min(position1, position2), std::max(position1, position2));
+			std::map<std::pair<unsigned int, unsigned int>, std::pair<unsigned int, unsigned int> >::iterator itr = edgeFaces.find(key);
+
+			if(itr == edgeFaces.end())
+				edgeFaces[key] = std::make_pair(1u, triangleGroups[i]);
+			else if(itr->second.second != triangleGroups[i])
+				itr->second.first = 3;
+			else
+				++itr->second.first;
+		}
+	}
+
+	std::vector<bool> boundaryPositions(mesh.vertices.size(), false);
+
+	for(
+			std::map<std::pair<unsigned int, unsigned int>, std::pair<unsigned int, unsigned int> >::iterator itr = edgeFaces.begin();
+			itr != edgeFaces.end();
+			++itr
+		) {
+		if(itr->second.first != 2) {
+			boundaryPositions[itr->first.first] = true;
+			boundaryPositions[itr->first.second] = true;
+		}
+	}
+
+	for(size_t i = 0; i < vertexCount; ++i)
+		if(boundaryPositions[indexedMesh.vertices[i].vertex])
+			locked[i] = true;
+
+	// accumulate the planes of the faces around each position
+	std::vector<Quadric> quadrics(mesh.vertices.size());
+
+	for(size_t i = 0; i < triangleCount; ++i) {
+		Vector3 point1 = mesh.vertices[indexedMesh.vertices[triangles[i * 3]].vertex];
+		Vector3 edge1 = mesh.vertices[indexedMesh.vertices[triangles[i * 3 + 1]].vertex] - point1;
+		Vector3 edge2 = mesh.vertices[indexedMesh.vertices[triangles[i * 3 + 2]].vertex] - point1;
+		Vector3 normal = cross(edge1, edge2);
+
+		float area = mag(normal);
+		if(area == 0.0f)
+			continue;
+
+		normal /= area;
+
+		for(size_t p = 0; p < 3; ++p)
+			quadrics[indexedMesh.vertices[triangles[i * 3 + p]].vertex].addPlane(
+					normal.x, normal.y, normal.z, -dot(normal, point1), area / 2.0f
+				);
+	}
+
+	// faces around each vertex (dead ones are skipped rather than removed)
+	std::vector<std::vector<unsigned int> > vertexTriangles(vertexCount);
+	for(size_t i = 0; i < triangles.size(); ++i)
+		vertexTriangles[triangles[i]].push_back(i / 3);
+
+	std::vector<bool> liveTriangles(triangleCount, true);
+	std::vector<bool> removedVertices(vertexCount, false);
+	size_t liveTriangleCount = triangleCount;
+
+	// queue every collapse of a movable vertex along one of its edges
+	std::priority_queue<Collapse> collapses;
+
+	for(size_t i = 0; i < triangleCount; ++i) {
+		for(size_t p = 0; p < 3; ++p) {
+			Collapse collapse;
+			collapse.from = triangles[i * 3 + p];
+			collapse.to = triangles[i * 3 + (p + 1) % 3];
+
+			for(size_t q = 0; q < 2; ++q) {
+				if(! locked[collapse.from]) {
+					Quadric quadric = quadrics[indexedMesh.vertices[collapse.from].vertex];
+					quadric.add(quadrics[indexedMesh.vertices[collapse.to].vertex]);
+					collapse.cost = quadric.evaluate(mesh.vertices[indexedMesh.vertices[collapse.to].vertex]);
+
+					collapses.push(collapse);
+				}
+
+				std::swap(collapse.from, collapse.to);
+			}
+		}
+	}
+
+	float error = 0.0f;
+	size_t targetTriangleCount = (size_t) (triangleCount * reduction);
+	size_t lastLevelTriangleCount = triangleCount;
+
+	std::vector<unsigned int> fromNeighbours, toNeighbours, sharedNeighbours;
+
+	while(levels.size() < levelCount) {
+		bool exhausted = collapses.empty();
+
+		if(! exhausted && liveTriangleCount > targetTriangleCount) {
+			Collapse collapse = collapses.top();
+			collapses.pop();
+
+			if(removedVertices[collapse.from] || removedVertices[collapse.to])
+				continue;
+
+			unsigned int fromPosition = indexedMesh.vertices[collapse.from].vertex;
+			unsigned int toPosition = indexedMesh.vertices[collapse.to].vertex;
+			const Vector3& toPoint = mesh.vertices[toPosition];
+
+			// costs only ever rise, so a stale entry is requeued at its
+			// current cost and considered again in turn
+			Quadric quadric = quadrics[fromPosition];
+			quadric.add(quadrics[toPosition]);
+			double cost = quadric.evaluate(toPoint);
+
+			if(cost > collapse.cost * 1.000001 + 1.0e-12) {
+				collapse.cost = cost;
+				collapses.push(collapse);
+
+				continue;
+			}
+
+			// the edge must still exist, and the collapse must neither fold
+			// over nor squash any of the faces which will remain
+			fromNeighbours.clear();
+			toNeighbours.clear();
+			sharedNeighbours.clear();
+
+			size_t sharedTriangleCount = 0;
+			bool valid = true;
+
+			for(size_t i = 0; i < vertexTriangles[collapse.from].size() && valid; ++i) {
+				unsigned int triangle = vertexTriangles[collapse.from][i];
+				if(! liveTriangles[triangle])
+					continue;
+
+				bool shared = false;
+				for(size_t p = 0; p < 3; ++p) {
+					unsigned int vertex = triangles[triangle * 3 + p];
+
+					if(vertex == collapse.to)
+						shared = true;
+					else if(vertex != collapse.from)
+						fromNeighbours.push_back(indexedMesh.vertices[vertex].vertex);
+				}
+
+				if(shared) {
+					++sharedTriangleCount;
+
+					for(size_t p = 0; p < 3; ++p)
+						if(triangles[triangle * 3 + p] != collapse.from && triangles[triangle * 3 + p] != collapse.to)
+							sharedNeighbours.push_back(indexedMesh.vertices[triangles[triangle * 3 + p]].vertex);
+
+					continue;
+				}
+
+				Vector3 points[3];
+				for(size_t p = 0; p < 3; ++p)
+					points[p] = mesh.vertices[indexedMesh.vertices[triangles[triangle * 3 + p]].vertex];
+
+				Vector3 edge1 = points[1] - points[0], edge2 = points[2] - points[0];
+				Vector3 oldNormal = cross(edge1, edge2);
+
+				for(size_t p = 0; p < 3; ++p)
+					if(triangles[triangle * 3 + p] == collapse.from)
+						points[p] = toPoint;
+
+				edge1 = points[1] - points[0];
+				edge2 = points[2] - points[0];
+				Vector3 newNormal = cross(edge1, edge2);
+
+				if(dot(oldNormal, newNormal) <= 0.2f * mag(oldNormal) * mag(newNormal))
+					valid = false;
+			}
+
+			if(! valid || sharedTriangleCount == 0 || sharedTriangleCount > 2)
+				continue;
+
+			// the link condition; vertices neighbouring both ends must be
+			// those across the collapsing edge, or the surface pinches
+			for(size_t i = 0; i < vertexTriangles[collapse.to].size(); ++i) {
+				unsigned int triangle = vertexTriangles[collapse.to][i];
+				if(! liveTriangles[triangle])
+					continue;
+
+				for(size_t p = 0; p < 3; ++p)
+					if(triangles[triangle * 3 + p] != collapse.to)
+						toNeighbours.push_back(indexedMesh.vertices[triangles[triangle * 3 + p]].vertex);
+			}
+
+			std::sort(fromNeighbours.begin(), fromNeighbours.end());
+			fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+			std::sort(toNeighbours.begin(), toNeighbours.end());
+			toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+			std::sort(sharedNeighbours.begin(), sharedNeighbours.end());
+			sharedNeighbours.erase(std::unique(sharedNeighbours.begin(), sharedNeighbours.end()), sharedNeighbours.end());
+
+			size_t commonNeighbourCount = 0;
+			for(size_t i = 0; i < fromNeighbours.size(); ++i)
+				if(std::binary_search(toNeighbours.begin(), toNeighbours.end(), fromNeighbours[i]))
+					++commonNeighbourCount;
+
+			if(commonNeighbourCount != sharedNeighbours.size())
+				continue;
+
+			// move every face onto the remaining vertex, dropping the ones
+			// that collapse
+			for(size_t i = 0; i < vertexTriangles[collapse.from].size(); ++i) {
+				unsigned int triangle = vertexTriangles[collapse.from][i];
+				if(! liveTriangles[triangle])
+					continue;
+
+				bool shared = false;
+				for(size_t p = 0; p < 3; ++p)
+					if(triangles[triangle * 3 + p] == collapse.to)
+						shared = true;
+
+				if(shared) {
+					liveTriangles[triangle] = false;
+					--liveTriangleCount;
+
+					continue;
+				}
+
+				for(size_t p = 0; p < 3; ++p)
+					if(triangles[triangle * 3 + p] == collapse.from)
+						triangles[triangle * 3 + p] = collapse.to;
+
+				vertexTriangles[collapse.to].push_back(triangle);
+			}
+
+			removedVertices[collapse.from] = true;
+			vertexTriangles[collapse.from].clear();
+			quadrics[toPosition] = quadric;
+
+			if(quadric.weight > 0.0)
+				error = std::max(error, (float) sqrt(std::max(cost, 0.0) / quadric.weight));
+
+			// requeue the edges around the remaining vertex at their new costs
+			for(size_t i = 0; i < vertexTriangles[collapse.to].size(); ++i) {
+				unsigned int triangle = vertexTriangles[collapse.to][i];
+				if(! liveTriangles[triangle])
+					continue;
+
+				for(size_t p = 0; p < 3; ++p) {
+					unsigned int neighbour = triangles[triangle * 3 + p];
+					if(neighbour == collapse.to)
+						continue;
+
+					Collapse neighbourCollapse;
+					neighbourCollapse.from = neighbour;
+					neighbourCollapse.to = collapse.to;
+
+					for(size_t q = 0; q < 2; ++q) {
+						if(! locked[neighbourCollapse.from]) {
+							Quadric neighbourQuadric = quadrics[indexedMesh.vertices[neighbourCollapse.from].vertex];
+							neighbourQuadric.add(quadrics[indexedMesh.vertices[neighbourCollapse.to].vertex]);
+							neighbourCollapse.cost = neighbourQuadric.evaluate(mesh.vertices[indexedMesh.vertices[neighbourCollapse.to].vertex]);
+
+							collapses.push(neighbourCollapse);
+						}
+
+						std::swap(neighbourCollapse.from, neighbourCollapse.to);
+					}
+				}
+			}
+
+			continue;
+		}
+
+		// keep a level once it reaches its target, or when nothing more can
+		// be collapsed if that still saved enough to be worth drawing
+		if(exhausted && liveTriangleCount > lastLevelTriangleCount * (1.0f + reduction) / 2.0f)
+			break;
+
+		Level level;
+		level.triangleCount = liveTriangleCount;
+		level.error = error;
+
+		for(size_t i = 0; i < groupNames.size(); ++i)
+			level.groupIndices[groupNames[i]];
+
+		for(size_t i = 0; i < triangleCount; ++i) {
+			if(! liveTriangles[i])
+				continue;
+
+			std::vector<unsigned int>& indices = level.groupIndices[groupNames[triangleGroups[i]]];
+			indices.push_back(triangles[i * 3]);
+			indices.push_back(triangles[i * 3 + 1]);
+			indices.push_back(triangles[i * 3 + 2]);
+		}
+
+		for(
+				std::map< std::string,std::vector<unsigned int> >::iterator itr = level.groupIndices.begin();
+				itr != level.groupIndices.end();
+				++itr
+			)
+			IndexedMesh::reorderTriangles(itr->second, vertexCount, cacheSize);
+
+		levels.push_back(level);
+
+		if(exhausted)
+			break;
+
+		lastLevelTriangleCount = liveTriangleCount;
+		targetTriangleCount = (size_t) (liveTriangleCount * reduction);
+	}
+}
+
+void MeshSimplifier::logStatistics(std::string name) {
+	std::stringstream logMessage;
+	logMessage << "Model " << name << ": " << levels.size() << " simplified levels";
+
+	for(size_t i = 0; i < levels.size(); ++i)
+		logMessage << (i == 0 ? " (" : ", ") << levels[i].triangleCount << " triangles within " << levels[i].error;
+
+	logMessage << (levels.size() > 0 ? ")." : ".");
+
+	gameSystem->log(GameSystem::LOG_VERBOSE, logMessage.str());
+}
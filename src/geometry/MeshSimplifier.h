@@ -0,0 +1,58 @@
+// MeshSimplifier.h
+// Dominicus
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "geometry/IndexedMesh.h"
+#include "geometry/Mesh.h"
+
+class MeshSimplifier {
+private:
+	// sum of squared distances to a set of planes, weighted by the area of
+	// the faces they came from (Garland and Heckbert, 1997)
+	struct Quadric {
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		Quadric() : a2(0.0), ab(0.0), ac(0.0), ad(0.0), b2(0.0), bc(0.0), bd(0.0), c2(0.0), cd(0.0), d2(0.0), weight(0.0) { }
+
+		void addPlane(double a, double b, double c, double d, double planeWeight);
+		void add(const Quadric& quadric);
+		double evaluate(const Vector3& point) const;
+	};
+
+	// moving one vertex onto a neighbour, ordered cheapest first
+	struct Collapse {
+		double cost;
+		unsigned int from, to;
+
+		bool operator < (const Collapse& collapse) const { return cost > collapse.cost; }
+	};
+
+public:
+	// a coarser version of the mesh, as element lists per group over the
+	// vertices of the indexed mesh it came from, and the root mean square
+	// distance its surface may have moved from the original
+	struct Level {
+		std::map< std::string,std::vector<unsigned int> > groupIndices;
+		size_t triangleCount;
+		float error;
+	};
+
+	std::vector<Level> levels;
+
+	// collapses edges (only ever onto existing vertices, so no new vertex
+	// data is needed) to produce up to levelCount levels, each with about
+	// reduction times the triangles of the one before; vertices on texture
+	// seams, mesh borders and group boundaries never move
+	MeshSimplifier(Mesh& mesh, IndexedMesh& indexedMesh, size_t levelCount, float reduction = 0.5f, size_t cacheSize = 16);
+
+	void logStatistics(std::string name);
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -8,11 +8,11 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "core/GameSystem.h"
 #include "geometry/Mesh.h"
 #include "graphics/GameGraphics.h"
-#include "graphics/texture/Texture.h"
 #include "graphics/UILayoutAuthority.h"
 #include "math/MatrixMath.h"
 #include "math/MiscMath.h"
@@ -30,6 +30,7 @@ DrawRadar::DrawRadar(DrawContainer* containerDrawer, DrawCircle* circleDrawer, D
 	// set up vertex buffers
 	glGenBuffers(1, &(vertexBuffers["vertices"]));
 	glGenBuffers(1, &(vertexBuffers["elements"]));
+	glGenBuffers(1, &(vertexBuffers["spots"]));
 
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
@@ -48,132 +49,64 @@ DrawRadar::DrawRadar(DrawContainer* containerDrawer, DrawCircle* circleDrawer, D
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elementBufferArray), elementBufferArray,
 			GL_STATIC_DRAW);
 
-	// zero out the texture IDs
-	radarTextureID = 0;
-	progressionTextureID = 0;
+	// zero out the texture ID
+	heightMapTextureID = 0;
 }
 
 DrawRadar::~DrawRadar() {
 	// delete textures
-	if(glIsTexture(radarTextureID))
-		glDeleteTextures(1, &radarTextureID);
-	if(glIsTexture(progressionTextureID))
-	glDeleteTextures(1, &progressionTextureID);
+	if(glIsTexture(heightMapTextureID))
+		glDeleteTextures(1, &heightMapTextureID);
 
 	// undo vertex buffer setup
 	glDeleteBuffers(1, &(vertexBuffers["vertices"]));
 	glDeleteBuffers(1, &(vertexBuffers["elements"]));
+	glDeleteBuffers(1, &(vertexBuffers["spots"]));
 }
 
 void DrawRadar::reloadState() {
-	// create a texture with the terrain heightmap for radar
-	size_t resolution = (size_t) gameSystem->getFloat("islandTerrainBaseDensity");
-	resolution *= (size_t) pow(2.0f, gameSystem->getFloat("islandTerrainDetail") - 1.0f);
-
-	Texture* radarTexture = new Texture(
-			resolution,
-			resolution,
-			Texture::FORMAT_RGBA
-		);
-
-	for(
-			std::vector<Mesh::Face>::iterator itr = gameState->island.faceGroups.begin()->second.begin();
-			itr != gameState->island.faceGroups.begin()->second.end();
-			++itr
-		) {
-		uint8_t colorValue, alphaValue;
-
-		if(gameState->island.vertices[itr->vertices[0]].y >= 0.0f) {
-			colorValue = (uint8_t) (
-					(gameState->island.vertices[itr->vertices[0]].y + gameSystem->getFloat("terrainDepth")) /
-					gameSystem->getFloat("islandMaximumHeight") * 255.0f);
-			alphaValue = 0xFF;
-//		} else if(gameState->island.vertices[itr->vertices[0]].y > -gameSystem->getFloat("terrainDepth")) {
-//			colorValue = 0;
-//			alphaValue = (gameState->island.vertices[itr->vertices[0]].y + gameSystem->getFloat("terrainDepth")) / gameSystem->getFloat("terrainDepth") * 0.5f * 0xFF;
-		} else {
-			colorValue = 0;
-			alphaValue = 0;
-		}
-
-		radarTexture->setColorAt(
-				(unsigned int) ((gameState->island.vertices[itr->vertices[0]].x / (gameSystem->getFloat("islandMaximumWidth") / 2.0f) / 2.0f + 0.5f) * (float) resolution),
-				(unsigned int) ((gameState->island.vertices[itr->vertices[0]].z / (gameSystem->getFloat("islandMaximumWidth") / 2.0f) / 2.0f + 0.5f) * (float) resolution),
-				colorValue,
-				colorValue,
-				colorValue,
-				alphaValue
-			);
-	}
-	radarTexture->setDepth(8);
-
-	glEnable(GL_TEXTURE_2D);
+	// upload the island heights (as a fraction of the maximum height above
+	// the sea floor), which the radar shader shades itself
+	size_t density = (size_t) gameSystem->getFloat("islandTerrainBaseDensity");
+	density *= (size_t) pow(2.0f, gameSystem->getFloat("islandTerrainDetail") - 1.0f);
 
-	if(glIsTexture(radarTextureID))
-		glDeleteTextures(1, &radarTextureID);
+	const float terrainDepth = gameSystem->getFloat("terrainDepth");
+	const float maximumHeight = gameSystem->getFloat("islandMaximumHeight");
 
-	glGenTextures(1, &radarTextureID);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, radarTextureID);
+	std::vector<uint8_t> heights(density * density);
 
-	glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			(radarTexture->format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
-			radarTexture->width,
-			radarTexture->height,
-			0,
-			(radarTexture->format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
-			GL_UNSIGNED_BYTE,
-			radarTexture->getDataPointer()
-	);
-
-	delete radarTexture;
-
-	// create the progression texture (next power of 2)
-	size_t textureDimension = pow(2.0f, (float) ((int) log2(gameSystem->getFloat("radarSize") / 100.0f * (float) gameGraphics->resolutionY - gameSystem->getFloat("hudGaugePadding") * 2.0f) + 1));
-	Texture progressionTexture(textureDimension, textureDimension, Texture::FORMAT_RGBA);
-	for(size_t i = 0; i < textureDimension; ++i) {
-		for(size_t p = 0; p < textureDimension; ++p) {
-			float pixelDistance = distance(
-					Vector2(textureDimension / 2, textureDimension / 2),
-					Vector2((float) i, (float) p)
-				);
-			float alphaValue = 127.0f;
+	for(size_t i = 0; i < density; ++i)
+		for(size_t p = 0; p < density; ++p)
+			heights[p * density + i] = (uint8_t) (maximum(minimum(
+					(gameState->island.vertices[i * density + p].y + terrainDepth) / maximumHeight,
+					1.0f), 0.0f) * 255.0f);
 
-			if(pixelDistance > textureDimension / 2)
-				alphaValue *= 0.0f;
-
-			else if(textureDimension / 2 - pixelDistance <= gameSystem->getFloat("hudContainerSoftEdge"))
-				alphaValue *= (textureDimension / 2 - pixelDistance) / gameSystem->getFloat("hudContainerSoftEdge");
-
-			alphaValue *= getAngle(Vector2((float) i, (float) p) - Vector2((float) textureDimension / 2.0f, (float) textureDimension / 2.0f)) / 360.0f;
-			progressionTexture.setColorAt(i, p, 0, 0, 0, (uint8_t) alphaValue);
-		}
-	}
-
-	if(glIsTexture(progressionTextureID))
-		glDeleteTextures(1, &progressionTextureID);
+	glEnable(GL_TEXTURE_2D);
 
-	glGenTextures(1, &progressionTextureID);
+	if(! glIsTexture(heightMapTextureID))
+		glGenTextures(1, &heightMapTextureID);
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, progressionTextureID);
+	glBindTexture(GL_TEXTURE_2D, heightMapTextureID);
 
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glTexImage2D(
 			GL_TEXTURE_2D,
 			0,
-			(progressionTexture.format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
-			progressionTexture.width,
-			progressionTexture.height,
+			GL_LUMINANCE,
+			density,
+			density,
 			0,
-			(progressionTexture.format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
+			GL_LUMINANCE,
 			GL_UNSIGNED_BYTE,
-			progressionTexture.getDataPointer()
+			&heights[0]
 	);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	// clear the missile cache
 	missileCache.clear();
@@ -229,32 +162,42 @@ void DrawRadar::execute(DrawStackArgList argList) {
 			*((float*) argList["padding"]) / (float) gameGraphics->resolutionY * 2.0f
 		);
 
-	// update vertex buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
+	// the radar quad covers the padded container, in units of the radar radius
+	Matrix4 radarMatrix;
+	radarMatrix.identity();
+
+	scaleMatrix(actualSize.x / 2.0f - padding.x, actualSize.y / 2.0f - padding.y, 1.0f, radarMatrix);
+	translateMatrix(metrics->position.x, metrics->position.y, 0.0f, radarMatrix);
 
-	// compute projection matrix for terrain height map
+	float radarMatrixArray[] = {
+			radarMatrix.m11, radarMatrix.m12, radarMatrix.m13, radarMatrix.m14,
+			radarMatrix.m21, radarMatrix.m22, radarMatrix.m23, radarMatrix.m24,
+			radarMatrix.m31, radarMatrix.m32, radarMatrix.m33, radarMatrix.m34,
+			radarMatrix.m41, radarMatrix.m42, radarMatrix.m43, radarMatrix.m44
+		};
+
+	// compute the mapping from the radar to height map texture coordinates
 	Matrix4 heightMapMatrix;
 	heightMapMatrix.identity();
 
-	translateMatrix(
-			-gameState->fortress.position.x / gameSystem->getFloat("islandMaximumWidth") * 2.0f,
-			-gameState->fortress.position.z / gameSystem->getFloat("islandMaximumWidth") * 2.0f,
-			0.0f,
+	scaleMatrix(
+			gameSystem->getFloat("radarRadius") / (gameSystem->getFloat("islandMaximumWidth") * 0.5f),
+			gameSystem->getFloat("radarRadius") / (gameSystem->getFloat("islandMaximumWidth") * 0.5f),
+			1.0f,
 			heightMapMatrix
 		);
-	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), -radians(90.0f), heightMapMatrix);
-	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), -radians(gameState->fortress.rotation), heightMapMatrix);
 
-	scaleMatrix(
-			gameSystem->getFloat("islandMaximumWidth") * 0.5f / gameSystem->getFloat("radarRadius"),
-			gameSystem->getFloat("islandMaximumWidth") * 0.5f / gameSystem->getFloat("radarRadius"),
-			1.0f,
+	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), radians(gameState->fortress.rotation), heightMapMatrix);
+	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), radians(90.0f), heightMapMatrix);
+	translateMatrix(
+			gameState->fortress.position.x / gameSystem->getFloat("islandMaximumWidth") * 2.0f,
+			gameState->fortress.position.z / gameSystem->getFloat("islandMaximumWidth") * 2.0f,
+			0.0f,
 			heightMapMatrix
 		);
-	scaleMatrix(actualSize.x / 2.0f - padding.x, actualSize.y / 2.0f - padding.y, 1.0f, heightMapMatrix);
 
-	translateMatrix(metrics->position.x, metrics->position.y, 0.0f, heightMapMatrix);
+	scaleMatrix(0.5f, 0.5f, 1.0f, heightMapMatrix);
+	translateMatrix(0.5f, 0.5f, 0.0f, heightMapMatrix);
 
 	float heightMapMatrixArray[] = {
 			heightMapMatrix.m11, heightMapMatrix.m12, heightMapMatrix.m13, heightMapMatrix.m14,
@@ -263,21 +206,18 @@ void DrawRadar::execute(DrawStackArgList argList) {
 			heightMapMatrix.m41, heightMapMatrix.m42, heightMapMatrix.m43, heightMapMatrix.m44
 		};
 
-	// compute projection matrix for progression indicator
-	Matrix4 progressionMatrix;
-	progressionMatrix.identity();
+	// compute the mapping from the radar to the sweep's frame
+	Matrix4 sweepMatrix;
+	sweepMatrix.identity();
 
-	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), -radians(90.0f), progressionMatrix);
-	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), -radians(gameState->fortress.rotation - gameState->lastUpdateGameTime / (gameSystem->getFloat("radarRefreshSpeed") * 1000.0f) * 360.0f), progressionMatrix);
+	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), radians(gameState->fortress.rotation - gameState->lastUpdateGameTime / (gameSystem->getFloat("radarRefreshSpeed") * 1000.0f) * 360.0f), sweepMatrix);
+	rotateMatrix(Vector3(0.0f, 0.0f, -1.0f), radians(90.0f), sweepMatrix);
 
-	scaleMatrix(actualSize.x / 2.0f - padding.x, actualSize.y / 2.0f - padding.y, 1.0f, progressionMatrix);
-	translateMatrix(metrics->position.x, metrics->position.y, 0.0f, progressionMatrix);
-
-	float progressionMatrixArray[] = {
-			progressionMatrix.m11, progressionMatrix.m12, progressionMatrix.m13, progressionMatrix.m14,
-			progressionMatrix.m21, progressionMatrix.m22, progressionMatrix.m23, progressionMatrix.m24,
-			progressionMatrix.m31, progressionMatrix.m32, progressionMatrix.m33, progressionMatrix.m34,
-			progressionMatrix.m41, progressionMatrix.m42, progressionMatrix.m43, progressionMatrix.m44
+	float sweepMatrixArray[] = {
+			sweepMatrix.m11, sweepMatrix.m12, sweepMatrix.m13, sweepMatrix.m14,
+			sweepMatrix.m21, sweepMatrix.m22, sweepMatrix.m23, sweepMatrix.m24,
+			sweepMatrix.m31, sweepMatrix.m32, sweepMatrix.m33, sweepMatrix.m34,
+			sweepMatrix.m41, sweepMatrix.m42, sweepMatrix.m43, sweepMatrix.m44
 		};
 
 	// state
@@ -286,60 +226,37 @@ void DrawRadar::execute(DrawStackArgList argList) {
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_DEPTH_TEST);
 	if(gameGraphics->supportsMultisampling) glDisable(GL_MULTISAMPLE);
-	glEnable(GL_SCISSOR_TEST);
-	glScissor(
-			(GLint) (((metrics->position.x - actualSize.x / 2.0f + padding.x) + 1.0f) / 2.0f * (float) gameGraphics->resolutionX),
-			(GLint) (((metrics->position.y - actualSize.y / 2.0f + padding.y) + 1.0f) / 2.0f * (float) gameGraphics->resolutionY),
-			(GLsizei) ((actualSize.x - padding.x * 2.0f) / 2.0f * (float) gameGraphics->resolutionX),
-			(GLsizei) ((actualSize.y - padding.y * 2.0f) / 2.0f * (float) gameGraphics->resolutionY)
-		);
+	glDisable(GL_SCISSOR_TEST);
 	glEnable(GL_TEXTURE_2D);
 
 	// enable shader
-	glUseProgram(gameGraphics->getProgramID("colorTexture"));
+	glUseProgram(gameGraphics->getProgramID("radar"));
 
 	// set uniforms
-	glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("colorTexture"), "mvpMatrix"), 1, GL_FALSE, heightMapMatrixArray);
-	glUniform1i(glGetUniformLocation(gameGraphics->getProgramID("colorTexture"), "texture"), 0);
+	glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("radar"), "mvpMatrix"), 1, GL_FALSE, radarMatrixArray);
+	glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("radar"), "heightMapMatrix"), 1, GL_FALSE, heightMapMatrixArray);
+	glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("radar"), "sweepMatrix"), 1, GL_FALSE, sweepMatrixArray);
+	glUniform1i(glGetUniformLocation(gameGraphics->getProgramID("radar"), "heightMap"), 0);
+	glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("radar"), "seaLevel"), gameSystem->getFloat("terrainDepth") / gameSystem->getFloat("islandMaximumHeight"));
+	glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("radar"), "radarPixelRadius"), (actualSize.y / 2.0f - padding.y) * (float) gameGraphics->resolutionY / 2.0f);
+	glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("radar"), "softEdge"), gameSystem->getFloat("hudContainerSoftEdge"));
+	glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("radar"), "sweepOpacity"), 0.5f);
 
 	// activate the texture
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, radarTextureID);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, heightMapTextureID);
 
 	// draw the data stored in GPU memory
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
 
-	glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "position"), 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*) 0);
-	glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "texCoord"), 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*) (3 * sizeof(GLfloat)));
-	glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "color"), 4, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*) (5 * sizeof(GLfloat)));
+	glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("radar"), "position"), 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid*) 0);
 
-	glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "position"));
-	glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "texCoord"));
-	glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "color"));
+	glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radar"), "position"));
 
 	glDrawElements(GL_QUADS, 4, GL_UNSIGNED_SHORT, NULL);
 
-	// also draw the progression texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, progressionTextureID);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("colorTexture"), "mvpMatrix"), 1, GL_FALSE, progressionMatrixArray);
-
-	glDrawElements(GL_QUADS, 4, GL_UNSIGNED_SHORT, NULL);
-
-	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "position"));
-	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "texCoord"));
-	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorTexture"), "color"));
-
-	// more state
-	glDisable(GL_SCISSOR_TEST);
+	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radar"), "position"));
 
 	// draw view triangle
 	Vector2 triangleSize(
@@ -438,13 +355,8 @@ void DrawRadar::execute(DrawStackArgList argList) {
 	drawerArguments["borderColor"] = (void*) &outsideColor;
 	drawerArguments["border"] = (void*) &border;
 
-	for(size_t i = 0; i < missileCache.size(); ++i) {
-		Vector4 missilePosition(
-				missileCache[i].position.x - gameState->fortress.position.x,
-				missileCache[i].position.z - gameState->fortress.position.z,
-				0.0f,
-				1.0f
-			);
+	// batch every spot into one draw, as a quad around each missile
+	if(missileCache.size() > 0) {
 		Matrix4 missileMatrix;
 		missileMatrix.identity();
 
@@ -460,11 +372,49 @@ void DrawRadar::execute(DrawStackArgList argList) {
 
 		translateMatrix(metrics->position.x, metrics->position.y, 0.0f, missileMatrix);
 
-		missilePosition = missilePosition * missileMatrix;
+		const float corners[] = { -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f };
+		std::vector<GLfloat> spotVertices;
+		spotVertices.reserve(missileCache.size() * 16);
 
-		spotPosition = Vector2(missilePosition.x / missilePosition.w, missilePosition.y / missilePosition.w);
+		for(size_t i = 0; i < missileCache.size(); ++i) {
+			Vector4 missilePosition(
+					missileCache[i].position.x - gameState->fortress.position.x,
+					missileCache[i].position.z - gameState->fortress.position.z,
+					0.0f,
+					1.0f
+				);
 
-		circleDrawer->execute(drawerArguments);
+			missilePosition = missilePosition * missileMatrix;
+
+			for(size_t p = 0; p < 4; ++p) {
+				spotVertices.push_back(missilePosition.x / missilePosition.w + corners[p * 2] * spotSize.x / 2.0f);
+				spotVertices.push_back(missilePosition.y / missilePosition.w + corners[p * 2 + 1] * spotSize.y / 2.0f);
+				spotVertices.push_back(corners[p * 2]);
+				spotVertices.push_back(corners[p * 2 + 1]);
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["spots"]);
+		glBufferData(GL_ARRAY_BUFFER, spotVertices.size() * sizeof(GLfloat), &spotVertices[0], GL_STREAM_DRAW);
+
+		glDisable(GL_TEXTURE_2D);
+
+		glUseProgram(gameGraphics->getProgramID("radarSpot"));
+
+		glUniform4f(glGetUniformLocation(gameGraphics->getProgramID("radarSpot"), "insideColor"), insideColor.x, insideColor.y, insideColor.z, insideColor.w);
+		glUniform4f(glGetUniformLocation(gameGraphics->getProgramID("radarSpot"), "outsideColor"), outsideColor.x, outsideColor.y, outsideColor.z, outsideColor.w);
+		glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("radarSpot"), "softEdge"), spotEdge / (gameSystem->getFloat("radarSpotSize") / 2.0f));
+
+		glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "position"), 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*) 0);
+		glVertexAttribPointer(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "spotCoord"), 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*) (2 * sizeof(GLfloat)));
+
+		glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "position"));
+		glEnableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "spotCoord"));
+
+		glDrawArrays(GL_QUADS, 0, missileCache.size() * 4);
+
+		glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "position"));
+		glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("radarSpot"), "spotCoord"));
 	}
 /*
 	// draw current missile positions for debugging
@@ -19,8 +19,7 @@ private:
 	std::vector<Missile> missileCache;
 	float lastRotation;
 
-	GLuint radarTextureID;
-	GLuint progressionTextureID;
+	GLuint heightMapTextureID;
 
 	DrawContainer* containerDrawer;
 	DrawCircle* circleDrawer;
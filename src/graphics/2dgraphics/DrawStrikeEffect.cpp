@@ -15,8 +15,23 @@ extern GameGraphics* gameGraphics;
 extern GameState* gameState;
 extern GameSystem* gameSystem;
 
+DrawStrikeEffect::DrawStrikeEffect() :
+		eventCursor(gameState != NULL ? gameState->getEventCount() : 0),
+		lastStrikeTime(0) { }
+
 void DrawStrikeEffect::execute(DrawStackArgList argList) {
-	float effectProgression = (float) (gameState->lastUpdateGameTime - gameState->lastStrikeTime) / (gameSystem->getFloat("hudStrikeEffectTime") * 1000.0f);
+	// note the latest strike since the last frame
+	if(eventCursor < gameState->getOldestEvent())
+		eventCursor = gameState->getOldestEvent();
+
+	for(; eventCursor < gameState->getEventCount(); ++eventCursor) {
+		const GameEvent& event = gameState->getEvent(eventCursor);
+
+		if(event.type == GameEvent::FORTRESS_STRUCK)
+			lastStrikeTime = event.time;
+	}
+
+	float effectProgression = (float) (gameState->lastUpdateGameTime - lastStrikeTime) / (gameSystem->getFloat("hudStrikeEffectTime") * 1000.0f);
 
 	if(effectProgression >= 1.0f)
 		return;
@@ -70,3 +85,9 @@ void DrawStrikeEffect::execute(DrawStackArgList argList) {
 	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("color"), "position"));
 	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("color"), "color"));
 }
+
+void DrawStrikeEffect::reloadState() {
+	// only show strikes from here on
+	eventCursor = (gameState != NULL ? gameState->getEventCount() : 0);
+	lastStrikeTime = 0;
+}
@@ -4,15 +4,25 @@
 #ifndef DRAWSTRIKEEFFECT_H
 #define DRAWSTRIKEEFFECT_H
 
+#include <cstdlib>
+
 #include "graphics/DrawTypes.h"
 #include "graphics/2dgraphics/DrawGrayOut.h"
 
 class DrawStrikeEffect : public DrawGrayOut {
+private:
+	size_t eventCursor;	// number of the next game state event to read
+	unsigned int lastStrikeTime;
+
 public:
+	DrawStrikeEffect();
+
 	DrawStackArgList instantiateArgList() { return DrawStackArgList(); }
 	void deleteArgList(DrawStackArgList argList) { }
 
 	void execute(DrawStackArgList argList);
+
+	void reloadState();
 };
 
 #endif // DRAWSTRIKEEFFECT_H
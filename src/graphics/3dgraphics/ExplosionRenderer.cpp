@@ -4,6 +4,7 @@
 #include "graphics/3dgraphics/ExplosionRenderer.h"
 
 #include "core/GameSystem.h"
+#include "geometry/IndexedMesh.h"
 #include "geometry/Sphere.h"
 #include "graphics/GameGraphics.h"
 #include "math/MatrixMath.h"
@@ -14,42 +15,40 @@ extern GameGraphics* gameGraphics;
 extern GameState* gameState;
 extern GameSystem* gameSystem;
 
-ExplosionRenderer::ExplosionRenderer() : sphere(makeSphere((size_t) gameSystem->getFloat("explosionSphereDensity"))) {
+ExplosionRenderer::ExplosionRenderer() :
+		sphere(makeSphere((size_t) gameSystem->getFloat("explosionSphereDensity"))),
+		eventCursor(gameState != NULL ? gameState->getEventCount() : 0) {
+	// deduplicate and reorder the geometry for vertex cache efficiency
+	IndexedMesh indexedMesh(sphere, true, false);
+	indexedMesh.logStatistics("explosion sphere", 6 * sizeof(GLfloat));
+
 	// set up vertex buffers
 	glGenBuffers(1, &(vertexBuffers["vertices"]));
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
 
-	GLfloat* vertDataBufferArray = new GLfloat[sphere.faceGroups[""].size() * 18];	// 3 vertices + 3 normals + 3 faces
+	GLfloat* vertDataBufferArray = new GLfloat[indexedMesh.vertices.size() * 6];	// 3 vertices + 3 normals
 
 	// insert the vertex attribute data
-	for(size_t i = 0; i < sphere.faceGroups[""].size(); ++i) {
-		for(size_t p = 0; p < 3; ++p) {
-			vertDataBufferArray[i * 18 + p * 6 + 0] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].x;
-			vertDataBufferArray[i * 18 + p * 6 + 1] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].y;
-			vertDataBufferArray[i * 18 + p * 6 + 2] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].z;
-
-			vertDataBufferArray[i * 18 + p * 6 + 3] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].x;
-			vertDataBufferArray[i * 18 + p * 6 + 4] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].y;
-			vertDataBufferArray[i * 18 + p * 6 + 5] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].z;
-		}
+	for(size_t i = 0; i < indexedMesh.vertices.size(); ++i) {
+		vertDataBufferArray[i * 6 + 0] = sphere.vertices[indexedMesh.vertices[i].vertex].x;
+		vertDataBufferArray[i * 6 + 1] = sphere.vertices[indexedMesh.vertices[i].vertex].y;
+		vertDataBufferArray[i * 6 + 2] = sphere.vertices[indexedMesh.vertices[i].vertex].z;
+
+		vertDataBufferArray[i * 6 + 3] = sphere.vertices[indexedMesh.vertices[i].normal].x;
+		vertDataBufferArray[i * 6 + 4] = sphere.vertices[indexedMesh.vertices[i].normal].y;
+		vertDataBufferArray[i * 6 + 5] = sphere.vertices[indexedMesh.vertices[i].normal].z;
 	}
 
-	glBufferData(GL_ARRAY_BUFFER, sphere.faceGroups[""].size() * 18 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, indexedMesh.vertices.size() * 6 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
 
 	delete[] vertDataBufferArray;
 
 	glGenBuffers(1, &(vertexBuffers["elements"]));
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
 
-	GLuint* vertElementBufferArray = new GLuint[sphere.faceGroups[""].size() * 3];
-
-	for(size_t i = 0; i < sphere.faceGroups[""].size() * 3; ++i) {
-		vertElementBufferArray[i] = i;
-	}
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexedMesh.groupIndices[""].size() * sizeof(GLuint), &(indexedMesh.groupIndices[""][0]), GL_STATIC_DRAW);
 
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.faceGroups[""].size() * 3 * sizeof(GLuint), vertElementBufferArray, GL_STATIC_DRAW);
-
-	delete[] vertElementBufferArray;
+	sphere.getBoundingSphere(&boundingCenter, &boundingRadius);
 }
 
 ExplosionRenderer::~ExplosionRenderer() {
@@ -78,104 +77,88 @@ void ExplosionRenderer::execute(DrawStackArgList arguments) {
 			++i;
 	}
 
-	i = 0;
-	while(i < gameState->missiles.size()) {
-		if(gameState->missiles[i].alive) {
-			bool isInCache = false;
+	// start explosions for missiles destroyed since the last frame
+	if(eventCursor < gameState->getOldestEvent())
+		eventCursor = gameState->getOldestEvent();
 
-			for(size_t p = 0; p < activeMissiles.size(); ++p) {
-				if(activeMissiles[p] == i) {
-					isInCache = true;
+	for(; eventCursor < gameState->getEventCount(); ++eventCursor) {
+		const GameEvent& event = gameState->getEvent(eventCursor);
 
-					break;
-				}
-			}
+		if(event.type == GameEvent::MISSILE_LAUNCHED || event.type == GameEvent::SHELL_FIRED)
+			continue;
 
-			if(! isInCache)
-				activeMissiles.push_back(i);
-		}
+		ExplodingMissile explodingMissile;
 
-		++i;
-	}
-
-	for(size_t i = 0; i < activeMissiles.size(); ++i) {
-		if(! gameState->missiles[activeMissiles[i]].alive) {
-			ExplodingMissile explodingMissile;
-
-			Explosion explosion;
-			explosion.beginTime = gameState->lastUpdateGameTime;
-			explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
-			explosion.radius = gameSystem->getFloat("explosionRadius");
-			explosion.position = gameState->missiles[activeMissiles[i]].position;
-			explosion.movement = Vector3(0.0f, 0.0f, 0.0f);
+		Explosion explosion;
+		explosion.beginTime = gameState->lastUpdateGameTime;
+		explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
+		explosion.radius = gameSystem->getFloat("explosionRadius");
+		explosion.position = event.position;
+		explosion.movement = Vector3(0.0f, 0.0f, 0.0f);
 
-			explodingMissile.explosions[0] = explosion;
+		explodingMissile.explosions[0] = explosion;
 
-			float baseBeginTime = gameSystem->getFloat("explosionDuration") * 0.25f * 1000.0f;
+		float baseBeginTime = gameSystem->getFloat("explosionDuration") * 0.25f * 1000.0f;
 
-			for(size_t p = 1; p < 9; ++p) {
-				explosion.beginTime = explodingMissile.explosions[0].beginTime;
-				explosion.beginTime += baseBeginTime * 0.5f + (float) rand() / (float) RAND_MAX * baseBeginTime;
+		for(size_t p = 1; p < 9; ++p) {
+			explosion.beginTime = explodingMissile.explosions[0].beginTime;
+			explosion.beginTime += baseBeginTime * 0.5f + (float) rand() / (float) RAND_MAX * baseBeginTime;
 
-				// don't draw every sphere every time
-				if(rand() % 3 < 2)
-					explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
-				else
-					explosion.duration = 0;
-
-				explosion.radius = gameSystem->getFloat("explosionRadius") * 0.75f;
-
-				explosion.position = explodingMissile.explosions[0].position;
-				explosion.position.x += gameSystem->getFloat("explosionRadius") * 0.25f * ((p - 1) % 4 < 2 ? -1.0f : 1.0f);
-				explosion.position.y += gameSystem->getFloat("explosionRadius") * 0.25f * ((p - 1) % 4 == 0 || (p - 1) % 4 == 3 ? -1.0f : 1.0f);
-				explosion.position.z += gameSystem->getFloat("explosionRadius") * 0.25f * (p < 5 ? -1.0f : 1.0f);
+			// don't draw every sphere every time
+			if(rand() % 3 < 2)
+				explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
+			else
+				explosion.duration = 0;
 
-				explosion.movement = Vector3(
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f)
-					);
+			explosion.radius = gameSystem->getFloat("explosionRadius") * 0.75f;
 
-				explosion.movement.norm();
-				explosion.movement *= explosion.radius;
+			explosion.position = explodingMissile.explosions[0].position;
+			explosion.position.x += gameSystem->getFloat("explosionRadius") * 0.25f * ((p - 1) % 4 < 2 ? -1.0f : 1.0f);
+			explosion.position.y += gameSystem->getFloat("explosionRadius") * 0.25f * ((p - 1) % 4 == 0 || (p - 1) % 4 == 3 ? -1.0f : 1.0f);
+			explosion.position.z += gameSystem->getFloat("explosionRadius") * 0.25f * (p < 5 ? -1.0f : 1.0f);
 
-				explodingMissile.explosions[p] = explosion;
-			}
+			explosion.movement = Vector3(
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f)
+				);
 
-			for(size_t p = 9; p < 73; ++p) {
-				explosion.beginTime = explodingMissile.explosions[(p - 9) / 8 + 1].beginTime;
-				explosion.beginTime += baseBeginTime * 0.5f + (float) rand() / (float) RAND_MAX * baseBeginTime;
+			explosion.movement.norm();
+			explosion.movement *= explosion.radius;
 
-				// don't draw every sphere every time
-				if(rand() % 10 < 3)
-					explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
-				else
-					explosion.duration = 0;
+			explodingMissile.explosions[p] = explosion;
+		}
 
-				explosion.radius = gameSystem->getFloat("explosionRadius") * 0.5f;
+		for(size_t p = 9; p < 73; ++p) {
+			explosion.beginTime = explodingMissile.explosions[(p - 9) / 8 + 1].beginTime;
+			explosion.beginTime += baseBeginTime * 0.5f + (float) rand() / (float) RAND_MAX * baseBeginTime;
 
-				explosion.position = explodingMissile.explosions[(p - 9) / 8 + 1].position;
-				explosion.position.x += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 4 < 2 ? -1.0f : 1.0f);
-				explosion.position.y += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 4 == 0 || (p - 1) % 4 == 3 ? -1.0f : 1.0f);
-				explosion.position.z += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 8 < 4 ? -1.0f : 1.0f);
+			// don't draw every sphere every time
+			if(rand() % 10 < 3)
+				explosion.duration = gameSystem->getFloat("explosionDuration") * 0.5f * 1000.0f;
+			else
+				explosion.duration = 0;
 
-				explosion.movement = Vector3(
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
-						(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f)
-					);
+			explosion.radius = gameSystem->getFloat("explosionRadius") * 0.5f;
 
-				explosion.movement.norm();
-				explosion.movement *= explosion.radius;
+			explosion.position = explodingMissile.explosions[(p - 9) / 8 + 1].position;
+			explosion.position.x += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 4 < 2 ? -1.0f : 1.0f);
+			explosion.position.y += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 4 == 0 || (p - 1) % 4 == 3 ? -1.0f : 1.0f);
+			explosion.position.z += gameSystem->getFloat("explosionRadius") * 0.1f * ((p - 9) % 8 < 4 ? -1.0f : 1.0f);
 
-				explodingMissile.explosions[p] = explosion;
-			}
+			explosion.movement = Vector3(
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f),
+					(float) rand() / (float) RAND_MAX * (rand() % 2 == 0 ? 1.0f : -1.0f)
+				);
 
-			explodingMissiles.push_back(explodingMissile);
+			explosion.movement.norm();
+			explosion.movement *= explosion.radius;
 
-			activeMissiles.erase(activeMissiles.begin() + i);
-			i = 0;
+			explodingMissile.explosions[p] = explosion;
 		}
+
+		explodingMissiles.push_back(explodingMissile);
 	}
 
 	// state
@@ -217,26 +200,6 @@ void ExplosionRenderer::execute(DrawStackArgList arguments) {
 			float progression =
 					(float) (gameState->lastUpdateGameTime - explodingMissiles[i].explosions[p].beginTime) /
 					(float) explodingMissiles[i].explosions[p].duration;
-			glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "progression"), progression);
-
-			Vector4 missilePosition(
-					explodingMissiles[i].explosions[p].position.x + explodingMissiles[i].explosions[p].movement.x * progression,
-					explodingMissiles[i].explosions[p].position.y + explodingMissiles[i].explosions[p].movement.y * progression,
-					explodingMissiles[i].explosions[p].position.z + explodingMissiles[i].explosions[p].movement.z * progression,
-					0.0f
-				);
-			missilePosition = missilePosition * gameGraphics->currentCamera->mvMatrix;
-			Vector4 fortressPosition(
-					gameState->fortress.position.x,
-					gameState->fortress.position.y,
-					gameState->fortress.position.z,
-					0.0f
-				);
-			fortressPosition = fortressPosition * gameGraphics->currentCamera->mvMatrix;
-			Vector4 fortressVector = fortressPosition - missilePosition;
-			glUniform3f(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "fortressVector"), fortressVector.x, fortressVector.y, fortressVector.z);
-
-			Matrix4 mvMatrix; mvMatrix.identity();
 
 			float scaleFactor;
 			if(progression <= 0.5f)
@@ -248,24 +211,31 @@ void ExplosionRenderer::execute(DrawStackArgList arguments) {
 
 			scaleFactor *= explodingMissiles[i].explosions[p].radius;
 
-			scaleMatrix(scaleFactor, scaleFactor, scaleFactor, mvMatrix);
+			Vector3 puffPosition = explodingMissiles[i].explosions[p].position + explodingMissiles[i].explosions[p].movement * progression;
+
+			if(! gameGraphics->isVisible(puffPosition + boundingCenter * scaleFactor, boundingRadius * scaleFactor))
+				continue;
+
+			glUniform1f(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "progression"), progression);
 
-			translateMatrix(
-					explodingMissiles[i].explosions[p].position.x + explodingMissiles[i].explosions[p].movement.x * progression,
-					explodingMissiles[i].explosions[p].position.y + explodingMissiles[i].explosions[p].movement.y * progression,
-					explodingMissiles[i].explosions[p].position.z + explodingMissiles[i].explosions[p].movement.z * progression,
-					mvMatrix
+			Vector4 missilePosition(puffPosition.x, puffPosition.y, puffPosition.z, 0.0f);
+			missilePosition = missilePosition * gameGraphics->currentCamera->mvMatrix;
+			Vector4 fortressPosition(
+					gameState->fortress.position.x,
+					gameState->fortress.position.y,
+					gameState->fortress.position.z,
+					0.0f
 				);
+			fortressPosition = fortressPosition * gameGraphics->currentCamera->mvMatrix;
+			Vector4 fortressVector = fortressPosition - missilePosition;
+			glUniform3f(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "fortressVector"), fortressVector.x, fortressVector.y, fortressVector.z);
+
+			Matrix3 rotation; rotation.identity();
+			Matrix4 mvMatrix = transformMatrix(Vector3(scaleFactor, scaleFactor, scaleFactor), rotation, puffPosition);
 
 			mvMatrix = mvMatrix * gameGraphics->currentCamera->mvMatrix;
 
-			float mvMatrixArray[] = {
-					mvMatrix.m11, mvMatrix.m12, mvMatrix.m13, mvMatrix.m14,
-					mvMatrix.m21, mvMatrix.m22, mvMatrix.m23, mvMatrix.m24,
-					mvMatrix.m31, mvMatrix.m32, mvMatrix.m33, mvMatrix.m34,
-					mvMatrix.m41, mvMatrix.m42, mvMatrix.m43, mvMatrix.m44
-				};
-			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "mvMatrix"), 1, GL_FALSE, mvMatrixArray);
+			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("explosion"), "mvMatrix"), 1, GL_FALSE, mvMatrix.getArray());
 
 			glDrawElements(GL_TRIANGLES, sphere.faceGroups[""].size() * 3, GL_UNSIGNED_INT, NULL);
 		}
@@ -276,7 +246,8 @@ void ExplosionRenderer::execute(DrawStackArgList arguments) {
 }
 
 void ExplosionRenderer::reloadState() {
-	// clear missile caches
-	activeMissiles.clear();
+	// clear missile caches, and only explode missiles destroyed from here on
+	// (a rebuilt renderer would otherwise replay the whole game's explosions)
+	eventCursor = (gameState != NULL ? gameState->getEventCount() : 0);
 	explodingMissiles.clear();
 }
@@ -15,7 +15,10 @@ class ExplosionRenderer : public BaseDrawNode {
 private:
 	Mesh sphere;
 
-	std::vector<size_t> activeMissiles;
+	Vector3 boundingCenter;
+	float boundingRadius;
+
+	size_t eventCursor;	// number of the next game state event to read
 
 	struct Explosion {
 		unsigned int beginTime;
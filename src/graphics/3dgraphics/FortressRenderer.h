@@ -6,11 +6,13 @@
 
 #include "geometry/Mesh.h"
 #include "graphics/DrawTypes.h"
+#include "graphics/3dgraphics/StructureModel.h"
 #include "math/VectorMath.h"
 
 class FortressRenderer : public BaseDrawNode {
 private:
 	Mesh fortressMesh;
+	StructureModel* fortressModel;
 
 public:
 	Vector3 turretOrigin;
@@ -6,10 +6,14 @@
 
 #include "geometry/Mesh.h"
 #include "graphics/DrawTypes.h"
+#include "math/VectorMath.h"
 
 class MissileRenderer : public BaseDrawNode {
 private:
-	Mesh missileMesh;
+	Mesh* missileMesh;
+
+	Vector3 boundingCenter;
+	float boundingRadius;
 
 public:
 	MissileRenderer();
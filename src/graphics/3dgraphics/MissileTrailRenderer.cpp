@@ -8,7 +8,9 @@
 #include <string>
 #include <vector>
 
+#include "core/AssetManager.h"
 #include "core/GameSystem.h"
+#include "geometry/IndexedMesh.h"
 #include "graphics/GameGraphics.h"
 #include "graphics/texture/Texture.h"
 #include "math/MatrixMath.h"
@@ -16,13 +18,14 @@
 #include "math/VectorMath.h"
 #include "state/GameState.h"
 
+extern AssetManager* assetManager;
 extern GameGraphics* gameGraphics;
 extern GameState* gameState;
 extern GameSystem* gameSystem;
 
 MissileTrailRenderer::MissileTrailRenderer() {
 	// initialize geometry with appropriate length
-	missileMesh = Mesh("trail");
+	missileMesh = *assetManager->getMesh("trail");
 
 	for(size_t i = 0; i < missileMesh.vertices.size(); ++i) {
 		missileMesh.vertices[i].x *= gameSystem->getFloat("missileTrailLength");
@@ -35,72 +38,52 @@ MissileTrailRenderer::MissileTrailRenderer() {
 
 	missileMesh.autoNormal();
 
+	missileMesh.getBoundingSphere(&boundingCenter, &boundingRadius);
+
+	// deduplicate and reorder the geometry for vertex cache efficiency
+	IndexedMesh indexedMesh(missileMesh);
+	indexedMesh.logStatistics("trail", 12 * sizeof(GLfloat));
+
 	// set up vertex buffers
 	glGenBuffers(1, &(vertexBuffers["vertices"]));
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
 
-	unsigned int totalFaces = 0;
-	for(
-			std::map<std::string, std::vector<Mesh::Face> >::iterator itr =
-					missileMesh.faceGroups.begin();
-			itr != missileMesh.faceGroups.end();
-			++itr
-		)
-		totalFaces += itr->second.size();
-
-	GLfloat* vertDataBufferArray = new GLfloat[totalFaces * 36];	// 3 vertices + 3 normals + 2 texcoords + 4 colors * 3 faces
-	unsigned int bufferIndex = 0;
+	GLfloat* vertDataBufferArray = new GLfloat[indexedMesh.vertices.size() * 12];	// 3 vertices + 3 normals + 2 texcoords + 4 colors
 
-	for(
-			std::map<std::string, std::vector<Mesh::Face> >::iterator itr =
-					missileMesh.faceGroups.begin();
-			itr != missileMesh.faceGroups.end();
-			++itr
-		) {
-		const unsigned int firstIndex = bufferIndex;
+	for(size_t i = 0; i < indexedMesh.vertices.size(); ++i) {
+		vertDataBufferArray[i * 12 + 0] = missileMesh.vertices[indexedMesh.vertices[i].vertex].x;
+		vertDataBufferArray[i * 12 + 1] = missileMesh.vertices[indexedMesh.vertices[i].vertex].y;
+		vertDataBufferArray[i * 12 + 2] = missileMesh.vertices[indexedMesh.vertices[i].vertex].z;
 
-		// insert the vertex attribute data
-		for(size_t i = 0; i < itr->second.size(); ++i) {
-			for(size_t p = 0; p < 3; ++p) {
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 0] = missileMesh.vertices[itr->second[i].vertices[p]].x;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 1] = missileMesh.vertices[itr->second[i].vertices[p]].y;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 2] = missileMesh.vertices[itr->second[i].vertices[p]].z;
+		vertDataBufferArray[i * 12 + 3] = missileMesh.normals[indexedMesh.vertices[i].normal].x;
+		vertDataBufferArray[i * 12 + 4] = missileMesh.normals[indexedMesh.vertices[i].normal].y;
+		vertDataBufferArray[i * 12 + 5] = missileMesh.normals[indexedMesh.vertices[i].normal].z;
 
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 3] = missileMesh.normals[itr->second[i].normals[p]].x;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 4] = missileMesh.normals[itr->second[i].normals[p]].y;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 5] = missileMesh.normals[itr->second[i].normals[p]].z;
+		vertDataBufferArray[i * 12 + 6] = missileMesh.texCoords[indexedMesh.vertices[i].texCoord].x;
+		vertDataBufferArray[i * 12 + 7] = missileMesh.texCoords[indexedMesh.vertices[i].texCoord].y;
 
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 6] = missileMesh.texCoords[itr->second[i].texCoords[p]].x;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 7] = missileMesh.texCoords[itr->second[i].texCoords[p]].y;
+		vertDataBufferArray[i * 12 + 8] = 1.0f;
+		vertDataBufferArray[i * 12 + 9] = 1.0f;
+		vertDataBufferArray[i * 12 + 10] = 1.0f;
+		vertDataBufferArray[i * 12 + 11] = (1.0f + missileMesh.vertices[indexedMesh.vertices[i].vertex].x / gameSystem->getFloat("missileTrailLength"));
+	}
 
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 8] = 1.0f;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 9] = 1.0f;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 10] = 1.0f;
-				vertDataBufferArray[bufferIndex * 36 + p * 12 + 11] = (1.0f + missileMesh.vertices[itr->second[i].vertices[p]].x / gameSystem->getFloat("missileTrailLength"));
-			}
+	glBufferData(GL_ARRAY_BUFFER, indexedMesh.vertices.size() * 12 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
 
-			++bufferIndex;
-		}
+	delete[] vertDataBufferArray;
 
+	for(
+			std::map< std::string,std::vector<unsigned int> >::iterator itr =
+					indexedMesh.groupIndices.begin();
+			itr != indexedMesh.groupIndices.end();
+			++itr
+		) {
 		glGenBuffers(1, &(vertexBuffers[std::string("elements_" + itr->first).c_str()]));
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers[std::string("elements_" + itr->first).c_str()]);
 
-		GLuint* vertElementBufferArray = new GLuint[itr->second.size() * 3];
-
-		for(size_t i = 0; i < itr->second.size() * 3; ++i) {
-			vertElementBufferArray[i] = firstIndex * 3 + i;
-		}
-
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, itr->second.size() * 3 * sizeof(GLuint), vertElementBufferArray,
-				GL_STATIC_DRAW);
-
-		delete[] vertElementBufferArray;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, itr->second.size() * sizeof(GLuint), &(itr->second[0]), GL_STATIC_DRAW);
 	}
 
-	glBufferData(GL_ARRAY_BUFFER, totalFaces * 36 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
-
-	delete[] vertDataBufferArray;
-
 	// send the noise texture
 	glEnable(GL_TEXTURE_2D);
 
@@ -126,8 +109,12 @@ MissileTrailRenderer::MissileTrailRenderer() {
 
 MissileTrailRenderer::~MissileTrailRenderer() {
 	// undo vertex buffer setup
-	glDeleteBuffers(1, &(vertexBuffers["vertices"]));
-	glDeleteBuffers(1, &(vertexBuffers["elements"]));
+	for(
+			std::map<std::string, GLuint>::iterator itr = vertexBuffers.begin();
+			itr != vertexBuffers.end();
+			++itr
+		)
+		glDeleteBuffers(1, &(itr->second));
 }
 
 void MissileTrailRenderer::execute(DrawStackArgList arguments) {
@@ -166,20 +153,21 @@ void MissileTrailRenderer::execute(DrawStackArgList arguments) {
 			continue;
 
 		// calculate the matrix for this missile trail position
-		Matrix4 mvMatrix; mvMatrix.identity();
+		Vector3 scale(1.0f, 1.0f, 1.0f);
 		if(gameState->missiles[i].position.y - gameSystem->getFloat("missileTrailLength") < 0.0f)
-			scaleMatrix(gameState->missiles[i].position.y / gameSystem->getFloat("missileTrailLength"), 1.0f, 1.0f, mvMatrix);
-		rotateMatrix(Vector3(0.0f, 0.0f, 1.0f), radians(gameState->missiles[i].tilt), mvMatrix);
-		rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), radians(gameState->missiles[i].rotation), mvMatrix);
-		translateMatrix(gameState->missiles[i].position.x, gameState->missiles[i].position.y, gameState->missiles[i].position.z, mvMatrix);
-		mvMatrix = mvMatrix * gameGraphics->currentCamera->mvMatrix;
+			scale.x = gameState->missiles[i].position.y / gameSystem->getFloat("missileTrailLength");
+		Matrix3 rotation; rotation.identity();
+		rotateMatrix(Vector3(0.0f, 0.0f, 1.0f), radians(gameState->missiles[i].tilt), rotation);
+		rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), radians(gameState->missiles[i].rotation), rotation);
+		Matrix4 mvMatrix = transformMatrix(scale, rotation, gameState->missiles[i].position);
+
+		// a trail is only ever shortened, so its full radius still covers it
+		Vector4 center = Vector4(boundingCenter.x, boundingCenter.y, boundingCenter.z, 1.0f) * mvMatrix;
 
-		float mvMatrixArray[] = {
-				mvMatrix.m11, mvMatrix.m12, mvMatrix.m13, mvMatrix.m14,
-				mvMatrix.m21, mvMatrix.m22, mvMatrix.m23, mvMatrix.m24,
-				mvMatrix.m31, mvMatrix.m32, mvMatrix.m33, mvMatrix.m34,
-				mvMatrix.m41, mvMatrix.m42, mvMatrix.m43, mvMatrix.m44
-			};
+		if(! gameGraphics->isVisible(Vector3(center.x, center.y, center.z), boundingRadius))
+			continue;
+
+		mvMatrix = mvMatrix * gameGraphics->currentCamera->mvMatrix;
 
 		// set the texture
 		glActiveTexture(GL_TEXTURE0);
@@ -190,7 +178,7 @@ void MissileTrailRenderer::execute(DrawStackArgList arguments) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("missileTrail"), "mvMatrix"), 1, GL_FALSE, mvMatrixArray);
+			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("missileTrail"), "mvMatrix"), 1, GL_FALSE, mvMatrix.getArray());
 			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("missileTrail"), "pMatrix"), 1, GL_FALSE, (gameState->binoculars ? gameGraphics->ppBinoMatrixArray : gameGraphics->ppMatrixArray));
 
 		// draw the geometry
@@ -6,12 +6,16 @@
 
 #include "geometry/Mesh.h"
 #include "graphics/DrawTypes.h"
+#include "math/VectorMath.h"
 #include "platform/OpenGLHeaders.h"
 
 class MissileTrailRenderer : public BaseDrawNode {
 private:
 	Mesh missileMesh;
 
+	Vector3 boundingCenter;
+	float boundingRadius;
+
 	GLuint noiseTextureID;
 
 public:
@@ -3,9 +3,13 @@
 
 #include "graphics/3dgraphics/ShellRenderer.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <vector>
 
 #include "core/GameSystem.h"
+#include "geometry/IndexedMesh.h"
 #include "geometry/Sphere.h"
 #include "graphics/GameGraphics.h"
 #include "math/MatrixMath.h"
@@ -17,56 +21,103 @@ extern GameGraphics* gameGraphics;
 extern GameState* gameState;
 extern GameSystem* gameSystem;
 
-ShellRenderer::ShellRenderer() : sphere(makeSphere((size_t) gameSystem->getFloat("shellDensity"))) {
+ShellRenderer::ShellRenderer() :
+		sphere(makeSphere((size_t) gameSystem->getFloat("shellDensity"))),
+		impostorCapacity(0) {
+	// deduplicate and reorder the geometry for vertex cache efficiency
+	IndexedMesh indexedMesh(sphere, true, false);
+	indexedMesh.logStatistics("shell sphere", 10 * sizeof(GLfloat));
+
 	// set up vertex buffers
 	glGenBuffers(1, &(vertexBuffers["vertices"]));
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["vertices"]);
 
-	GLfloat* vertDataBufferArray = new GLfloat[sphere.faceGroups[""].size() * 30];	// 3 vertices + 3 normals + 4 colors * 3 faces
+	GLfloat* vertDataBufferArray = new GLfloat[indexedMesh.vertices.size() * 10];	// 3 vertices + 3 normals + 4 colors
 
 	// insert the vertex attribute data
-	for(size_t i = 0; i < sphere.faceGroups[""].size(); ++i) {
-		for(size_t p = 0; p < 3; ++p) {
-			vertDataBufferArray[i * 30 + p * 10 + 0] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].x;
-			vertDataBufferArray[i * 30 + p * 10 + 1] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].y;
-			vertDataBufferArray[i * 30 + p * 10 + 2] = sphere.vertices[sphere.faceGroups[""][i].vertices[p]].z;
-
-			vertDataBufferArray[i * 30 + p * 10 + 3] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].x;
-			vertDataBufferArray[i * 30 + p * 10 + 4] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].y;
-			vertDataBufferArray[i * 30 + p * 10 + 5] = sphere.vertices[sphere.faceGroups[""][i].normals[p]].z;
-
-			vertDataBufferArray[i * 30 + p * 10 + 6] = 1.0f;
-			vertDataBufferArray[i * 30 + p * 10 + 7] = 1.0f;
-			vertDataBufferArray[i * 30 + p * 10 + 8] = 1.0f;
-			vertDataBufferArray[i * 30 + p * 10 + 9] = 1.0f;
-		}
+	for(size_t i = 0; i < indexedMesh.vertices.size(); ++i) {
+		vertDataBufferArray[i * 10 + 0] = sphere.vertices[indexedMesh.vertices[i].vertex].x;
+		vertDataBufferArray[i * 10 + 1] = sphere.vertices[indexedMesh.vertices[i].vertex].y;
+		vertDataBufferArray[i * 10 + 2] = sphere.vertices[indexedMesh.vertices[i].vertex].z;
+
+		vertDataBufferArray[i * 10 + 3] = sphere.vertices[indexedMesh.vertices[i].normal].x;
+		vertDataBufferArray[i * 10 + 4] = sphere.vertices[indexedMesh.vertices[i].normal].y;
+		vertDataBufferArray[i * 10 + 5] = sphere.vertices[indexedMesh.vertices[i].normal].z;
+
+		vertDataBufferArray[i * 10 + 6] = 1.0f;
+		vertDataBufferArray[i * 10 + 7] = 1.0f;
+		vertDataBufferArray[i * 10 + 8] = 1.0f;
+		vertDataBufferArray[i * 10 + 9] = 1.0f;
 	}
 
-	glBufferData(GL_ARRAY_BUFFER, sphere.faceGroups[""].size() * 30 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, indexedMesh.vertices.size() * 10 * sizeof(GLfloat), vertDataBufferArray, GL_STATIC_DRAW);
 
 	delete[] vertDataBufferArray;
 
 	glGenBuffers(1, &(vertexBuffers["elements"]));
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
 
-	GLuint* vertElementBufferArray = new GLuint[sphere.faceGroups[""].size() * 3];
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexedMesh.groupIndices[""].size() * sizeof(GLuint), &(indexedMesh.groupIndices[""][0]), GL_STATIC_DRAW);
 
-	for(size_t i = 0; i < sphere.faceGroups[""].size() * 3; ++i) {
-		vertElementBufferArray[i] = i;
-	}
-
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphere.faceGroups[""].size() * 3 * sizeof(GLuint), vertElementBufferArray, GL_STATIC_DRAW);
+	sphere.getBoundingSphere(&boundingCenter, &boundingRadius);
 
-	delete[] vertElementBufferArray;
+	// sprites are streamed in each frame
+	glGenBuffers(1, &(vertexBuffers["impostorVertices"]));
+	glGenBuffers(1, &(vertexBuffers["impostorElements"]));
 }
 
 ShellRenderer::~ShellRenderer() {
 	// undo vertex buffer setup
 	glDeleteBuffers(1, &(vertexBuffers["vertices"]));
 	glDeleteBuffers(1, &(vertexBuffers["elements"]));
+	glDeleteBuffers(1, &(vertexBuffers["impostorVertices"]));
+	glDeleteBuffers(1, &(vertexBuffers["impostorElements"]));
 }
 
 void ShellRenderer::execute(DrawStackArgList arguments) {
+	// most shells are a few pixels across, so they're drawn together as
+	// sprites shaded like spheres; only those close enough to show the
+	// difference (or whose sprite could reach the near plane) use the mesh
+	const Matrix4& pMatrix = (gameState->binoculars ? gameGraphics->ppBinoMatrix : gameGraphics->ppMatrix);
+	float pixelsPerUnit = pMatrix.m22 * gameGraphics->resolutionY / 2.0f;
+	float maximumImpostorSize = gameSystem->getFloat("shellImpostorMaximumSize");
+	float nearClip = gameSystem->getFloat("renderingPerspectiveNearClip");
+
+	std::vector<size_t> sphereShells, impostorShells;
+
+	for(size_t i = 0; i < gameState->shells.size(); ++i) {
+		Vector3 center = gameState->shells[i].position + boundingCenter * gameState->shellRadius;
+		float radius = boundingRadius * gameState->shellRadius;
+
+		if(! gameGraphics->isVisible(center, radius))
+			continue;
+
+		Vector4 eyeCenter = Vector4(center.x, center.y, center.z, 1.0f) * gameGraphics->currentCamera->mvMatrix;
+		float depth = eyeCenter.z;
+
+		// the sprite reaches this far from the center (as sized in its vertex
+		// shader), which is never less than the radius of the sphere itself
+		float centerDistance = mag(Vector3(eyeCenter.x, eyeCenter.y, eyeCenter.z));
+		float extent = (centerDistance > radius ? radius * centerDistance / sqrt(centerDistance * centerDistance - radius * radius) : 0.0f);
+
+		if(
+				centerDistance <= radius ||
+				depth - extent <= nearClip ||
+				radius * pixelsPerUnit / depth > maximumImpostorSize
+			)
+			sphereShells.push_back(i);
+		else
+			impostorShells.push_back(i);
+	}
+
+	if(sphereShells.size() > 0)
+		drawSpheres(sphereShells);
+
+	if(impostorShells.size() > 0)
+		drawImpostors(impostorShells);
+}
+
+void ShellRenderer::drawSpheres(const std::vector<size_t>& shells) {
 	// state
 	glDisable(GL_BLEND);
 	glEnable(GL_CULL_FACE);
@@ -102,20 +153,14 @@ void ShellRenderer::execute(DrawStackArgList arguments) {
 	// draw the geometry
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["elements"]);
 
-	for(size_t i = 0; i < gameState->shells.size(); ++i) {
-		Matrix4 mvMatrix; mvMatrix.identity();
-		scaleMatrix(gameState->shellRadius, gameState->shellRadius, gameState->shellRadius, mvMatrix);
-		translateMatrix(gameState->shells[i].position.x, gameState->shells[i].position.y, gameState->shells[i].position.z, mvMatrix);
-		mvMatrix = mvMatrix * gameGraphics->currentCamera->mvMatrix;
+	for(size_t i = 0; i < shells.size(); ++i) {
+		const Shell& shell = gameState->shells[shells[i]];
 
-		float mvMatrixArray[] = {
-				mvMatrix.m11, mvMatrix.m12, mvMatrix.m13, mvMatrix.m14,
-				mvMatrix.m21, mvMatrix.m22, mvMatrix.m23, mvMatrix.m24,
-				mvMatrix.m31, mvMatrix.m32, mvMatrix.m33, mvMatrix.m34,
-				mvMatrix.m41, mvMatrix.m42, mvMatrix.m43, mvMatrix.m44
-			};
+		Matrix3 rotation; rotation.identity();
+		Matrix4 mvMatrix = transformMatrix(Vector3(gameState->shellRadius, gameState->shellRadius, gameState->shellRadius), rotation, shell.position);
+		mvMatrix = mvMatrix * gameGraphics->currentCamera->mvMatrix;
 
-			glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("colorLighting"), "mvMatrix"), 1, GL_FALSE, mvMatrixArray);
+		glUniformMatrix4fv(glGetUniformLocation(gameGraphics->getProgramID("colorLighting"), "mvMatrix"), 1, GL_FALSE, mvMatrix.getArray());
 
 		glDrawElements(GL_TRIANGLES, sphere.faceGroups[""].size() * 3, GL_UNSIGNED_INT, NULL);
 	}
@@ -124,3 +169,90 @@ void ShellRenderer::execute(DrawStackArgList arguments) {
 	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorLighting"), "normal"));
 	glDisableVertexAttribArray(glGetAttribLocation(gameGraphics->getProgramID("colorLighting"), "color"));
 }
+
+void ShellRenderer::drawImpostors(const std::vector<size_t>& shells) {
+	// fill the sprite corners (3 center + 2 corner)
+	std::vector<GLfloat> vertexData;
+	vertexData.reserve(shells.size() * 4 * 5);
+
+	const float corners[] = {
+			-1.0f, -1.0f,
+			1.0f, -1.0f,
+			1.0f, 1.0f,
+			-1.0f, 1.0f
+		};
+
+	for(size_t i = 0; i < shells.size(); ++i) {
+		const Shell& shell = gameState->shells[shells[i]];
+
+		for(size_t p = 0; p < 4; ++p) {
+			vertexData.push_back(shell.position.x);
+			vertexData.push_back(shell.position.y);
+			vertexData.push_back(shell.position.z);
+
+			vertexData.push_back(corners[p * 2]);
+			vertexData.push_back(corners[p * 2 + 1]);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers["impostorVertices"]);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(GLfloat), &vertexData[0], GL_STREAM_DRAW);
+
+	// the quad elements never change, so they only need to grow
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vertexBuffers["impostorElements"]);
+
+	if(shells.size() > impostorCapacity) {
+		impostorCapacity = std::max(shells.size(), impostorCapacity * 2);
+
+		std::vector<GLuint> elements;
+		elements.reserve(impostorCapacity * 6);
+
+		for(size_t i = 0; i < impostorCapacity; ++i) {
+			elements.push_back(i * 4 + 0);
+			elements.push_back(i * 4 + 1);
+			elements.push_back(i * 4 + 2);
+			elements.push_back(i * 4 + 0);
+			elements.push_back(i * 4 + 2);
+			elements.push_back(i * 4 + 3);
+		}
+
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(GLuint), &elements[0], GL_STATIC_DRAW);
+	}
+
+	// state
+	glDisable(GL_BLEND);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	if(gameGraphics->supportsMultisampling) glEnable(GL_MULTISAMPLE);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_TEXTURE_2D);
+
+	// enable shader
+	GLuint programID = gameGraphics->getProgramID("shellImpostor");
+	glUseProgram(programID);
+
+	// set uniforms
+	const Matrix4& mvMatrix = gameGraphics->currentCamera->mvMatrix;
+
+	glUniformMatrix4fv(glGetUniformLocation(programID, "mvMatrix"), 1, GL_FALSE, mvMatrix.getArray());
+	glUniformMatrix4fv(glGetUniformLocation(programID, "pMatrix"), 1, GL_FALSE, (gameState->binoculars ? gameGraphics->ppBinoMatrixArray : gameGraphics->ppMatrixArray));
+	glUniform1f(glGetUniformLocation(programID, "radius"), boundingRadius * gameState->shellRadius);
+	glUniform3f(glGetUniformLocation(programID, "ambientColor"), 0.15f, 0.15f, 0.15f);
+	glUniform3f(glGetUniformLocation(programID, "diffuseColor"), 0.5f, 0.5f, 0.5f);
+	glUniform3f(glGetUniformLocation(programID, "specularColor"), 0.5f, 0.5f, 0.5f);
+	Vector4 lightPosition = Vector4(1.0f, 1.0f, -1.0f, 0.0f) * gameGraphics->currentCamera->lightMatrix;
+	glUniform3f(glGetUniformLocation(programID, "lightPosition"), lightPosition.x, lightPosition.y, lightPosition.z);
+	glUniform1f(glGetUniformLocation(programID, "shininess"), 50.0f);
+
+	// draw every sprite at once
+	glVertexAttribPointer(glGetAttribLocation(programID, "center"), 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*) 0);
+	glVertexAttribPointer(glGetAttribLocation(programID, "corner"), 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*) (3 * sizeof(GLfloat)));
+
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "center"));
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "corner"));
+
+	glDrawElements(GL_TRIANGLES, shells.size() * 6, GL_UNSIGNED_INT, NULL);
+
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "center"));
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "corner"));
+}
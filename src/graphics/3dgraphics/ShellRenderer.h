@@ -4,14 +4,27 @@
 #ifndef SHELLRENDERER_H
 #define SHELLRENDERER_H
 
+#include <cstdlib>
+#include <vector>
+
 #include "geometry/Mesh.h"
 #include "graphics/DrawTypes.h"
+#include "math/VectorMath.h"
 
 class ShellRenderer : public BaseDrawNode {
 private:
 	// internal model data
 	Mesh sphere;
 
+	Vector3 boundingCenter;
+	float boundingRadius;
+
+	// how many shells the sprite element buffer has room for
+	size_t impostorCapacity;
+
+	void drawSpheres(const std::vector<size_t>& shells);
+	void drawImpostors(const std::vector<size_t>& shells);
+
 public:
 	ShellRenderer();
 	~ShellRenderer();
@@ -6,10 +6,16 @@
 
 #include "geometry/Mesh.h"
 #include "graphics/DrawTypes.h"
+#include "graphics/3dgraphics/StructureModel.h"
+#include "math/VectorMath.h"
 
 class ShipRenderer : public BaseDrawNode {
 private:
-	Mesh shipMesh;
+	Mesh* shipMesh;
+	StructureModel* shipModel;
+
+	Vector3 boundingCenter;
+	float boundingRadius;
 
 public:
 	ShipRenderer();
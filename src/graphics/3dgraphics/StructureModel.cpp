@@ -0,0 +1,273 @@
+// StructureModel.cpp
+// Dominicus
+
+#include "graphics/3dgraphics/StructureModel.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "core/GameSystem.h"
+#include "geometry/IndexedMesh.h"
+#include "geometry/MeshSimplifier.h"
+#include "graphics/GameGraphics.h"
+#include "math/VectorMath.h"
+#include "state/GameState.h"
+
+extern GameGraphics* gameGraphics;
+extern GameState* gameState;
+extern GameSystem* gameSystem;
+
+StructureModel::StructureModel(std::string name, Mesh& mesh, std::vector<Group> groups, GLint minFilter, GLint magFilter) :
+		name(name),
+		partCount(1),
+		vertexBufferID(0),
+		elementBufferID(0),
+		minFilter(minFilter),
+		magFilter(magFilter) {
+	// deduplicate and reorder the geometry for vertex cache efficiency
+	IndexedMesh indexedMesh(mesh);
+	indexedMesh.logStatistics(name, 14 * sizeof(GLfloat));
+
+	// one array layer per distinct texture, in order of first use
+	for(size_t i = 0; i < groups.size(); ++i) {
+		if(std::find(layerTextures.begin(), layerTextures.end(), groups[i].texture) == layerTextures.end())
+			layerTextures.push_back(groups[i].texture);
+
+		if(groups[i].part >= maxParts)
+			gameSystem->log(GameSystem::LOG_FATAL, "Model " + name + " has too many separately transformed parts.");
+
+		partCount = std::max(partCount, groups[i].part + 1);
+	}
+
+	// coarser levels of detail only use vertices of the full one
+	MeshSimplifier simplifier(mesh, indexedMesh, (size_t) gameSystem->getFloat("renderingModelDetailLevels"));
+	simplifier.logStatistics(name);
+
+	mesh.getBoundingSphere(&boundingCenter, &boundingRadius);
+
+	std::vector<std::map< std::string,std::vector<unsigned int> >*> levelIndices(1, &indexedMesh.groupIndices);
+	std::vector<float> levelErrors(1, 0.0f);
+
+	for(size_t i = 0; i < simplifier.levels.size(); ++i) {
+		levelIndices.push_back(&simplifier.levels[i].groupIndices);
+		levelErrors.push_back(simplifier.levels[i].error);
+	}
+
+	// gather every group of every level into one element buffer, giving a
+	// group its own copy of any vertex it shares with a group of another
+	// texture or part
+	std::vector<GLfloat> vertexData;
+	std::vector<GLuint> elements;
+	std::map<std::pair<unsigned int, unsigned int>, GLuint> vertexCopies;
+
+	for(size_t l = 0; l < levelIndices.size(); ++l) {
+		Level level;
+		level.offset = elements.size();
+		level.error = levelErrors[l];
+
+		for(size_t i = 0; i < groups.size(); ++i) {
+			std::map< std::string,std::vector<unsigned int> >::iterator groupItr =
+					levelIndices[l]->find(groups[i].name);
+
+			if(groupItr == levelIndices[l]->end())
+				gameSystem->log(GameSystem::LOG_FATAL, "Model " + name + " has no face group " + groups[i].name + ".");
+
+			unsigned int layer = std::find(layerTextures.begin(), layerTextures.end(), groups[i].texture) - layerTextures.begin();
+
+			if(level.ranges.size() > 0 && level.ranges.back().texture == groups[i].texture && level.ranges.back().part == groups[i].part) {
+				level.ranges.back().count += groupItr->second.size();
+			} else {
+				Range range;
+				range.texture = groups[i].texture;
+				range.part = groups[i].part;
+				range.offset = elements.size();
+				range.count = groupItr->second.size();
+				level.ranges.push_back(range);
+			}
+
+			for(size_t p = 0; p < groupItr->second.size(); ++p) {
+				std::pair<unsigned int, unsigned int> key(groupItr->second[p], layer * maxParts + groups[i].part);
+				std::map<std::pair<unsigned int, unsigned int>, GLuint>::iterator copyItr = vertexCopies.find(key);
+
+				if(copyItr != vertexCopies.end()) {
+					elements.push_back(copyItr->second);
+
+					continue;
+				}
+
+				const IndexedMesh::Vertex& vertex = indexedMesh.vertices[groupItr->second[p]];
+				GLuint element = vertexData.size() / 14;
+
+				vertexData.push_back(mesh.vertices[vertex.vertex].x);
+				vertexData.push_back(mesh.vertices[vertex.vertex].y);
+				vertexData.push_back(mesh.vertices[vertex.vertex].z);
+
+				vertexData.push_back(mesh.normals[vertex.normal].x);
+				vertexData.push_back(mesh.normals[vertex.normal].y);
+				vertexData.push_back(mesh.normals[vertex.normal].z);
+
+				vertexData.push_back(mesh.texCoords[vertex.texCoord].x);
+				vertexData.push_back(mesh.texCoords[vertex.texCoord].y);
+
+				vertexData.push_back(1.0f);
+				vertexData.push_back(1.0f);
+				vertexData.push_back(1.0f);
+				vertexData.push_back(1.0f);
+
+				vertexData.push_back((GLfloat) layer);
+				vertexData.push_back((GLfloat) groups[i].part);
+
+				vertexCopies[key] = element;
+				elements.push_back(element);
+			}
+		}
+
+		level.count = elements.size() - level.offset;
+		levels.push_back(level);
+	}
+
+	if(elements.size() == 0)
+		return;
+
+	// set up vertex buffers (3 vertices + 3 normals + 2 texcoords + 4 colors
+	// + layer + part)
+	glGenBuffers(1, &vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(GLfloat), &vertexData[0], GL_STATIC_DRAW);
+
+	glGenBuffers(1, &elementBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(GLuint), &elements[0], GL_STATIC_DRAW);
+}
+
+StructureModel::~StructureModel() {
+	// undo vertex buffer setup
+	if(vertexBufferID != 0)
+		glDeleteBuffers(1, &vertexBufferID);
+
+	if(elementBufferID != 0)
+		glDeleteBuffers(1, &elementBufferID);
+}
+
+void StructureModel::draw(const std::vector<Matrix4>& mvMatrices) {
+	size_t copyCount = mvMatrices.size() / partCount;
+
+	if(copyCount == 0 || levels.size() == 0 || levels[0].count == 0)
+		return;
+
+	// choose each copy's level of detail by how many pixels its error could
+	// cover at the nearest point of the copy, under the current projection
+	const Matrix4& pMatrix = (gameState->binoculars ? gameGraphics->ppBinoMatrix : gameGraphics->ppMatrix);
+	float pixelsPerUnit = pMatrix.m22 * gameGraphics->resolutionY / 2.0f;
+	float maximumError = gameSystem->getFloat("renderingModelDetailError");
+	std::vector<size_t> copyLevels(copyCount, 0);
+
+	for(size_t i = 0; i < copyCount; ++i) {
+		Vector4 center = Vector4(boundingCenter.x, boundingCenter.y, boundingCenter.z, 1.0f) * mvMatrices[i * partCount];
+		float depth = center.z - boundingRadius;
+
+		if(depth <= 0.0f)
+			continue;
+
+		while(
+				copyLevels[i] + 1 < levels.size() &&
+				levels[copyLevels[i] + 1].error * pixelsPerUnit / depth <= maximumError
+			)
+			++copyLevels[i];
+	}
+
+	// with every texture in one array, each copy of the model is a single
+	// draw; otherwise each run of groups is drawn with its own texture
+	GLuint textureArrayID = gameGraphics->getTextureArrayID(name, layerTextures);
+	GLuint programID = gameGraphics->getProgramID(textureArrayID != 0 ? "structure" : "colorTextureLighting");
+
+	// state
+	glDisable(GL_BLEND);
+	glEnable(GL_CULL_FACE);
+	glFrontFace(GL_CW);
+	glEnable(GL_DEPTH_TEST);
+	if(gameGraphics->supportsMultisampling) glEnable(GL_MULTISAMPLE);
+	glDisable(GL_SCISSOR_TEST);
+	glEnable(GL_TEXTURE_2D);
+
+	// enable shader
+	glUseProgram(programID);
+
+	// set uniforms
+	glUniform1i(glGetUniformLocation(programID, "texture"), 0);
+	glUniform3f(glGetUniformLocation(programID, "ambientColor"), 0.15f, 0.15f, 0.15f);
+	glUniform3f(glGetUniformLocation(programID, "diffuseColor"), 0.5f, 0.5f, 0.5f);
+	glUniform3f(glGetUniformLocation(programID, "specularColor"), 0.8f, 0.8f, 0.8f);
+	Vector4 lightPosition = Vector4(1.0f, 1.0f, -1.0f, 0.0f) * gameGraphics->currentCamera->lightMatrix;
+	glUniform3f(glGetUniformLocation(programID, "lightPosition"), lightPosition.x, lightPosition.y, lightPosition.z);
+	glUniform1f(glGetUniformLocation(programID, "shininess"), 10.0f);
+	glUniformMatrix4fv(glGetUniformLocation(programID, "pMatrix"), 1, GL_FALSE, (gameState->binoculars ? gameGraphics->ppBinoMatrixArray : gameGraphics->ppMatrixArray));
+
+	// set the overall drawing state
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBufferID);
+
+	glVertexAttribPointer(glGetAttribLocation(programID, "position"), 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) 0);
+	glVertexAttribPointer(glGetAttribLocation(programID, "normal"), 3, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) (3 * sizeof(GLfloat)));
+	glVertexAttribPointer(glGetAttribLocation(programID, "texCoord"), 2, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) (6 * sizeof(GLfloat)));
+	glVertexAttribPointer(glGetAttribLocation(programID, "color"), 4, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) (8 * sizeof(GLfloat)));
+
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "position"));
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "normal"));
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "texCoord"));
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "color"));
+
+	if(textureArrayID != 0) {
+#ifdef GL_TEXTURE_2D_ARRAY_EXT
+		glVertexAttribPointer(glGetAttribLocation(programID, "layer"), 1, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) (12 * sizeof(GLfloat)));
+		glVertexAttribPointer(glGetAttribLocation(programID, "part"), 1, GL_FLOAT, GL_FALSE, 14 * sizeof(GLfloat), (GLvoid*) (13 * sizeof(GLfloat)));
+
+		glEnableVertexAttribArray(glGetAttribLocation(programID, "layer"));
+		glEnableVertexAttribArray(glGetAttribLocation(programID, "part"));
+
+		// set the texture
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, textureArrayID);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MAG_FILTER, magFilter);
+
+		// draw the geometry
+		for(size_t i = 0; i < copyCount; ++i) {
+			glUniformMatrix4fv(glGetUniformLocation(programID, "mvMatrices"), partCount, GL_FALSE, mvMatrices[i * partCount].getArray());
+
+			const Level& level = levels[copyLevels[i]];
+			glDrawElements(GL_TRIANGLES, level.count, GL_UNSIGNED_INT, (GLvoid*) (level.offset * sizeof(GLuint)));
+		}
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+
+		glDisableVertexAttribArray(glGetAttribLocation(programID, "layer"));
+		glDisableVertexAttribArray(glGetAttribLocation(programID, "part"));
+#endif
+	} else {
+		for(size_t i = 0; i < copyCount; ++i) {
+			const std::vector<Range>& ranges = levels[copyLevels[i]].ranges;
+
+			for(size_t p = 0; p < ranges.size(); ++p) {
+				// set the texture
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, gameGraphics->getTextureID(ranges[p].texture));
+
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+
+				glUniformMatrix4fv(glGetUniformLocation(programID, "mvMatrix"), 1, GL_FALSE, mvMatrices[i * partCount + ranges[p].part].getArray());
+
+				// draw the geometry
+				glDrawElements(GL_TRIANGLES, ranges[p].count, GL_UNSIGNED_INT, (GLvoid*) (ranges[p].offset * sizeof(GLuint)));
+			}
+		}
+	}
+
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "position"));
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "normal"));
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "texCoord"));
+	glDisableVertexAttribArray(glGetAttribLocation(programID, "color"));
+}
@@ -0,0 +1,74 @@
+// StructureModel.h
+// Dominicus
+
+#ifndef STRUCTUREMODEL_H
+#define STRUCTUREMODEL_H
+
+#include <string>
+#include <vector>
+
+#include "geometry/Mesh.h"
+#include "math/MatrixMath.h"
+#include "math/VectorMath.h"
+#include "platform/OpenGLHeaders.h"
+
+class StructureModel {
+public:
+	// a face group to draw, the structure texture covering it, and which of
+	// the model's separately transformed parts it moves with
+	struct Group {
+		std::string name;
+		std::string texture;
+		unsigned int part;
+
+		Group(std::string name, std::string texture, unsigned int part = 0) :
+				name(name), texture(texture), part(part) { }
+	};
+
+	// the most separately transformed parts a model may have
+	static const unsigned int maxParts = 3;
+
+private:
+	// a run of the element buffer using one texture and part, for drawing
+	// group by group when the textures can't share an array
+	struct Range {
+		std::string texture;
+		unsigned int part;
+		size_t offset;
+		size_t count;
+	};
+
+	// a level of detail, as its own run of the element buffer (split into
+	// ranges for drawing group by group), and the root mean square distance
+	// its surface may stray from the original
+	struct Level {
+		std::vector<Range> ranges;
+		size_t offset;
+		size_t count;
+		float error;
+	};
+
+	std::string name;
+	std::vector<std::string> layerTextures;
+	std::vector<Level> levels;
+	unsigned int partCount;
+
+	// for finding how far away each copy is
+	Vector3 boundingCenter;
+	float boundingRadius;
+
+	GLuint vertexBufferID, elementBufferID;
+
+	GLint minFilter, magFilter;
+
+public:
+	StructureModel(std::string name, Mesh& mesh, std::vector<Group> groups, GLint minFilter, GLint magFilter);
+	~StructureModel();
+
+	// draws one copy of the model per set of part matrices (modelview
+	// matrices for each part in turn, for each copy in turn), each at the
+	// coarsest level of detail whose error would span too few pixels to see
+	void draw(const std::vector<Matrix4>& mvMatrices);
+};
+
+#endif // STRUCTUREMODEL_H
@@ -110,13 +110,17 @@ void DrawingMaster::destroyDrawers() {
 }
 
 void DrawingMaster::newGraphics() {
+	resizeGraphics();
+
+	destroyDrawers();
+	buildDrawers();
+}
+
+void DrawingMaster::resizeGraphics() {
 	uiLayoutAuthority->elementMargin = Vector2(
 			gameSystem->getFloat("hudElementMargin") / gameGraphics->resolutionX,
 			gameSystem->getFloat("hudElementMargin") / gameGraphics->resolutionY
 		);
-
-	destroyDrawers();
-	buildDrawers();
 }
 
 unsigned int DrawingMaster::execute(bool unScheduled) {
@@ -25,6 +25,7 @@ public:
 	void buildDrawers();
 	void destroyDrawers();
 	void newGraphics();
+	void resizeGraphics();	// for a window change that kept the context
 
 	unsigned int execute(bool unScheduled = false);
 };
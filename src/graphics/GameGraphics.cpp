@@ -4,195 +4,186 @@
 #include "graphics/GameGraphics.h"
 
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <SDL/SDL.h>
 #include <sstream>
 #include <stdint.h>
 #include <string.h>
 
+#include "core/AssetManager.h"
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
 #include "core/MainLoopMember.h"
 #include "geometry/DiamondSquare.h"
 #include "graphics/DrawingMaster.h"
 #include "math/ScalarMath.h"
 #include "math/VectorMath.h"
 #include "platform/Platform.h"
+#include "state/GameState.h"
 
+extern AssetManager* assetManager;
 extern DrawingMaster* drawingMaster;
 extern std::map<MainLoopMember*,unsigned int> mainLoopModules;
 extern Platform* platform;
 extern GameSystem* gameSystem;
-
-GLuint GameGraphics::getShaderID(GLenum shaderType, std::string shaderName) {
-	// return the compiled shader ID
-	std::map<std::string, GLuint>::iterator itr;
-	std::string extension;
-	if(shaderType == GL_VERTEX_SHADER) {
-		itr = vertexShaderIDs.find(shaderName);
-
-		if(itr != vertexShaderIDs.end())
-			return itr->second;
-
-		extension = ".vertex.glsl";
-	} else if(shaderType == GL_FRAGMENT_SHADER) {
-		itr = fragmentShaderIDs.find(shaderName);
-
-		if(itr != fragmentShaderIDs.end())
-			return itr->second;
-
-		extension = ".fragment.glsl";
+extern JobSystem* jobSystem;
+extern GameState* gameState;
+
+// generates a grayscale diamond-square noise texture on a worker thread, or
+// reads it from the cache if it has been generated with these settings before
+class NoiseTextureJob : public Job {
+	// a noise cache file holds this header followed by the texture rows
+	static const uint32_t cacheVersion = 1;
+
+	struct CacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t density;
+		float roughness;
+		uint32_t depth;
+		uint32_t seed;
+	};
+
+	unsigned int density;
+	float roughness;
+	unsigned int depth;
+	unsigned int seed;
+	bool cached;
+	Texture** destination;
+	Texture* texture;
+
+	std::string getCachePath() {
+		std::stringstream path;
+		path << platform->cachePath << "/noise." << density << "." << (unsigned int) (roughness * 1000.0f) << "." <<
+				depth << "." << seed << ".noise";
+
+		return path.str();
 	}
 
-	std::stringstream filename;
-	filename <<
-			platform->dataPath <<
-			"/shaders/" <<
-			shaderName <<
-			extension;
+	bool loadCache() {
+		std::string path = getCachePath();
 
-	std::ifstream fileStream;
-	std::vector<std::string> fileLines;
+		size_t fileSize = 0;
+		const uint8_t* fileData = (const uint8_t*) platform->mapFile(path.c_str(), &fileSize);
 
-	fileStream.open(filename.str().c_str());
-	while(fileStream.good()) {
-		std::string thisChar = "";
-		thisChar += fileStream.get();
+		if(fileData == NULL)
+			return false;
 
-		if(fileLines.size() == 0)
-			fileLines.push_back("");
+		const CacheHeader* header = (const CacheHeader*) fileData;
+		texture = new Texture(density, density, Texture::FORMAT_RGB);
+		size_t dataSize = texture->getRowSize() * texture->height;
 
-		fileLines.back() += thisChar;
+		if(
+				fileSize != sizeof(CacheHeader) + dataSize ||
+				memcmp(header->magic, "DNOI", 4) != 0 ||
+				header->version != cacheVersion ||
+				header->density != density ||
+				header->roughness != roughness ||
+				header->depth != depth ||
+				header->seed != seed
+			) {
+			platform->unmapFile(fileData, fileSize);
 
-		if(thisChar == "\n") {
-			fileLines.push_back("");
-		}
-	}
-	fileStream.close();
-
-	if(fileLines.size() > 0)
-		fileLines.pop_back();
-	else
-		gameSystem->log(GameSystem::LOG_FATAL,
-				std::string("The GLSL shader " +
-						filename.str() +
-						" could not be opened for reading.").c_str()
-			);
+			delete texture;
+			texture = NULL;
 
-	GLsizei count = fileLines.size();
-	uint8_t bytes = 0;
-	GLchar** shaderSource;
+			return false;
+		}
 
-	for(size_t i = 0; i < fileLines.size(); ++i)
-		bytes += fileLines[i].size() + 1;
+		memcpy(texture->getDataPointer(), fileData + sizeof(CacheHeader), dataSize);
 
-	shaderSource = new GLchar*[fileLines.size()];
+		platform->unmapFile(fileData, fileSize);
 
-	for(size_t i = 0; i < fileLines.size(); ++i) {
-		shaderSource[i] = new GLchar[fileLines[i].size() + 1];
-		memcpy(
-				shaderSource[i],
-				fileLines[i].c_str(),
-				fileLines[i].size() + 1
-			);
-		shaderSource[i][fileLines[i].size()] = '\0';
+		return true;
 	}
 
-	GLuint shader;
-	shader = glCreateShader(shaderType);
-	glShaderSource(shader, count, (const GLchar**) shaderSource, NULL);
-
-	for(int i = 0; i < count; ++i)
-		delete[] shaderSource[i];
-	delete[] shaderSource;
-
-	glCompileShader(shader);
+	void writeCache() {
+		CacheHeader header;
+		memset(&header, 0, sizeof(CacheHeader));
 
-	GLint result;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
-
-	if(result == GL_FALSE) {
-		std::stringstream err;
-		err << "The GLSL shader "
-				<< filename
-				<< " did not compile successfully."
-				<< std::endl << std::endl;
-
-		GLint sourceLength;
-		glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &sourceLength);
-		GLchar* sourceLines = new GLchar[sourceLength];
-		glGetShaderSource(shader, sourceLength, NULL, sourceLines);
-
-		err << "SHADER SOURCE ON GPU" << std::endl
-				<< "--------------------" << std::endl
-				<< sourceLines
-				<< "--------------------" << std::endl << std::endl;
-		delete[] sourceLines;
-
-		GLint logLength;
-		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
-		GLchar* logLines = new GLchar[logLength];
-		glGetShaderInfoLog(shader, logLength, NULL, logLines);
-
-		err << "ERROR LOG" << std::endl
-				<< "---------" << std::endl
-				<< logLines
-				<< "---------";
-
-		delete[] logLines;
-
-		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
-	}
-
-	return shader;
-}
+		memcpy(header.magic, "DNOI", 4);
+		header.version = cacheVersion;
+		header.density = density;
+		header.roughness = roughness;
+		header.depth = depth;
+		header.seed = seed;
 
-GLuint GameGraphics::makeProgram(std::vector<GLuint> shaders) {
-	GLuint program;
+		size_t dataSize = texture->getRowSize() * texture->height;
 
-	program = glCreateProgram();
+		// write to a temporary file and rename it into place so a partially
+		// written cache is never picked up
+		std::string path = getCachePath();
+		std::string temporaryPath = path + ".tmp";
+		FILE* cacheFile = fopen(temporaryPath.c_str(), "wb");
 
-	for(size_t i = 0; i < shaders.size(); ++i)
-		glAttachShader(program, shaders[i]);
+		if(cacheFile == NULL) {
+			gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write noise texture cache file " + path + ".");
 
-	glLinkProgram(program);
+			return;
+		}
 
-	GLint result;
-	glGetProgramiv(program, GL_LINK_STATUS, &result);
+		bool writeSucceeded =
+				fwrite(&header, sizeof(CacheHeader), 1, cacheFile) == 1 &&
+				fwrite(texture->getDataPointer(), 1, dataSize, cacheFile) == dataSize;
 
-	if(result == GL_FALSE) {
-		std::stringstream err;
-		err << "The GLSL shader program did not link successfully." << std::endl << std::endl;
+		if(fclose(cacheFile) != 0 || ! writeSucceeded || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+			remove(temporaryPath.c_str());
+			gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write noise texture cache file " + path + ".");
+		}
+	}
 
-		GLint logLength;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
-		GLchar* logLines = new GLchar[logLength];
-		glGetProgramInfoLog(program, logLength, NULL, logLines);
+public:
+	NoiseTextureJob(unsigned int density, float roughness, unsigned int depth, unsigned int variants, Texture** destination) :
+			Job("noise texture"),
+			density(density),
+			roughness(roughness),
+			depth(depth),
+			seed(variants > 0 ? (unsigned int) (rand() % variants) : (unsigned int) rand()),
+			cached(variants > 0),
+			destination(destination),
+			texture(NULL) { }
+	~NoiseTextureJob() { delete texture; }
+
+	void run() {
+		if(cached && loadCache())
+			return;
+
+		DiamondSquare noise(density, roughness, seed);
+
+		texture = new Texture(density, density, Texture::FORMAT_RGB);
+
+		// the noise is indexed by column first
+		std::vector<uint8_t> levels(density);
+		for(size_t p = 0; p < (size_t) density; ++p) {
+			for(size_t i = 0; i < (size_t) density; ++i)
+				levels[i] = (uint8_t) (noise.data[i][p] * 128.0f + 127.0f);
+
+			texture->setRowFromLuminance(p, &levels[0]);
+		}
 
-		err << "ERROR LOG" << std::endl
-				<< "---------" << std::endl
-				<< logLines
-				<< "---------";
+		if(depth > 0)
+			texture->setDepth(depth);
 
-		delete[] logLines;
+		if(cached)
+			writeCache();
+	}
 
-		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
+	void finish() {
+		*destination = texture;
+		texture = NULL;
 	}
+};
 
-	return program;
-}
+bool GameGraphics::lacksSceneFramebuffer = false;
 
-GameGraphics::GameGraphics(bool fullScreen, bool testSystem) :
-		fullScreen(fullScreen),
-		supportsMultisampling(false),
-		currentCamera(NULL) {
+void GameGraphics::openWindow() {
 	// initialize an SDL window
 	resolutionX = (fullScreen ? gameSystem->displayResolutionX :
 			atoi(gameSystem->getString("displayWindowedResolution").substr(0, gameSystem->getString("displayWindowedResolution").find('x')).c_str()));
 	resolutionY = (fullScreen ? gameSystem->displayResolutionY :
 			atoi(gameSystem->getString("displayWindowedResolution").substr(gameSystem->getString("displayWindowedResolution").find('x') + 1, std::string::npos).c_str()));
-	aspectRatio = (float) resolutionX / (float) resolutionY;
 
 	uint32_t flags = SDL_OPENGL | (fullScreen ? SDL_FULLSCREEN : 0);
 
@@ -206,7 +197,8 @@ GameGraphics::GameGraphics(bool fullScreen, bool testSystem) :
 				"SDL cannot initialize a window with the specified settings.");
 
 	SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, (int) gameSystem->getFloat("displayFramerateLimiting") == GameSystem::LIMIT_VSYNC ? 1 : 0);
-	if(gameSystem->getFloat("displayMultisamplingLevel") == 0.0f) {
+	// with a scene framebuffer, multisampling happens there instead
+	if(supportsSceneFramebuffer || gameSystem->getFloat("displayMultisamplingLevel") == 0.0f) {
 		SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
 	} else {
 		SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
@@ -229,15 +221,228 @@ GameGraphics::GameGraphics(bool fullScreen, bool testSystem) :
 	if(! fullScreen)
 		SDL_WM_SetCaption(PROGRAM_IDENTIFIER, NULL);
 
+	adoptWindow();
+}
+
+void GameGraphics::adoptWindow() {
+	// take the size of the window actually open
+	SDL_Surface* surface = SDL_GetVideoSurface();
+
+	resolutionX = surface->w;
+	resolutionY = surface->h;
+	aspectRatio = (float) resolutionX / (float) resolutionY;
+
 	// apply window element scaling
 	std::stringstream resolutionText;
 	resolutionText << resolutionX << "x" << resolutionY;
 	gameSystem->applyScreenResolution(resolutionText.str().c_str());
+}
+
+void GameGraphics::buildMatrices() {
+	idMatrix = Matrix4(
+			1.0, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	float idMatrixArrayVals[] = {
+			idMatrix.m11, idMatrix.m12, idMatrix.m13, idMatrix.m14,
+			idMatrix.m21, idMatrix.m22, idMatrix.m23, idMatrix.m24,
+			idMatrix.m31, idMatrix.m32, idMatrix.m33, idMatrix.m34,
+			idMatrix.m41, idMatrix.m42, idMatrix.m43, idMatrix.m44
+		};
+	memcpy((void*) idMatrixArray, (void*) idMatrixArrayVals, 16 * sizeof(float));
+
+	opMatrix = Matrix4(
+			(float) resolutionY / (float) resolutionX, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		);
+	float opMatrixArrayVals[] = {
+			opMatrix.m11, opMatrix.m12, opMatrix.m13, opMatrix.m14,
+			opMatrix.m21, opMatrix.m22, opMatrix.m23, opMatrix.m24,
+			opMatrix.m31, opMatrix.m32, opMatrix.m33, opMatrix.m34,
+			opMatrix.m41, opMatrix.m42, opMatrix.m43, opMatrix.m44
+		};
+	memcpy((void*) opMatrixArray, (void*) opMatrixArrayVals, 16 * sizeof(float));
+
+	const float fov = gameSystem->getFloat("renderingPerspectiveFOV");
+	const float binoFOV = gameSystem->getFloat("renderingPerspectiveBinocularsFOV");
+	const float nClip = gameSystem->getFloat("renderingPerspectiveNearClip");
+	const float fClip = gameSystem->getFloat("renderingPerspectiveFarClip");
+
+	ppMatrix = Matrix4(
+			1.0f / tan(radians(fov)), 0.0f, 0.0f, 0.0f,
+			0.0f, aspectRatio / tan(radians(fov)), 0.0f, 0.0f,
+			0.0f, 0.0f, (fClip + nClip) / (fClip - nClip), 1.0f,
+			0.0f, 0.0f, -2.0f * fClip * nClip / (fClip - nClip), 0.0f
+		);
+
+	float ppMatrixArrayVals[] = {
+			ppMatrix.m11, ppMatrix.m12, ppMatrix.m13, ppMatrix.m14,
+			ppMatrix.m21, ppMatrix.m22, ppMatrix.m23, ppMatrix.m24,
+			ppMatrix.m31, ppMatrix.m32, ppMatrix.m33, ppMatrix.m34,
+			ppMatrix.m41, ppMatrix.m42, ppMatrix.m43, ppMatrix.m44
+		};
+	memcpy((void*) ppMatrixArray, (void*) ppMatrixArrayVals, 16 * sizeof(float));
+
+	ppBinoMatrix = Matrix4(
+			1.0f / tan(radians(binoFOV)), 0.0f, 0.0f, 0.0f,
+			0.0f, aspectRatio / tan(radians(binoFOV)), 0.0f, 0.0f,
+			0.0f, 0.0f, (fClip + nClip) / (fClip - nClip), 1.0f,
+			0.0f, 0.0f, -2.0f * fClip * nClip / (fClip - nClip), 0.0f
+		);
+
+	float ppBinoMatrixArrayVals[] = {
+			ppBinoMatrix.m11, ppBinoMatrix.m12, ppBinoMatrix.m13, ppBinoMatrix.m14,
+			ppBinoMatrix.m21, ppBinoMatrix.m22, ppBinoMatrix.m23, ppBinoMatrix.m24,
+			ppBinoMatrix.m31, ppBinoMatrix.m32, ppBinoMatrix.m33, ppBinoMatrix.m34,
+			ppBinoMatrix.m41, ppBinoMatrix.m42, ppBinoMatrix.m43, ppBinoMatrix.m44
+		};
+	memcpy((void*) ppBinoMatrixArray, (void*) ppBinoMatrixArrayVals, 16 * sizeof(float));
+/*
+	ppMatrixInverse = Matrix4(
+			tan(radians(fov)) / 1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, tan(radians(fov)) / aspectRatio, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, -(fClip - nClip) / (2.0f * fClip * nClip),
+			0.0f, 0.0f, 1.0f, (fClip + nClip) / (2.0f * fClip * nClip)
+		);
+
+	float ppMatrixInverseArrayVals[] = {
+			ppMatrixInverse.m11, ppMatrixInverse.m12, ppMatrixInverse.m13, ppMatrixInverse.m14,
+			ppMatrixInverse.m21, ppMatrixInverse.m22, ppMatrixInverse.m23, ppMatrixInverse.m24,
+			ppMatrixInverse.m31, ppMatrixInverse.m32, ppMatrixInverse.m33, ppMatrixInverse.m34,
+			ppMatrixInverse.m41, ppMatrixInverse.m42, ppMatrixInverse.m43, ppMatrixInverse.m44
+		};
+	memcpy((void*) ppMatrixInverseArray, (void*) ppMatrixInverseArrayVals, 16 * sizeof(float));
+*/
+}
+
+void GameGraphics::buildSceneFramebuffer() {
+	destroySceneFramebuffer();
+
+	// without multisampling, drawing straight to the window is cheapest
+	if(! supportsSceneFramebuffer || gameSystem->getFloat("displayMultisamplingLevel") == 0.0f)
+		return;
+
+	GLint maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES_EXT, &maxSamples);
+	GLsizei samples = (GLsizei) minimum(
+			(int) maxSamples,
+			gameSystem->getFloat("displayMultisamplingLevel") == 2.0f ? 2 : 4
+		);
+
+	GLenum depthFormat = GL_DEPTH_COMPONENT24;
+	if((int) gameSystem->getFloat("displayDepthSize") <= 16)
+		depthFormat = GL_DEPTH_COMPONENT16;
+	else if((int) gameSystem->getFloat("displayDepthSize") >= 32)
+		depthFormat = GL_DEPTH_COMPONENT32;
+
+	glGenRenderbuffersEXT(1, &sceneColorRenderbufferID);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, sceneColorRenderbufferID);
+	glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER_EXT, samples, GL_RGBA8, resolutionX, resolutionY);
+
+	glGenRenderbuffersEXT(1, &sceneDepthRenderbufferID);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, sceneDepthRenderbufferID);
+	glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER_EXT, samples, depthFormat, resolutionX, resolutionY);
+
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, 0);
+
+	glGenFramebuffersEXT(1, &sceneFramebufferID);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, sceneFramebufferID);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_RENDERBUFFER_EXT, sceneColorRenderbufferID);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, sceneDepthRenderbufferID);
+
+	GLenum status = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+	if(status != GL_FRAMEBUFFER_COMPLETE_EXT) {
+		std::stringstream err;
+		err << "Multisampled scene framebuffer incomplete (status " << status << "), drawing without multisampling.";
+		gameSystem->log(GameSystem::LOG_VERBOSE, err.str().c_str());
+
+		destroySceneFramebuffer();
+	}
+}
+
+void GameGraphics::destroySceneFramebuffer() {
+	if(sceneFramebufferID != 0)
+		glDeleteFramebuffersEXT(1, &sceneFramebufferID);
+	if(sceneColorRenderbufferID != 0)
+		glDeleteRenderbuffersEXT(1, &sceneColorRenderbufferID);
+	if(sceneDepthRenderbufferID != 0)
+		glDeleteRenderbuffersEXT(1, &sceneDepthRenderbufferID);
+
+	sceneFramebufferID = 0;
+	sceneColorRenderbufferID = 0;
+	sceneDepthRenderbufferID = 0;
+}
+
+GameGraphics::GameGraphics(bool fullScreen, bool testSystem, bool reuseWindow) :
+		sceneFramebufferID(0),
+		sceneColorRenderbufferID(0),
+		sceneDepthRenderbufferID(0),
+		contextSentinelID(0),
+		fullScreen(fullScreen),
+		supportsMultisampling(false),
+		supportsSceneFramebuffer(false),
+		supportsTextureCompression(false),
+		supportsTextureArrays(false),
+		currentCamera(NULL),
+		visibleObjectCount(0),
+		culledObjectCount(0),
+		lastVisibleObjectCount(0),
+		lastCulledObjectCount(0) {
+	// unless an earlier context showed otherwise, the window is opened
+	// without multisample buffers, since if the context can multisample into
+	// a framebuffer object then settings can change later without
+	// recreating the window
+	supportsSceneFramebuffer = ! lacksSceneFramebuffer;
+
+	if(reuseWindow)
+		adoptWindow();
+	else
+		openWindow();
+
+	const char* extensions = (const char*) glGetString(GL_EXTENSIONS);
+	supportsSceneFramebuffer =
+			strstr(extensions, "GL_EXT_framebuffer_object") != NULL &&
+			strstr(extensions, "GL_EXT_framebuffer_multisample") != NULL &&
+			strstr(extensions, "GL_EXT_framebuffer_blit") != NULL;
+
+	// nothing lives in the context yet, so it is safe to reopen with window
+	// multisampling instead; this only happens for the first window, since
+	// any opened later has multisample buffers from the start
+	if(! supportsSceneFramebuffer && ! lacksSceneFramebuffer) {
+		lacksSceneFramebuffer = true;
+
+		if(! reuseWindow && gameSystem->getFloat("displayMultisamplingLevel") != 0.0f)
+			openWindow();
+	}
+
+	// cook any textures loaded from here on uncompressed if we can't use
+	// the compressed formats
+	supportsTextureCompression = strstr((const char*) glGetString(GL_EXTENSIONS), "GL_EXT_texture_compression_s3tc") != NULL;
+	if(! supportsTextureCompression)
+		assetManager->disableTextureCompression();
+
+	// array textures let models with several materials draw in one call
+#ifdef GL_TEXTURE_2D_ARRAY_EXT
+	supportsTextureArrays = strstr((const char*) glGetString(GL_EXTENSIONS), "GL_EXT_texture_array") != NULL;
+#endif
 
 	// always check for multisampling support since we set a flag for it
-	if(strstr((const char*) glGetString(GL_EXTENSIONS), "GL_ARB_multisample") != NULL)
+	if(supportsSceneFramebuffer || strstr((const char*) glGetString(GL_EXTENSIONS), "GL_ARB_multisample") != NULL)
 		supportsMultisampling = true;
 
+	// a texture name that exists only as long as this context does
+	glGenTextures(1, &contextSentinelID);
+	glBindTexture(GL_TEXTURE_2D, contextSentinelID);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	buildSceneFramebuffer();
+
 	// if specified, do system test
 	if(testSystem) {
 		// test and log the OpenGL version for compatibility
@@ -323,137 +528,71 @@ GameGraphics::GameGraphics(bool fullScreen, bool testSystem) :
 			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL extension not supported: GL_ARB_multisample");
 		else
 			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL Extension Found: GL_ARB_multisample");
+
+		// log the presence of the S3TC texture compression extension
+		if(supportsTextureCompression)
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL Extension Found: GL_EXT_texture_compression_s3tc");
+		else
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL extension not supported: GL_EXT_texture_compression_s3tc");
+
+		// log the presence of the array texture extension
+		if(supportsTextureArrays)
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL Extension Found: GL_EXT_texture_array");
+		else
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL extension not supported: GL_EXT_texture_array");
+
+		// log whether multisampling can happen offscreen (allowing settings changes without a new window)
+		if(supportsSceneFramebuffer)
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL Extensions Found: GL_EXT_framebuffer_multisample, GL_EXT_framebuffer_blit");
+		else
+			gameSystem->log(GameSystem::LOG_VERBOSE, "OpenGL extensions not supported: GL_EXT_framebuffer_multisample, GL_EXT_framebuffer_blit");
 	}
 
-	// set up matrices
-	idMatrix = Matrix4(
-			1.0, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);
-	float idMatrixArrayVals[] = {
-			idMatrix.m11, idMatrix.m12, idMatrix.m13, idMatrix.m14,
-			idMatrix.m21, idMatrix.m22, idMatrix.m23, idMatrix.m24,
-			idMatrix.m31, idMatrix.m32, idMatrix.m33, idMatrix.m34,
-			idMatrix.m41, idMatrix.m42, idMatrix.m43, idMatrix.m44
-		};
-	memcpy((void*) idMatrixArray, (void*) idMatrixArrayVals, 16 * sizeof(float));
+	buildMatrices();
 
-	opMatrix = Matrix4(
-			(float) resolutionY / (float) resolutionX, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);
-	float opMatrixArrayVals[] = {
-			opMatrix.m11, opMatrix.m12, opMatrix.m13, opMatrix.m14,
-			opMatrix.m21, opMatrix.m22, opMatrix.m23, opMatrix.m24,
-			opMatrix.m31, opMatrix.m32, opMatrix.m33, opMatrix.m34,
-			opMatrix.m41, opMatrix.m42, opMatrix.m43, opMatrix.m44
-		};
-	memcpy((void*) opMatrixArray, (void*) opMatrixArrayVals, 16 * sizeof(float));
+	// start generating the persistent noise textures in the background
+	unsigned int noiseDensity = (unsigned int) gameSystem->getFloat("terrainNoiseTextureDensity");
+	float noiseRoughness = gameSystem->getFloat("terrainNoiseTextureRoughness");
+	unsigned int noiseVariants = (unsigned int) gameSystem->getFloat("terrainNoiseTextureVariants");
 
-	const float fov = gameSystem->getFloat("renderingPerspectiveFOV");
-	const float binoFOV = gameSystem->getFloat("renderingPerspectiveBinocularsFOV");
-	const float nClip = gameSystem->getFloat("renderingPerspectiveNearClip");
-	const float fClip = gameSystem->getFloat("renderingPerspectiveFarClip");
+	NoiseTextureJob* noiseJob = new NoiseTextureJob(noiseDensity, noiseRoughness, 0, noiseVariants, &noiseTexture);
+	NoiseTextureJob* fourDepthNoiseJob = new NoiseTextureJob(noiseDensity, noiseRoughness, 16, noiseVariants, &fourDepthNoiseTexture);
+	jobSystem->submit(noiseJob);
+	jobSystem->submit(fourDepthNoiseJob);
 
-	ppMatrix = Matrix4(
-			1.0f / tan(radians(fov)), 0.0f, 0.0f, 0.0f,
-			0.0f, aspectRatio / tan(radians(fov)), 0.0f, 0.0f,
-			0.0f, 0.0f, (fClip + nClip) / (fClip - nClip), 1.0f,
-			0.0f, 0.0f, -2.0f * fClip * nClip / (fClip - nClip), 0.0f
-		);
+	// prepare every shader program up front so none hitches its first frame
+	std::vector<std::string> programNames;
+	std::string programsString = gameSystem->getString("renderingShaderPrograms");
 
-	float ppMatrixArrayVals[] = {
-			ppMatrix.m11, ppMatrix.m12, ppMatrix.m13, ppMatrix.m14,
-			ppMatrix.m21, ppMatrix.m22, ppMatrix.m23, ppMatrix.m24,
-			ppMatrix.m31, ppMatrix.m32, ppMatrix.m33, ppMatrix.m34,
-			ppMatrix.m41, ppMatrix.m42, ppMatrix.m43, ppMatrix.m44
-		};
-	memcpy((void*) ppMatrixArray, (void*) ppMatrixArrayVals, 16 * sizeof(float));
+	size_t stringOffset = 0;
+	while(stringOffset < programsString.length()) {
+		size_t separator = programsString.find(',', stringOffset);
+		if(separator == std::string::npos)
+			separator = programsString.length();
 
-	ppBinoMatrix = Matrix4(
-			1.0f / tan(radians(binoFOV)), 0.0f, 0.0f, 0.0f,
-			0.0f, aspectRatio / tan(radians(binoFOV)), 0.0f, 0.0f,
-			0.0f, 0.0f, (fClip + nClip) / (fClip - nClip), 1.0f,
-			0.0f, 0.0f, -2.0f * fClip * nClip / (fClip - nClip), 0.0f
-		);
+		if(separator > stringOffset)
+			programNames.push_back(programsString.substr(stringOffset, separator - stringOffset));
 
-	float ppBinoMatrixArrayVals[] = {
-			ppBinoMatrix.m11, ppBinoMatrix.m12, ppBinoMatrix.m13, ppBinoMatrix.m14,
-			ppBinoMatrix.m21, ppBinoMatrix.m22, ppBinoMatrix.m23, ppBinoMatrix.m24,
-			ppBinoMatrix.m31, ppBinoMatrix.m32, ppBinoMatrix.m33, ppBinoMatrix.m34,
-			ppBinoMatrix.m41, ppBinoMatrix.m42, ppBinoMatrix.m43, ppBinoMatrix.m44
-		};
-	memcpy((void*) ppBinoMatrixArray, (void*) ppBinoMatrixArrayVals, 16 * sizeof(float));
-/*
-	ppMatrixInverse = Matrix4(
-			tan(radians(fov)) / 1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, tan(radians(fov)) / aspectRatio, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, -(fClip - nClip) / (2.0f * fClip * nClip),
-			0.0f, 0.0f, 1.0f, (fClip + nClip) / (2.0f * fClip * nClip)
-		);
+		stringOffset = separator + 1;
+	}
 
-	float ppMatrixInverseArrayVals[] = {
-			ppMatrixInverse.m11, ppMatrixInverse.m12, ppMatrixInverse.m13, ppMatrixInverse.m14,
-			ppMatrixInverse.m21, ppMatrixInverse.m22, ppMatrixInverse.m23, ppMatrixInverse.m24,
-			ppMatrixInverse.m31, ppMatrixInverse.m32, ppMatrixInverse.m33, ppMatrixInverse.m34,
-			ppMatrixInverse.m41, ppMatrixInverse.m42, ppMatrixInverse.m43, ppMatrixInverse.m44
-		};
-	memcpy((void*) ppMatrixInverseArray, (void*) ppMatrixInverseArrayVals, 16 * sizeof(float));
-*/
+	shaderManager = new ShaderManager();
+	// the structure program samples an array texture, so it only compiles
+	// where they are supported
+	if(supportsTextureArrays)
+		programNames.push_back("structure");
+
+	shaderManager->precompile(programNames);
 
-	// set up fonts
+	// set up fonts (which share one FreeType face, so they stay on this thread)
 	fontManager = new FontManager();
 	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeSmall"));
 	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeMedium"));
 	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeLarge"));
 	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeSuper"));
 
-	// create persistent noise textures
-	unsigned int noiseDensity = (unsigned int) gameSystem->getFloat("terrainNoiseTextureDensity");
-	DiamondSquare noise1(
-			noiseDensity,
-			gameSystem->getFloat("terrainNoiseTextureRoughness")
-		);
-	noiseTexture = new Texture(
-			noiseDensity,
-			noiseDensity,
-			Texture::FORMAT_RGB
-		);
-		for(size_t i = 0; i < (size_t) noiseDensity; ++i)
-			for(size_t p = 0; p < (size_t) noiseDensity; ++p)
-				noiseTexture->setColorAt(
-						i,
-						p,
-						(uint8_t) (noise1.data[i][p] * 128.0f + 127.0f),
-						(uint8_t) (noise1.data[i][p] * 128.0f + 127.0f),
-						(uint8_t) (noise1.data[i][p] * 128.0f + 127.0f),
-						0xFF
-					);
-
-		DiamondSquare noise2(
-				noiseDensity,
-				gameSystem->getFloat("terrainNoiseTextureRoughness")
-			);
-		fourDepthNoiseTexture = new Texture(
-				noiseDensity,
-				noiseDensity,
-				Texture::FORMAT_RGB
-			);
-		for(size_t i = 0; i < (size_t) noiseDensity; ++i)
-			for(size_t p = 0; p < (size_t) noiseDensity; ++p)
-				fourDepthNoiseTexture->setColorAt(
-						i,
-						p,
-						(uint8_t) (noise2.data[i][p] * 128.0f + 127.0f),
-						(uint8_t) (noise2.data[i][p] * 128.0f + 127.0f),
-						(uint8_t) (noise2.data[i][p] * 128.0f + 127.0f),
-						0xFF
-					);
-	fourDepthNoiseTexture->setDepth(16);
+	jobSystem->wait(noiseJob);
+	jobSystem->wait(fourDepthNoiseJob);
 }
 
 GameGraphics::~GameGraphics() {
@@ -464,64 +603,60 @@ GameGraphics::~GameGraphics() {
 	delete noiseTexture;
 	delete fourDepthNoiseTexture;
 
-	// delete shaders and programs
-	std::map<std::string, GLuint>::iterator programItr = programIDs.begin();
-	while(programItr != programIDs.end()) {
-		glDetachShader(programItr->second, vertexShaderIDs[programItr->first]);
-		glDeleteShader(vertexShaderIDs[programItr->first]);
-		vertexShaderIDs.erase(vertexShaderIDs.find(programItr->first));
-
-		glDetachShader(programItr->second, fragmentShaderIDs[programItr->first]);
-		glDeleteShader(fragmentShaderIDs[programItr->first]);
-		fragmentShaderIDs.erase(fragmentShaderIDs.find(programItr->first));
-
-		glDeleteProgram(programItr->second);
-		programIDs.erase(programItr);
-
-		programItr = programIDs.begin();
-	}
+	// destroy the scene framebuffer
+	destroySceneFramebuffer();
+	glDeleteTextures(1, &contextSentinelID);
 
-	// delete textures
-	std::map<std::string, Texture*>::iterator textureItr;
-
-	for(textureItr = textures.begin(); textureItr != textures.end(); ++textureItr)
-		delete textureItr->second;
+	// delete shaders and programs
+	delete shaderManager;
 
+	// delete textures (the decoded images stay with the asset manager)
 	std::map<std::string, GLuint>::iterator textureIDItr;
 
 	for(textureIDItr = textureIDs.begin(); textureIDItr != textureIDs.end(); ++textureIDItr)
 		if(glIsTexture(textureIDItr->second))
 			glDeleteTextures(1, &(textureIDItr->second));
+
+	for(textureIDItr = textureArrayIDs.begin(); textureIDItr != textureArrayIDs.end(); ++textureIDItr)
+		if(textureIDItr->second != 0 && glIsTexture(textureIDItr->second))
+			glDeleteTextures(1, &(textureIDItr->second));
 }
 
-GLuint GameGraphics::getProgramID(std::string name) {
-	// return the program ID
-	std::map<std::string, GLuint>::iterator itr = programIDs.find(name);
+void GameGraphics::applyMultisamplingLevel() {
+	buildSceneFramebuffer();
+}
+
+bool GameGraphics::changeWindow(bool fullScreen) {
+	this->fullScreen = fullScreen;
+	openWindow();
+
+	// some platforms replace the context along with the window, taking every
+	// program, texture and buffer with it
+	if(! glIsTexture(contextSentinelID))
+		return false;
+
+	buildMatrices();
 
-	if(itr != programIDs.end())
-		return itr->second;
+	// the scene framebuffer has to match the new window size
+	buildSceneFramebuffer();
 
-	std::vector<GLuint> shaders;
-	shaders.push_back(getShaderID(GL_VERTEX_SHADER, name));
-	shaders.push_back(getShaderID(GL_FRAGMENT_SHADER, name));
-	GLuint programID = makeProgram(shaders);
+	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeSmall"));
+	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeMedium"));
+	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeLarge"));
+	fontManager->populateCommonChars((unsigned int) gameSystem->getFloat("fontSizeSuper"));
 
-	programIDs[name] = programID;
+	return true;
+}
 
-	return programID;
+GLuint GameGraphics::getProgramID(std::string name) {
+	return shaderManager->getProgramID(name);
 }
 
 Texture* GameGraphics::getTexture(std::string filename) {
 	if(textures.find(filename) != textures.end())
 		return textures.find(filename)->second;
 
-	std::stringstream filenameStream;
-	filenameStream <<
-			platform->dataPath <<
-			"/data/textures/" <<
-			filename <<
-			".png";
-	textures[filename] = new Texture(filenameStream.str().c_str());
+	textures[filename] = assetManager->getTexture(filename);
 
 	return textures[filename];
 }
@@ -531,13 +666,15 @@ GLuint GameGraphics::getTextureID(std::string filename) {
 	if(textureIDs.find(filename) != textureIDs.end())
 		return textureIDs.find(filename)->second;
 
-	std::stringstream filenameStream;
-	filenameStream <<
-			platform->dataPath <<
-			"/data/textures/" <<
-			filename <<
-			".png";
-	Texture texture(filenameStream.str().c_str());
+	Texture* texture = getTexture(filename);
+
+	// textures cooked before the window existed may be in a format this
+	// context lacks, so decode an uncompressed copy for it instead
+	Texture* uncompressedTexture = NULL;
+	if(texture->isCompressed() && ! supportsTextureCompression) {
+		uncompressedTexture = new Texture(AssetManager::getTexturePath(filename), 0);
+		texture = uncompressedTexture;
+	}
 
 	// load the texture into OpenGL
 	glEnable(GL_TEXTURE_2D);
@@ -547,31 +684,209 @@ GLuint GameGraphics::getTextureID(std::string filename) {
 
 	glBindTexture(GL_TEXTURE_2D, textureID);
 
-	glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			(texture.format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
-			texture.width,
-			texture.height,
-			0,
-			(texture.format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
-			GL_UNSIGNED_BYTE,
-			texture.getDataPointer()
-	);
+	if(texture->levels.size() > 0) {
+		// upload the cooked mip chain as it is
+		for(size_t i = 0; i < texture->levels.size(); ++i) {
+			const Texture::Level& level = texture->levels[i];
 
-	glGenerateMipmap(GL_TEXTURE_2D);
+			if(texture->isCompressed())
+				glCompressedTexImage2D(
+						GL_TEXTURE_2D,
+						i,
+						(texture->format == Texture::FORMAT_DXT1 ?
+								GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT),
+						level.width,
+						level.height,
+						0,
+						level.size,
+						level.data
+					);
+			else
+				glTexImage2D(
+						GL_TEXTURE_2D,
+						i,
+						GL_RGBA,
+						level.width,
+						level.height,
+						0,
+						GL_RGBA,
+						GL_UNSIGNED_BYTE,
+						level.data
+					);
+		}
+	} else {
+		glTexImage2D(
+				GL_TEXTURE_2D,
+				0,
+				(texture->format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
+				texture->width,
+				texture->height,
+				0,
+				(texture->format == Texture::FORMAT_RGBA ? GL_RGBA : GL_RGB),
+				GL_UNSIGNED_BYTE,
+				texture->getDataPointer()
+		);
+
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	delete uncompressedTexture;
 
 	textureIDs[filename] = textureID;
 
 	return textureID;
 }
 
+GLuint GameGraphics::getTextureArrayID(std::string name, std::vector<std::string> filenames) {
+	// return the stored texture ID (or earlier failure) if it exists
+	if(textureArrayIDs.find(name) != textureArrayIDs.end())
+		return textureArrayIDs.find(name)->second;
+
+	textureArrayIDs[name] = 0;
+
+#ifdef GL_TEXTURE_2D_ARRAY_EXT
+	if(! supportsTextureArrays || filenames.size() == 0)
+		return 0;
+
+	// every layer has to share the first one's format and mip chain
+	std::vector<Texture*> layers;
+	for(size_t i = 0; i < filenames.size(); ++i) {
+		Texture* texture = getTexture(filenames[i]);
+
+		if(
+				texture->levels.size() == 0 ||
+				(texture->isCompressed() && ! supportsTextureCompression) ||
+				(i > 0 && (
+						texture->format != layers[0]->format ||
+						texture->levels.size() != layers[0]->levels.size() ||
+						texture->width != layers[0]->width ||
+						texture->height != layers[0]->height
+					))
+			) {
+			gameSystem->log(GameSystem::LOG_VERBOSE, "Textures for " + name + " cannot share an array texture.");
+
+			return 0;
+		}
+
+		layers.push_back(texture);
+	}
+
+	// load the layers into OpenGL
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, textureID);
+
+	GLenum internalFormat = GL_RGBA;
+	if(layers[0]->format == Texture::FORMAT_DXT1)
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	else if(layers[0]->format == Texture::FORMAT_DXT5)
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	for(size_t i = 0; i < layers[0]->levels.size(); ++i) {
+		const Texture::Level& level = layers[0]->levels[i];
+
+		// allocate the level for every layer, then fill in each
+		if(layers[0]->isCompressed())
+			glCompressedTexImage3D(
+					GL_TEXTURE_2D_ARRAY_EXT,
+					i,
+					internalFormat,
+					level.width,
+					level.height,
+					layers.size(),
+					0,
+					level.size * layers.size(),
+					NULL
+				);
+		else
+			glTexImage3D(
+					GL_TEXTURE_2D_ARRAY_EXT,
+					i,
+					GL_RGBA,
+					level.width,
+					level.height,
+					layers.size(),
+					0,
+					GL_RGBA,
+					GL_UNSIGNED_BYTE,
+					NULL
+				);
+
+		for(size_t p = 0; p < layers.size(); ++p) {
+			if(layers[p]->isCompressed())
+				glCompressedTexSubImage3D(
+						GL_TEXTURE_2D_ARRAY_EXT,
+						i,
+						0,
+						0,
+						p,
+						level.width,
+						level.height,
+						1,
+						internalFormat,
+						layers[p]->levels[i].size,
+						layers[p]->levels[i].data
+					);
+			else
+				glTexSubImage3D(
+						GL_TEXTURE_2D_ARRAY_EXT,
+						i,
+						0,
+						0,
+						p,
+						level.width,
+						level.height,
+						1,
+						GL_RGBA,
+						GL_UNSIGNED_BYTE,
+						layers[p]->levels[i].data
+					);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+
+	textureArrayIDs[name] = textureID;
+
+	return textureID;
+#else
+	return 0;
+#endif
+}
+
+bool GameGraphics::isVisible(const Vector3& center, float radius) {
+	if(viewFrustum.intersectsSphere(center, radius)) {
+		++visibleObjectCount;
+
+		return true;
+	}
+
+	++culledObjectCount;
+
+	return false;
+}
+
 void GameGraphics::startFrame() {
 	// update camera
-	if(currentCamera != NULL)
+	if(currentCamera != NULL) {
 		currentCamera->execute();
 
+		viewFrustum = Frustum(
+				currentCamera->mvMatrix *
+				(gameState != NULL && gameState->binoculars ? ppBinoMatrix : ppMatrix)
+			);
+	}
+
+	lastVisibleObjectCount = visibleObjectCount;
+	lastCulledObjectCount = culledObjectCount;
+	visibleObjectCount = 0;
+	culledObjectCount = 0;
+
 	// prepare OpenGL for rendering
+	if(sceneFramebufferID != 0)
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, sceneFramebufferID);
+
 	glViewport(0, 0, resolutionX, resolutionY);
 
 	// clear the screen
@@ -581,6 +896,19 @@ void GameGraphics::startFrame() {
 }
 
 void GameGraphics::finishFrame() {
+	// resolve the multisampled scene into the window
+	if(sceneFramebufferID != 0) {
+		glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, sceneFramebufferID);
+		glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, 0);
+		glBlitFramebufferEXT(
+				0, 0, resolutionX, resolutionY,
+				0, 0, resolutionX, resolutionY,
+				GL_COLOR_BUFFER_BIT,
+				GL_NEAREST
+			);
+		glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	}
+
 	// swap buffers
 	if(mainLoopModules.find(drawingMaster) == mainLoopModules.end())
 		glFinish();
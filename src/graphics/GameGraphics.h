@@ -8,30 +8,47 @@
 #include <string>
 #include <vector>
 
+#include "graphics/ShaderManager.h"
 #include "graphics/text/FontManager.h"
 #include "graphics/texture/Texture.h"
 #include "logic/Camera.h"
+#include "math/Frustum.h"
 #include "math/MatrixMath.h"
 #include "platform/OpenGLHeaders.h"
 
 class GameGraphics {
 private:
-	std::map<std::string, GLuint> vertexShaderIDs;
-	std::map<std::string, GLuint> fragmentShaderIDs;
-
-	std::map<std::string, GLuint> programIDs;
+	ShaderManager* shaderManager;
 
 	std::map<std::string, Texture*> textures;
 	std::map<std::string, GLuint> textureIDs;
+	std::map<std::string, GLuint> textureArrayIDs;
+
+	// offscreen multisampled target for each frame, resolved into the window
+	// in finishFrame() (zero when drawing straight to the window)
+	GLuint sceneFramebufferID, sceneColorRenderbufferID, sceneDepthRenderbufferID;
+
+	// detects whether a new video mode kept our OpenGL context
+	GLuint contextSentinelID;
+
+	// set once a context has shown it can't multisample offscreen, so that
+	// later windows get multisample buffers as soon as they are opened
+	static bool lacksSceneFramebuffer;
 
-	GLuint getShaderID(GLenum shaderType, std::string shaderName);
-	GLuint makeProgram(std::vector<GLuint> shaders);
+	void openWindow();
+	void adoptWindow();
+	void buildMatrices();
+	void buildSceneFramebuffer();
+	void destroySceneFramebuffer();
 
 public:
 	unsigned short int resolutionX, resolutionY;
 	float aspectRatio;	// X over Y
 	bool fullScreen;
 	bool supportsMultisampling;
+	bool supportsSceneFramebuffer;
+	bool supportsTextureCompression;
+	bool supportsTextureArrays;
 
 	Matrix4 idMatrix, opMatrix, ppMatrix, ppBinoMatrix/*, ppMatrixInverse*/;
 	float idMatrixArray[16], opMatrixArray[16], ppMatrixArray[16], ppBinoMatrixArray[16]/*, ppMatrixInverseArray[16]*/;
@@ -42,14 +59,37 @@ public:
 
 	Camera* currentCamera;
 
-	GameGraphics(bool fullScreen, bool testSystem = false);
+	// the view volume of the current frame, and how many objects were tested
+	// against it during this frame and the last complete one
+	Frustum viewFrustum;
+	unsigned int visibleObjectCount, culledObjectCount;
+	unsigned int lastVisibleObjectCount, lastCulledObjectCount;
+
+	// reuseWindow keeps the window already open (such as after a
+	// changeWindow() that lost the context) rather than setting its mode again
+	GameGraphics(bool fullScreen, bool testSystem = false, bool reuseWindow = false);
 	~GameGraphics();
 
+	// reconfigure without recreating the context, so programs, textures and
+	// buffers survive; changeWindow() returns false if the platform replaced
+	// the context anyway, in which case this object must be recreated
+	void applyMultisamplingLevel();
+	bool changeWindow(bool fullScreen);
+
 	GLuint getProgramID(std::string name);
 
 	Texture* getTexture(std::string fileName);
 	GLuint getTextureID(std::string fileName);
 
+	// stacks the named textures into the layers of one array texture, or
+	// returns zero if that isn't possible (no support, or layers that differ
+	// in size or format), in which case they must be drawn separately
+	GLuint getTextureArrayID(std::string name, std::vector<std::string> fileNames);
+
+	// tests a bounding sphere in world space against the view frustum and
+	// counts the result
+	bool isVisible(const Vector3& center, float radius);
+
 	void startFrame();
 	void finishFrame();
 };
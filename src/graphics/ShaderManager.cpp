@@ -0,0 +1,360 @@
+// ShaderManager.cpp
+// Dominicus
+
+#include "graphics/ShaderManager.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "core/GameSystem.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern Platform* platform;
+
+ShaderManager::ShaderManager() : supportsProgramBinary(false) {
+	// programs are cached per driver, so any change of driver (or its
+	// version) invalidates them
+	driverKey = hashText(14695981039346656037ULL, (const char*) glGetString(GL_VENDOR));
+	driverKey = hashText(driverKey, (const char*) glGetString(GL_RENDERER));
+	driverKey = hashText(driverKey, (const char*) glGetString(GL_VERSION));
+	driverKey = hashText(driverKey, (const char*) glGetString(GL_SHADING_LANGUAGE_VERSION));
+
+#ifdef GL_PROGRAM_BINARY_LENGTH
+	// a driver may expose the extension yet offer no formats to save in
+	if(strstr((const char*) glGetString(GL_EXTENSIONS), "GL_ARB_get_program_binary") != NULL) {
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+		supportsProgramBinary = formatCount > 0;
+	}
+#endif
+}
+
+ShaderManager::~ShaderManager() {
+	for(
+			std::map<std::string, GLuint>::iterator itr = programIDs.begin();
+			itr != programIDs.end();
+			++itr
+		) {
+		std::vector<GLuint>& shaders = programShaderIDs[itr->first];
+
+		for(size_t i = 0; i < shaders.size(); ++i) {
+			glDetachShader(itr->second, shaders[i]);
+			glDeleteShader(shaders[i]);
+		}
+
+		glDeleteProgram(itr->second);
+	}
+}
+
+std::string ShaderManager::readSource(std::string name, std::string extension) {
+	std::string filename = platform->dataPath + "/shaders/" + name + extension;
+
+	std::ifstream fileStream(filename.c_str(), std::ios::in | std::ios::binary);
+	std::stringstream source;
+	source << fileStream.rdbuf();
+
+	if(source.str().length() == 0)
+		gameSystem->log(GameSystem::LOG_FATAL,
+				std::string("The GLSL shader " +
+						filename +
+						" could not be opened for reading.").c_str()
+			);
+
+	return source.str();
+}
+
+uint64_t ShaderManager::hashText(uint64_t hash, const std::string& text) {
+	// FNV-1a, including the terminator so concatenations stay distinct
+	for(size_t i = 0; i <= text.length(); ++i) {
+		hash ^= (uint64_t) (uint8_t) (i < text.length() ? text[i] : '\0');
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+std::string ShaderManager::getCachePath(std::string name) {
+	return platform->cachePath + "/" + name + ".program";
+}
+
+bool ShaderManager::loadCachedProgram(PendingProgram& program) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+	if(! supportsProgramBinary)
+		return false;
+
+	std::string path = getCachePath(program.name);
+
+	size_t fileSize = 0;
+	const uint8_t* fileData = (const uint8_t*) platform->mapFile(path.c_str(), &fileSize);
+
+	if(fileData == NULL)
+		return false;
+
+	const CacheHeader* header = (const CacheHeader*) fileData;
+
+	if(
+			fileSize < sizeof(CacheHeader) ||
+			memcmp(header->magic, "DPRG", 4) != 0 ||
+			header->version != cacheVersion ||
+			header->key != program.key ||
+			sizeof(CacheHeader) + header->binaryLength > fileSize
+		) {
+		platform->unmapFile(fileData, fileSize);
+
+		return false;
+	}
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(
+			programID,
+			header->binaryFormat,
+			fileData + sizeof(CacheHeader),
+			header->binaryLength
+		);
+
+	platform->unmapFile(fileData, fileSize);
+
+	// the driver may still refuse a binary it wrote, in which case we start
+	// over from source and replace it
+	GLint result;
+	glGetProgramiv(programID, GL_LINK_STATUS, &result);
+
+	if(result == GL_FALSE) {
+		glDeleteProgram(programID);
+		while(glGetError() != GL_NO_ERROR);
+
+		return false;
+	}
+
+	program.programID = programID;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ShaderManager::writeCachedProgram(const PendingProgram& program) {
+#ifdef GL_PROGRAM_BINARY_LENGTH
+	if(! supportsProgramBinary)
+		return;
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program.programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+	if(binaryLength <= 0)
+		return;
+
+	std::vector<uint8_t> binary(binaryLength);
+	GLsizei writtenLength = 0;
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program.programID, binaryLength, &writtenLength, &binaryFormat, &binary[0]);
+
+	if(writtenLength <= 0)
+		return;
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+
+	memcpy(header.magic, "DPRG", 4);
+	header.version = cacheVersion;
+	header.key = program.key;
+	header.binaryFormat = (uint32_t) binaryFormat;
+	header.binaryLength = (uint32_t) writtenLength;
+
+	// write to a temporary file and rename it into place so a partially
+	// written cache is never picked up
+	std::string path = getCachePath(program.name);
+	std::string temporaryPath = path + ".tmp";
+	FILE* cacheFile = fopen(temporaryPath.c_str(), "wb");
+
+	if(cacheFile == NULL) {
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write shader program cache file " + path + ".");
+
+		return;
+	}
+
+	bool writeSucceeded =
+			fwrite(&header, sizeof(CacheHeader), 1, cacheFile) == 1 &&
+			fwrite(&binary[0], 1, writtenLength, cacheFile) == (size_t) writtenLength;
+
+	if(fclose(cacheFile) != 0 || ! writeSucceeded || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		remove(temporaryPath.c_str());
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write shader program cache file " + path + ".");
+	}
+#endif
+}
+
+void ShaderManager::checkShader(GLuint shader, std::string filename) {
+	GLint result;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+
+	if(result == GL_FALSE) {
+		std::stringstream err;
+		err << "The GLSL shader "
+				<< filename
+				<< " did not compile successfully."
+				<< std::endl << std::endl;
+
+		GLint sourceLength;
+		glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &sourceLength);
+		GLchar* sourceLines = new GLchar[sourceLength];
+		glGetShaderSource(shader, sourceLength, NULL, sourceLines);
+
+		err << "SHADER SOURCE ON GPU" << std::endl
+				<< "--------------------" << std::endl
+				<< sourceLines
+				<< "--------------------" << std::endl << std::endl;
+		delete[] sourceLines;
+
+		GLint logLength;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+		GLchar* logLines = new GLchar[logLength];
+		glGetShaderInfoLog(shader, logLength, NULL, logLines);
+
+		err << "ERROR LOG" << std::endl
+				<< "---------" << std::endl
+				<< logLines
+				<< "---------";
+
+		delete[] logLines;
+
+		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
+	}
+}
+
+void ShaderManager::checkProgram(GLuint program, std::string name) {
+	GLint result;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+
+	if(result == GL_FALSE) {
+		std::stringstream err;
+		err << "The GLSL shader program " << name << " did not link successfully." << std::endl << std::endl;
+
+		GLint logLength;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		GLchar* logLines = new GLchar[logLength];
+		glGetProgramInfoLog(program, logLength, NULL, logLines);
+
+		err << "ERROR LOG" << std::endl
+				<< "---------" << std::endl
+				<< logLines
+				<< "---------";
+
+		delete[] logLines;
+
+		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
+	}
+}
+
+void ShaderManager::build(std::vector<PendingProgram>& programs) {
+	// read everything and take what we can from the cache
+	for(size_t i = 0; i < programs.size(); ++i) {
+		PendingProgram& program = programs[i];
+
+		program.vertexSource = readSource(program.name, ".vertex.glsl");
+		program.fragmentSource = readSource(program.name, ".fragment.glsl");
+		program.key = hashText(hashText(driverKey, program.vertexSource), program.fragmentSource);
+		program.vertexShaderID = 0;
+		program.fragmentShaderID = 0;
+		program.programID = 0;
+
+		loadCachedProgram(program);
+	}
+
+	// submit every compile and then every link before asking about any of
+	// them, since querying a status forces the driver to finish that work
+	// (threaded drivers can otherwise overlap it)
+	for(size_t i = 0; i < programs.size(); ++i) {
+		PendingProgram& program = programs[i];
+
+		if(program.programID != 0)
+			continue;
+
+		const GLchar* vertexSource = program.vertexSource.c_str();
+		program.vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(program.vertexShaderID, 1, &vertexSource, NULL);
+		glCompileShader(program.vertexShaderID);
+
+		const GLchar* fragmentSource = program.fragmentSource.c_str();
+		program.fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(program.fragmentShaderID, 1, &fragmentSource, NULL);
+		glCompileShader(program.fragmentShaderID);
+	}
+
+	for(size_t i = 0; i < programs.size(); ++i) {
+		PendingProgram& program = programs[i];
+
+		if(program.vertexShaderID == 0)
+			continue;
+
+		program.programID = glCreateProgram();
+		glAttachShader(program.programID, program.vertexShaderID);
+		glAttachShader(program.programID, program.fragmentShaderID);
+#ifdef GL_PROGRAM_BINARY_LENGTH
+		if(supportsProgramBinary)
+			glProgramParameteri(program.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+		glLinkProgram(program.programID);
+	}
+
+	for(size_t i = 0; i < programs.size(); ++i) {
+		PendingProgram& program = programs[i];
+
+		if(program.vertexShaderID != 0) {
+			checkShader(program.vertexShaderID, platform->dataPath + "/shaders/" + program.name + ".vertex.glsl");
+			checkShader(program.fragmentShaderID, platform->dataPath + "/shaders/" + program.name + ".fragment.glsl");
+			checkProgram(program.programID, program.name);
+
+			writeCachedProgram(program);
+
+			programShaderIDs[program.name].push_back(program.vertexShaderID);
+			programShaderIDs[program.name].push_back(program.fragmentShaderID);
+		}
+
+		programIDs[program.name] = program.programID;
+	}
+}
+
+void ShaderManager::precompile(std::vector<std::string> names) {
+	unsigned int startTime = platform->getExecMills();
+
+	std::vector<PendingProgram> programs;
+	for(size_t i = 0; i < names.size(); ++i) {
+		if(programIDs.find(names[i]) != programIDs.end())
+			continue;
+
+		programs.push_back(PendingProgram());
+		programs.back().name = names[i];
+	}
+
+	build(programs);
+
+	size_t cachedCount = 0;
+	for(size_t i = 0; i < programs.size(); ++i)
+		if(programs[i].vertexShaderID == 0)
+			++cachedCount;
+
+	std::stringstream message;
+	message << "Prepared " << programs.size() << " shader programs (" << cachedCount << " from cache) in " <<
+			(platform->getExecMills() - startTime) << " ms.";
+	gameSystem->log(GameSystem::LOG_VERBOSE, message.str().c_str());
+}
+
+GLuint ShaderManager::getProgramID(std::string name) {
+	std::map<std::string, GLuint>::iterator itr = programIDs.find(name);
+
+	if(itr != programIDs.end())
+		return itr->second;
+
+	// not precompiled, so build it on its own
+	std::vector<PendingProgram> programs(1);
+	programs[0].name = name;
+	build(programs);
+
+	return programIDs[name];
+}
@@ -0,0 +1,69 @@
+// ShaderManager.h
+// Dominicus
+
+#ifndef SHADERMANAGER_H
+#define SHADERMANAGER_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "platform/OpenGLHeaders.h"
+
+class ShaderManager {
+private:
+	// a linked program cache file holds this header followed by the binary
+	// the driver gave us, and is only used if the driver and both sources
+	// hash to the same key
+	static const uint32_t cacheVersion = 1;
+
+	struct CacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t binaryFormat;
+		uint32_t binaryLength;
+	};
+
+	// a program on its way from source to linked
+	struct PendingProgram {
+		std::string name;
+		std::string vertexSource, fragmentSource;
+		uint64_t key;
+		GLuint vertexShaderID, fragmentShaderID;
+		GLuint programID;
+	};
+
+	std::map<std::string, GLuint> programIDs;
+
+	// shaders remain attached to the programs linked from source
+	std::map<std::string, std::vector<GLuint> > programShaderIDs;
+
+	bool supportsProgramBinary;
+	uint64_t driverKey;
+
+	std::string readSource(std::string name, std::string extension);
+	uint64_t hashText(uint64_t hash, const std::string& text);
+	std::string getCachePath(std::string name);
+
+	bool loadCachedProgram(PendingProgram& program);
+	void writeCachedProgram(const PendingProgram& program);
+
+	void checkShader(GLuint shader, std::string filename);
+	void checkProgram(GLuint program, std::string name);
+
+	void build(std::vector<PendingProgram>& programs);
+
+public:
+	ShaderManager();
+	~ShaderManager();
+
+	// loads or compiles all of the named programs in one pass, submitting
+	// every compile and link before waiting on any result
+	void precompile(std::vector<std::string> names);
+
+	GLuint getProgramID(std::string name);
+};
+
+#endif // SHADERMANAGER_H
@@ -112,26 +112,15 @@ void FontManager::rebuildFontTextureCache(unsigned int size) {
 		);
 
 	// set all pixels to white with no alpha since our crappy drawer has to use linear sampling
-	for(size_t i = 0; i < thisFontCache->width; ++i)
-		for(size_t p = 0; p < thisFontCache->height; ++p)
-			thisFontCache->setColorAt(i, p, 0xFF, 0xFF, 0xFF, 0);
+	thisFontCache->fill(0xFF, 0xFF, 0xFF, 0);
 
 	// copy the bitmaps into the texture and assign the element info
 	unsigned int xIndex = 0, yIndex = 0;
 	for(unsigned int i = 0; i < charList.size(); ++i) {
-		// copy each pixel row by row, column by column
+		// copy the glyph into its cell
 		Texture* thisGlyph = fontData[charList[i]][size].bitmap;
 
-		for(unsigned int x = 0; x < thisGlyph->width; ++x)
-			for(unsigned int y = 0; y < thisGlyph->height; ++y)
-				thisFontCache->setColorAt(
-						xIndex * maxX + x,
-						yIndex * maxY + y,
-						thisGlyph->getRedValueAt(x, y),
-						thisGlyph->getGreenValueAt(x, y),
-						thisGlyph->getBlueValueAt(x, y),
-						thisGlyph->getAlphaValueAt(x, y)
-					);
+		thisFontCache->blit(thisGlyph, 0, 0, thisGlyph->width, thisGlyph->height, xIndex * maxX, yIndex * maxY);
 
 		// assign the texture coordinate info
 		fontData[charList[i]][size].sX = positiveNormalize(xIndex * maxX, thisFontCache->width);
@@ -245,25 +234,18 @@ void FontManager::buildChar(const char character, unsigned int size, bool rebuil
 			Texture::FORMAT_RGBA
 		);
 
-	// set all pixels to white with no alpha since our crappy drawer has to use linear sampling
-	for(size_t i = 0; i < thisData.width; ++i)
-		for(size_t p = 0; p < thisData.height; ++p)
-			thisData.bitmap->setColorAt(i, p, 0xFF, 0xFF, 0xFF, 0);
-
-	for(int y = 0; y < fontFace->glyph->bitmap.rows; ++y) {
-		for(int x = 0; x < fontFace->glyph->bitmap.width; ++x) {
-			// get the location for the value of this pixel
-			uint8_t* value =
-					fontFace->glyph->bitmap.buffer +
-					(fontFace->glyph->bitmap.rows - y - 1) *
-					fontFace->glyph->bitmap.pitch +	// pitch = amount of memory per row
-					x;
-
-			// set the color to white and the alpha to the retrieved value
-			if(*value)
-				thisData.bitmap->setColorAt(x, y, 0xFF, 0xFF, 0xFF, *value);
-		}
-	}
+	// set all pixels to white with the coverage as alpha (white even where
+	// uncovered, since our crappy drawer has to use linear sampling)
+	for(int y = 0; y < fontFace->glyph->bitmap.rows; ++y)
+		thisData.bitmap->setRowFromAlpha(
+				y,
+				fontFace->glyph->bitmap.buffer +
+						(fontFace->glyph->bitmap.rows - y - 1) *
+						fontFace->glyph->bitmap.pitch,	// pitch = amount of memory per row
+				0xFF,
+				0xFF,
+				0xFF
+			);
 
 	// store it
 	fontData[character][size] = thisData;
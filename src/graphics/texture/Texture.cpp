@@ -3,15 +3,291 @@
 
 #include "graphics/texture/Texture.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
 
 #include "core/GameSystem.h"
+#include "math/ScalarMath.h"
+#include "platform/Platform.h"
 
 extern GameSystem* gameSystem;
+extern Platform* platform;
+
+// halve an RGBA image with a box filter (clamping at odd edges)
+static void downsampleLevel(
+		const uint8_t* source,
+		uint32_t sourceWidth,
+		uint32_t sourceHeight,
+		uint8_t* destination,
+		uint32_t destinationWidth,
+		uint32_t destinationHeight
+	) {
+	for(uint32_t y = 0; y < destinationHeight; ++y) {
+		uint32_t row0 = std::min(y * 2, sourceHeight - 1);
+		uint32_t row1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+		for(uint32_t x = 0; x < destinationWidth; ++x) {
+			uint32_t column0 = std::min(x * 2, sourceWidth - 1);
+			uint32_t column1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+			for(uint32_t c = 0; c < 4; ++c)
+				destination[(y * destinationWidth + x) * 4 + c] = (uint8_t) ((
+						(unsigned int) source[(row0 * sourceWidth + column0) * 4 + c] +
+						(unsigned int) source[(row0 * sourceWidth + column1) * 4 + c] +
+						(unsigned int) source[(row1 * sourceWidth + column0) * 4 + c] +
+						(unsigned int) source[(row1 * sourceWidth + column1) * 4 + c] +
+						2
+					) / 4);
+		}
+	}
+}
+
+static uint16_t packColor565(const float color[3]) {
+	int red = (int) (std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	int green = (int) (std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	int blue = (int) (std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+
+	return (uint16_t) ((red << 11) | (green << 5) | blue);
+}
+
+static void unpackColor565(uint16_t packed, int color[3]) {
+	color[0] = ((packed >> 11) & 0x1F) * 255 / 31;
+	color[1] = ((packed >> 5) & 0x3F) * 255 / 63;
+	color[2] = (packed & 0x1F) * 255 / 31;
+}
+
+// choose the four-color BC1 palette entry nearest each pixel, returning the
+// total squared error (or the single color's error if the endpoints match)
+static int selectColorIndices(const uint8_t pixels[16][4], uint16_t color0, uint16_t color1, uint32_t* indices) {
+	int palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for(size_t c = 0; c < 3; ++c) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	// equal endpoints would mean three-color mode, where index three is
+	// transparent, so only the first entry may be used
+	uint32_t paletteSize = (color0 == color1 ? 1 : 4);
+
+	int totalError = 0;
+	*indices = 0;
+
+	for(size_t i = 0; i < 16; ++i) {
+		uint32_t bestIndex = 0;
+		int bestError = -1;
+
+		for(uint32_t p = 0; p < paletteSize; ++p) {
+			int error = 0;
+			for(size_t c = 0; c < 3; ++c)
+				error += (pixels[i][c] - palette[p][c]) * (pixels[i][c] - palette[p][c]);
+
+			if(bestError < 0 || error < bestError) {
+				bestIndex = p;
+				bestError = error;
+			}
+		}
+
+		*indices |= bestIndex << (i * 2);
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+// order endpoints for four-color mode, which needs the first to be greater
+static void orderColorEndpoints(uint16_t* color0, uint16_t* color1) {
+	if(*color0 < *color1) {
+		uint16_t swap = *color0;
+		*color0 = *color1;
+		*color1 = swap;
+	}
+}
+
+// encode the colors of a 4x4 RGBA block as BC1 in four-color mode, with
+// endpoints at the extremes of the block along its principal axis and then
+// refit by least squares to the resulting indices
+static void encodeColorBlock(const uint8_t pixels[16][4], uint8_t* destination) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for(size_t i = 0; i < 16; ++i)
+		for(size_t c = 0; c < 3; ++c)
+			mean[c] += pixels[i][c] / 16.0f;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for(size_t i = 0; i < 16; ++i) {
+		float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for(size_t iteration = 0; iteration < 8; ++iteration) {
+		float next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+		float length = maximum(maximum(absolute(next[0]), absolute(next[1])), absolute(next[2]));
+
+		if(length < 1e-6f)
+			break;
+
+		for(size_t c = 0; c < 3; ++c)
+			axis[c] = next[c] / length;
+	}
+
+	float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float minimumProjection = 0.0f, maximumProjection = 0.0f;
+	for(size_t i = 0; i < 16; ++i) {
+		float projection = (
+				(pixels[i][0] - mean[0]) * axis[0] +
+				(pixels[i][1] - mean[1]) * axis[1] +
+				(pixels[i][2] - mean[2]) * axis[2]
+			) / axisLength;
+
+		minimumProjection = minimum(minimumProjection, projection);
+		maximumProjection = maximum(maximumProjection, projection);
+	}
+
+	float endpoint0[3], endpoint1[3];
+	for(size_t c = 0; c < 3; ++c) {
+		endpoint0[c] = mean[c] + axis[c] * maximumProjection;
+		endpoint1[c] = mean[c] + axis[c] * minimumProjection;
+	}
+
+	uint16_t color0 = packColor565(endpoint0);
+	uint16_t color1 = packColor565(endpoint1);
+	orderColorEndpoints(&color0, &color1);
+
+	uint32_t indices;
+	int error = selectColorIndices(pixels, color0, color1, &indices);
+
+	// solve for the endpoints that best reproduce the block with these
+	// indices, keeping them if they do better
+	if(color0 != color1) {
+		const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float alphaSquared = 0.0f, betaSquared = 0.0f, alphaBeta = 0.0f;
+		float alphaColor[3] = { 0.0f, 0.0f, 0.0f }, betaColor[3] = { 0.0f, 0.0f, 0.0f };
+
+		for(size_t i = 0; i < 16; ++i) {
+			float alpha = weights[(indices >> (i * 2)) & 3];
+			float beta = 1.0f - alpha;
+
+			alphaSquared += alpha * alpha;
+			betaSquared += beta * beta;
+			alphaBeta += alpha * beta;
+			for(size_t c = 0; c < 3; ++c) {
+				alphaColor[c] += alpha * pixels[i][c];
+				betaColor[c] += beta * pixels[i][c];
+			}
+		}
+
+		float determinant = alphaSquared * betaSquared - alphaBeta * alphaBeta;
+
+		if(absolute(determinant) > 1e-6f) {
+			for(size_t c = 0; c < 3; ++c) {
+				endpoint0[c] = (alphaColor[c] * betaSquared - betaColor[c] * alphaBeta) / determinant;
+				endpoint1[c] = (betaColor[c] * alphaSquared - alphaColor[c] * alphaBeta) / determinant;
+			}
+
+			uint16_t refinedColor0 = packColor565(endpoint0);
+			uint16_t refinedColor1 = packColor565(endpoint1);
+			orderColorEndpoints(&refinedColor0, &refinedColor1);
+
+			uint32_t refinedIndices;
+			int refinedError = selectColorIndices(pixels, refinedColor0, refinedColor1, &refinedIndices);
+
+			if(refinedError < error) {
+				color0 = refinedColor0;
+				color1 = refinedColor1;
+				indices = refinedIndices;
+			}
+		}
+	}
 
-Texture::Texture(uint32_t newWidth, uint32_t newHeight, PixelFormat newFormat) {
+	destination[0] = (uint8_t) (color0 & 0xFF);
+	destination[1] = (uint8_t) (color0 >> 8);
+	destination[2] = (uint8_t) (color1 & 0xFF);
+	destination[3] = (uint8_t) (color1 >> 8);
+	for(size_t i = 0; i < 4; ++i)
+		destination[4 + i] = (uint8_t) ((indices >> (i * 8)) & 0xFF);
+}
+
+// encode the alpha of a 4x4 RGBA block as BC3's eight-level alpha block
+static void encodeAlphaBlock(const uint8_t pixels[16][4], uint8_t* destination) {
+	int alpha0 = 0, alpha1 = 255;
+	for(size_t i = 0; i < 16; ++i) {
+		alpha0 = std::max(alpha0, (int) pixels[i][3]);
+		alpha1 = std::min(alpha1, (int) pixels[i][3]);
+	}
+
+	uint64_t indices = 0;
+
+	if(alpha0 != alpha1) {
+		int palette[8];
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		for(int p = 1; p < 7; ++p)
+			palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+		for(size_t i = 0; i < 16; ++i) {
+			uint64_t bestIndex = 0;
+			for(uint64_t p = 1; p < 8; ++p)
+				if(abs(pixels[i][3] - palette[p]) < abs(pixels[i][3] - palette[bestIndex]))
+					bestIndex = p;
+
+			indices |= bestIndex << (i * 3);
+		}
+	}
+
+	destination[0] = (uint8_t) alpha0;
+	destination[1] = (uint8_t) alpha1;
+	for(size_t i = 0; i < 6; ++i)
+		destination[2 + i] = (uint8_t) ((indices >> (i * 8)) & 0xFF);
+}
+
+// block compress an RGBA image, clamping partial blocks at the edges
+static void compressLevel(
+		const uint8_t* source,
+		uint32_t width,
+		uint32_t height,
+		Texture::PixelFormat format,
+		uint8_t* destination
+	) {
+	for(uint32_t blockY = 0; blockY < height; blockY += 4) {
+		for(uint32_t blockX = 0; blockX < width; blockX += 4) {
+			uint8_t pixels[16][4];
+			for(uint32_t y = 0; y < 4; ++y)
+				for(uint32_t x = 0; x < 4; ++x)
+					memcpy(
+							pixels[y * 4 + x],
+							source + (std::min(blockY + y, height - 1) * width + std::min(blockX + x, width - 1)) * 4,
+							4
+						);
+
+			if(format == Texture::FORMAT_DXT5) {
+				encodeAlphaBlock(pixels, destination);
+				destination += 8;
+			}
+
+			encodeColorBlock(pixels, destination);
+			destination += 8;
+		}
+	}
+}
+
+Texture::Texture(uint32_t newWidth, uint32_t newHeight, PixelFormat newFormat) :
+		mappedData(NULL),
+		mappedSize(0) {
 	width = newWidth;
 	height = newHeight;
 	format = newFormat;
@@ -30,7 +306,41 @@ Texture::Texture(uint32_t newWidth, uint32_t newHeight, PixelFormat newFormat) {
 	memset(pixelData, 0, memSize);
 }
 
-Texture::Texture(std::string filename) {
+Texture::Texture(std::string filename, uint32_t compression) :
+		pixelData(NULL),
+		mappedData(NULL),
+		mappedSize(0) {
+	// name the cooked copy after the path within the texture folder
+	std::string cacheName = filename;
+	std::string texturesPath = platform->dataPath + "/data/textures/";
+	if(cacheName.compare(0, texturesPath.length(), texturesPath) == 0)
+		cacheName = cacheName.substr(texturesPath.length());
+	if(cacheName.rfind(".png") == cacheName.length() - 4)
+		cacheName = cacheName.substr(0, cacheName.length() - 4);
+	for(size_t i = 0; i < cacheName.length(); ++i)
+		if(cacheName[i] == '/')
+			cacheName[i] = '.';
+
+	size_t sourceSize = 0;
+	int64_t sourceModificationTime = 0;
+	if(! platform->getFileInfo(filename.c_str(), &sourceSize, &sourceModificationTime))
+		gameSystem->log(
+				GameSystem::LOG_FATAL,
+				std::string("The PNG image file " +
+						std::string(filename) +
+						" could not be opened for reading.").c_str()
+			);
+
+	// each compression setting gets its own copy, so an uncompressed fallback
+	// never displaces the usual one
+	std::stringstream cachePath;
+	cachePath << platform->cachePath << "/" << cacheName << "." << compression << ".texture";
+
+	// use the cooked texture if it is current, otherwise decode the PNG and
+	// cook it for next time
+	if(loadCache(cachePath.str(), sourceSize, sourceModificationTime, compression))
+		return;
+
 	png_image pngImage;
 
 	memset(&pngImage, 0, (sizeof pngImage));
@@ -47,9 +357,11 @@ Texture::Texture(std::string filename) {
 
 	pngImage.format = PNG_FORMAT_RGBA;
 
-	png_bytep dataBuffer = new unsigned char[PNG_IMAGE_SIZE(pngImage)];
+	// a negative row stride has libpng store the rows bottom-up, which is the
+	// order OpenGL expects, so the image needs no flipping afterward
+	pixelData = new unsigned char[PNG_IMAGE_SIZE(pngImage)];
 
-	if(dataBuffer == NULL || ! png_image_finish_read(&pngImage, NULL, dataBuffer, 0, NULL))
+	if(! png_image_finish_read(&pngImage, NULL, pixelData, -(png_int_32) PNG_IMAGE_ROW_STRIDE(pngImage), NULL))
 		gameSystem->log(
 				GameSystem::LOG_FATAL,
 				std::string("Could not read image data from PNG texture file " +
@@ -57,24 +369,334 @@ Texture::Texture(std::string filename) {
 						".").c_str()
 			);
 
-	// flip the image vertically
-	pixelData = new unsigned char[PNG_IMAGE_SIZE(pngImage)];
-
-	for(size_t y = 0; y < pngImage.height; ++y)
-		for(size_t x = 0; x < pngImage.width; ++x)
-			for(size_t i = 0; i < 4; ++i)
-				pixelData[(pngImage.height - 1 - y) * pngImage.width * 4 + x * 4 + i] =
-						dataBuffer[y * pngImage.width * 4 + x * 4 + i];
-
-	delete[] dataBuffer;
-
 	format = FORMAT_RGBA;
 	width = pngImage.width;
 	height = pngImage.height;
+
+	cook(compression);
+	writeCache(cachePath.str(), sourceSize, sourceModificationTime, compression);
 }
 
 Texture::~Texture() {
 	delete[] pixelData;
+	platform->unmapFile(mappedData, mappedSize);
+}
+
+bool Texture::loadCache(std::string path, size_t sourceSize, int64_t sourceModificationTime, uint32_t compression) {
+	size_t fileSize = 0;
+	const uint8_t* fileData = (const uint8_t*) platform->mapFile(path.c_str(), &fileSize);
+
+	if(fileData == NULL)
+		return false;
+
+	// validate the header against the current format, source file and
+	// compression setting, and every level against the file's extent
+	const CacheHeader* header = (const CacheHeader*) fileData;
+
+	bool valid =
+			fileSize >= sizeof(CacheHeader) &&
+			memcmp(header->magic, "DTEX", 4) == 0 &&
+			header->version == cacheVersion &&
+			header->sourceSize == (uint64_t) sourceSize &&
+			header->sourceModificationTime == sourceModificationTime &&
+			header->compression == compression &&
+			header->levelCount > 0 &&
+			sizeof(CacheHeader) + header->levelCount * sizeof(CacheLevel) <= fileSize;
+
+	const CacheLevel* cacheLevels = (const CacheLevel*) (fileData + sizeof(CacheHeader));
+
+	for(uint32_t i = 0; valid && i < header->levelCount; ++i)
+		valid = (size_t) cacheLevels[i].offset + cacheLevels[i].size <= fileSize;
+
+	if(! valid) {
+		platform->unmapFile(fileData, fileSize);
+
+		return false;
+	}
+
+	format = (PixelFormat) header->format;
+	width = header->width;
+	height = header->height;
+
+	levels.resize(header->levelCount);
+	for(uint32_t i = 0; i < header->levelCount; ++i) {
+		levels[i].width = cacheLevels[i].width;
+		levels[i].height = cacheLevels[i].height;
+		levels[i].data = fileData + cacheLevels[i].offset;
+		levels[i].size = cacheLevels[i].size;
+	}
+
+	mappedData = fileData;
+	mappedSize = fileSize;
+
+	return true;
+}
+
+void Texture::cook(uint32_t compression) {
+	// opaque textures always compress well, while translucent ones (mostly
+	// interface art with crisp edges) only compress at the higher setting
+	bool opaque = true;
+	for(size_t i = 0; opaque && i < (size_t) width * height; ++i)
+		opaque = pixelData[i * 4 + 3] == 0xFF;
+
+	PixelFormat cookedFormat = FORMAT_RGBA;
+	if(compression >= 2 || (compression == 1 && opaque))
+		cookedFormat = (opaque ? FORMAT_DXT1 : FORMAT_DXT5);
+
+	// lay out the whole chain down to one pixel, keeping each level aligned
+	std::vector<CacheLevel> cookedLevels;
+	uint32_t levelWidth = width, levelHeight = height;
+	size_t totalSize = 0;
+
+	while(true) {
+		CacheLevel level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.offset = (uint32_t) totalSize;
+
+		if(cookedFormat == FORMAT_RGBA)
+			level.size = levelWidth * levelHeight * 4;
+		else
+			level.size = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * (cookedFormat == FORMAT_DXT1 ? 8 : 16);
+
+		cookedLevels.push_back(level);
+		totalSize += (level.size + 3) & ~3;
+
+		if(levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = std::max(levelWidth / 2, (uint32_t) 1);
+		levelHeight = std::max(levelHeight / 2, (uint32_t) 1);
+	}
+
+	png_bytep cookedData = new uint8_t[totalSize];
+
+	std::vector<uint8_t> levelPixels(pixelData, pixelData + (size_t) width * height * 4);
+	std::vector<uint8_t> nextPixels;
+
+	for(size_t i = 0; i < cookedLevels.size(); ++i) {
+		if(i > 0) {
+			nextPixels.resize((size_t) cookedLevels[i].width * cookedLevels[i].height * 4);
+			downsampleLevel(
+					&levelPixels[0],
+					cookedLevels[i - 1].width,
+					cookedLevels[i - 1].height,
+					&nextPixels[0],
+					cookedLevels[i].width,
+					cookedLevels[i].height
+				);
+			levelPixels.swap(nextPixels);
+		}
+
+		if(cookedFormat == FORMAT_RGBA)
+			memcpy(cookedData + cookedLevels[i].offset, &levelPixels[0], cookedLevels[i].size);
+		else
+			compressLevel(
+					&levelPixels[0],
+					cookedLevels[i].width,
+					cookedLevels[i].height,
+					cookedFormat,
+					cookedData + cookedLevels[i].offset
+				);
+	}
+
+	delete[] pixelData;
+	pixelData = cookedData;
+	format = cookedFormat;
+
+	levels.resize(cookedLevels.size());
+	for(size_t i = 0; i < cookedLevels.size(); ++i) {
+		levels[i].width = cookedLevels[i].width;
+		levels[i].height = cookedLevels[i].height;
+		levels[i].data = pixelData + cookedLevels[i].offset;
+		levels[i].size = cookedLevels[i].size;
+	}
+}
+
+void Texture::writeCache(std::string path, size_t sourceSize, int64_t sourceModificationTime, uint32_t compression) {
+	CacheHeader header;
+	memset(&header, 0, sizeof(CacheHeader));
+
+	memcpy(header.magic, "DTEX", 4);
+	header.version = cacheVersion;
+	header.sourceSize = (uint64_t) sourceSize;
+	header.sourceModificationTime = sourceModificationTime;
+	header.compression = compression;
+	header.format = (uint32_t) format;
+	header.width = width;
+	header.height = height;
+	header.levelCount = levels.size();
+
+	// the level table's offsets are relative to the data, so shift them past
+	// the header and table
+	uint32_t dataOffset = sizeof(CacheHeader) + levels.size() * sizeof(CacheLevel);
+	std::vector<CacheLevel> cacheLevels(levels.size());
+	for(size_t i = 0; i < levels.size(); ++i) {
+		cacheLevels[i].width = levels[i].width;
+		cacheLevels[i].height = levels[i].height;
+		cacheLevels[i].offset = dataOffset + (uint32_t) (levels[i].data - levels[0].data);
+		cacheLevels[i].size = (uint32_t) levels[i].size;
+	}
+
+	size_t dataSize = (size_t) (levels.back().data - levels[0].data) + ((levels.back().size + 3) & ~3);
+
+	// write to a temporary file and rename it into place so a partially
+	// written cache is never picked up
+	std::string temporaryPath = path + ".tmp";
+	FILE* cacheFile = fopen(temporaryPath.c_str(), "wb");
+
+	if(cacheFile == NULL) {
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write texture cache file " + path + ".");
+
+		return;
+	}
+
+	bool writeSucceeded =
+			fwrite(&header, sizeof(CacheHeader), 1, cacheFile) == 1 &&
+			fwrite(&cacheLevels[0], sizeof(CacheLevel), cacheLevels.size(), cacheFile) == cacheLevels.size() &&
+			fwrite(levels[0].data, 1, dataSize, cacheFile) == dataSize;
+
+	if(fclose(cacheFile) != 0 || ! writeSucceeded || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		remove(temporaryPath.c_str());
+		gameSystem->log(GameSystem::LOG_VERBOSE, "Unable to write texture cache file " + path + ".");
+	}
+}
+
+void Texture::checkRegion(uint32_t column, uint32_t row, uint32_t regionWidth, uint32_t regionHeight) {
+	if(pixelData == NULL || levels.size() > 0)
+		gameSystem->log(GameSystem::LOG_FATAL, "Texture pixels accessed without an in-memory image.");
+	if(column > width || row > height || regionWidth > width - column || regionHeight > height - row) {
+		std::stringstream err;
+		err << "Texture region out-of-bounds at " <<
+				column << "," <<
+				row << " size " <<
+				regionWidth << "," <<
+				regionHeight << " (dimensions " <<
+				width << "," <<
+				height << ").";
+
+		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
+	}
+}
+
+void Texture::fill(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+	checkRegion(0, 0, width, height);
+
+	if(width == 0 || height == 0)
+		return;
+
+	// build the first row and copy it to the rest
+	size_t rowSize = getRowSize();
+
+	if(format == FORMAT_RGBA) {
+		PixelRGBA* pixels = getRowRGBA(0);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = red;
+			pixels[i].green = green;
+			pixels[i].blue = blue;
+			pixels[i].alpha = alpha;
+		}
+	} else {
+		PixelRGB* pixels = getRowRGB(0);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = red;
+			pixels[i].green = green;
+			pixels[i].blue = blue;
+		}
+	}
+
+	for(uint32_t i = 1; i < height; ++i)
+		memcpy(pixelData + i * rowSize, pixelData, rowSize);
+}
+
+void Texture::blit(
+		Texture* source,
+		uint32_t sourceColumn,
+		uint32_t sourceRow,
+		uint32_t blitWidth,
+		uint32_t blitHeight,
+		uint32_t destinationColumn,
+		uint32_t destinationRow
+	) {
+	source->checkRegion(sourceColumn, sourceRow, blitWidth, blitHeight);
+	checkRegion(destinationColumn, destinationRow, blitWidth, blitHeight);
+
+	for(uint32_t i = 0; i < blitHeight; ++i) {
+		if(source->format == format) {
+			memcpy(
+					pixelData + (destinationRow + i) * getRowSize() + destinationColumn * getPixelSize(),
+					source->pixelData + (sourceRow + i) * source->getRowSize() + sourceColumn * getPixelSize(),
+					blitWidth * getPixelSize()
+				);
+		} else if(format == FORMAT_RGBA) {
+			const PixelRGB* sourcePixels = source->getRowRGB(sourceRow + i) + sourceColumn;
+			PixelRGBA* destinationPixels = getRowRGBA(destinationRow + i) + destinationColumn;
+
+			for(uint32_t p = 0; p < blitWidth; ++p) {
+				destinationPixels[p].red = sourcePixels[p].red;
+				destinationPixels[p].green = sourcePixels[p].green;
+				destinationPixels[p].blue = sourcePixels[p].blue;
+				destinationPixels[p].alpha = 0xFF;
+			}
+		} else {
+			const PixelRGBA* sourcePixels = source->getRowRGBA(sourceRow + i) + sourceColumn;
+			PixelRGB* destinationPixels = getRowRGB(destinationRow + i) + destinationColumn;
+
+			for(uint32_t p = 0; p < blitWidth; ++p) {
+				destinationPixels[p].red = sourcePixels[p].red;
+				destinationPixels[p].green = sourcePixels[p].green;
+				destinationPixels[p].blue = sourcePixels[p].blue;
+			}
+		}
+	}
+}
+
+void Texture::setRowFromLuminance(uint32_t row, const uint8_t* values) {
+	checkRegion(0, row, width, 1);
+
+	if(format == FORMAT_RGBA) {
+		PixelRGBA* pixels = getRowRGBA(row);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = values[i];
+			pixels[i].green = values[i];
+			pixels[i].blue = values[i];
+			pixels[i].alpha = 0xFF;
+		}
+	} else {
+		PixelRGB* pixels = getRowRGB(row);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = values[i];
+			pixels[i].green = values[i];
+			pixels[i].blue = values[i];
+		}
+	}
+}
+
+void Texture::setRowFromAlpha(uint32_t row, const uint8_t* values, uint8_t red, uint8_t green, uint8_t blue) {
+	checkRegion(0, row, width, 1);
+
+	if(format == FORMAT_RGBA) {
+		PixelRGBA* pixels = getRowRGBA(row);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = red;
+			pixels[i].green = green;
+			pixels[i].blue = blue;
+			pixels[i].alpha = values[i];
+		}
+	} else {
+		PixelRGB* pixels = getRowRGB(row);
+
+		for(uint32_t i = 0; i < width; ++i) {
+			pixels[i].red = red;
+			pixels[i].green = green;
+			pixels[i].blue = blue;
+		}
+	}
 }
 
 uint8_t Texture::getRedValueAt(uint32_t column, uint32_t row) {
@@ -91,13 +713,7 @@ uint8_t Texture::getRedValueAt(uint32_t column, uint32_t row) {
 		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
 	}
 
-	return *((uint8_t*) pixelData +
-			row *
-			(width * (format == FORMAT_RGBA ? 4 : 3) +
-					(width * (format == FORMAT_RGBA ? 4 : 3) % 4 > 0 ?
-					4 - (width * (format == FORMAT_RGBA ? 4 : 3) % 4) : 0)) +
-			column * (format == FORMAT_RGBA ? 4 : 3) +
-			0);
+	return *(pixelData + row * getRowSize() + column * getPixelSize() + 0);
 }
 
 uint8_t Texture::getGreenValueAt(uint32_t column, uint32_t row) {
@@ -114,13 +730,7 @@ uint8_t Texture::getGreenValueAt(uint32_t column, uint32_t row) {
 		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
 	}
 
-	return *((uint8_t*) pixelData +
-			row *
-			(width * (format == FORMAT_RGBA ? 4 : 3) +
-					(width * (format == FORMAT_RGBA ? 4 : 3) % 4 > 0 ?
-					4 - (width * (format == FORMAT_RGBA ? 4 : 3) % 4) : 0)) +
-			column * (format == FORMAT_RGBA ? 4 : 3) +
-			1);
+	return *(pixelData + row * getRowSize() + column * getPixelSize() + 1);
 }
 
 uint8_t Texture::getBlueValueAt(uint32_t column, uint32_t row) {
@@ -137,13 +747,7 @@ uint8_t Texture::getBlueValueAt(uint32_t column, uint32_t row) {
 		gameSystem->log(GameSystem::LOG_FATAL, err.str().c_str());
 	}
 
-	return *((uint8_t*) pixelData +
-			row *
-			(width * (format == FORMAT_RGBA ? 4 : 3) +
-					(width * (format == FORMAT_RGBA ? 4 : 3) % 4 > 0 ?
-					4 - (width * (format == FORMAT_RGBA ? 4 : 3) % 4) : 0)) +
-			column * (format == FORMAT_RGBA ? 4 : 3) +
-			2);
+	return *(pixelData + row * getRowSize() + column * getPixelSize() + 2);
 }
 
 uint8_t Texture::getAlphaValueAt(uint32_t column, uint32_t row) {
@@ -161,13 +765,7 @@ uint8_t Texture::getAlphaValueAt(uint32_t column, uint32_t row) {
 	}
 
 	if(format == FORMAT_RGBA)
-		return *((uint8_t*) pixelData +
-				row *
-				(width * (format == FORMAT_RGBA ? 4 : 3) +
-						(width * (format == FORMAT_RGBA ? 4 : 3) % 4 > 0 ?
-						4 - (width * (format == FORMAT_RGBA ? 4 : 3) % 4) : 0)) +
-				column * (format == FORMAT_RGBA ? 4 : 3) +
-				3);
+		return *(pixelData + row * getRowSize() + column * getPixelSize() + 3);
 	else
 		return 0xFF;
 }
@@ -189,13 +787,7 @@ void Texture::setColorAt(
 	}
 	// create a marker pointer at the correct position in the data buffer,
 	// accounting for row-padding if necessary
-	uint8_t* position =
-			(uint8_t*) pixelData +
-			row *
-			(width * (format == FORMAT_RGBA ? 4 : 3) +
-					(width * (format == FORMAT_RGBA ? 4 : 3) % 4 > 0 ?
-					4 - (width * (format == FORMAT_RGBA ? 4 : 3) % 4) : 0)) +
-			column * (format == FORMAT_RGBA ? 4 : 3);
+	uint8_t* position = pixelData + row * getRowSize() + column * getPixelSize();
 
 	// copy the colors in
 	*(position++) = red;
@@ -206,15 +798,50 @@ void Texture::setColorAt(
 }
 
 void Texture::setDepth(unsigned int depth) {
-	for(unsigned int i = 0; i < width; ++i) {
-		for(unsigned int p = 0; p < height; ++p) {
+	checkRegion(0, 0, width, height);
+
+	// round each possible level to the nearest step once, then look them up
+	unsigned int step = 255 / depth;
+	if(step == 0) step = 1;
+
+	uint8_t roundedLevels[256];
+	for(unsigned int i = 0; i < 256; ++i) {
+		uint8_t dividend = i / step;
+		uint8_t modulus = i % step;
+		if(modulus >= step / 2) dividend += 1;
+		roundedLevels[i] = dividend * step;
+	}
+
+	// alpha is left alone
+	for(uint32_t i = 0; i < height; ++i) {
+		uint8_t* levels = pixelData + i * getRowSize();
+
+		if(format == FORMAT_RGBA) {
+			for(uint32_t p = 0; p < width * 4; p += 4) {
+				levels[p + 0] = roundedLevels[levels[p + 0]];
+				levels[p + 1] = roundedLevels[levels[p + 1]];
+				levels[p + 2] = roundedLevels[levels[p + 2]];
+			}
+		} else {
+			for(uint32_t p = 0; p < width * 3; ++p)
+				levels[p] = roundedLevels[levels[p]];
+		}
+	}
+}
+
+// setDepth() now walks rows of raw pixels; this older loop reads and writes
+// each pixel through the checked accessors, and its image must come out
+// byte for byte the same
+static void setDepthByPixel(Texture& texture, unsigned int depth) {
+	for(unsigned int i = 0; i < texture.width; ++i) {
+		for(unsigned int p = 0; p < texture.height; ++p) {
 			unsigned int step = 255 / depth;
 			if(step == 0) step = 1;
 
-			uint8_t redColor = getRedValueAt((uint32_t) i, (uint32_t) p);
-			uint8_t greenColor = getGreenValueAt((uint32_t) i, (uint32_t) p);
-			uint8_t blueColor = getBlueValueAt((uint32_t) i, (uint32_t) p);
-			uint8_t alphaColor = getAlphaValueAt((uint32_t) i, (uint32_t) p);
+			uint8_t redColor = texture.getRedValueAt((uint32_t) i, (uint32_t) p);
+			uint8_t greenColor = texture.getGreenValueAt((uint32_t) i, (uint32_t) p);
+			uint8_t blueColor = texture.getBlueValueAt((uint32_t) i, (uint32_t) p);
+			uint8_t alphaColor = texture.getAlphaValueAt((uint32_t) i, (uint32_t) p);
 
 			uint8_t redDividend = redColor / step;
 			uint8_t redModulus = redColor % step;
@@ -231,7 +858,7 @@ void Texture::setDepth(unsigned int depth) {
 			if(blueModulus >= step / 2) blueDividend += 1;
 			blueColor = blueDividend * step;
 
-			setColorAt(
+			texture.setColorAt(
 					(uint32_t) i,
 					(uint32_t) p,
 					redColor,
@@ -242,3 +869,117 @@ void Texture::setDepth(unsigned int depth) {
 		}
 	}
 }
+
+void Texture::benchmark() {
+	// run each operation both ways over the same images, in the column-major
+	// order the old loops used, and compare the results
+	const uint32_t size = 1024;
+	const unsigned int repeatCount = 10;
+	const char* operationNames[] = { "fill", "blit", "luminance rows", "depth" };
+
+	for(size_t formatIndex = 0; formatIndex < 2; ++formatIndex) {
+		PixelFormat testFormat = (formatIndex == 0 ? FORMAT_RGB : FORMAT_RGBA);
+
+		Texture source(size, size, FORMAT_RGBA);
+		unsigned int seed = 1;
+		for(uint32_t i = 0; i < size; ++i) {
+			PixelRGBA* pixels = source.getRowRGBA(i);
+
+			for(uint32_t p = 0; p < size; ++p) {
+				pixels[p].red = (uint8_t) rand_r(&seed);
+				pixels[p].green = (uint8_t) rand_r(&seed);
+				pixels[p].blue = (uint8_t) rand_r(&seed);
+				pixels[p].alpha = (uint8_t) rand_r(&seed);
+			}
+		}
+
+		std::vector<uint8_t> values(size);
+
+		Texture accessorTexture(size, size, testFormat);
+		Texture bulkTexture(size, size, testFormat);
+		size_t dataSize = accessorTexture.getRowSize() * size;
+
+		uint64_t accessorNanos[4] = { 0, 0, 0, 0 }, bulkNanos[4] = { 0, 0, 0, 0 };
+		size_t mismatches[4] = { 0, 0, 0, 0 };
+
+		for(unsigned int repeat = 0; repeat < repeatCount; ++repeat) {
+			for(size_t operation = 0; operation < 4; ++operation) {
+				uint64_t startTime = platform->getExecNanos();
+
+				if(operation == 0) {
+					for(uint32_t i = 0; i < size; ++i)
+						for(uint32_t p = 0; p < size; ++p)
+							accessorTexture.setColorAt(i, p, 0xFF, 0xFF, 0xFF, 0);
+				} else if(operation == 1) {
+					for(uint32_t i = 0; i < size / 2; ++i)
+						for(uint32_t p = 0; p < size / 2; ++p)
+							accessorTexture.setColorAt(
+									size / 4 + i,
+									size / 4 + p,
+									source.getRedValueAt(i, p),
+									source.getGreenValueAt(i, p),
+									source.getBlueValueAt(i, p),
+									source.getAlphaValueAt(i, p)
+								);
+				} else if(operation == 2) {
+					for(uint32_t i = 0; i < size; ++i)
+						for(uint32_t p = 0; p < size; ++p)
+							accessorTexture.setColorAt(
+									i,
+									p,
+									source.getRedValueAt(i, p),
+									source.getRedValueAt(i, p),
+									source.getRedValueAt(i, p),
+									0xFF
+								);
+				} else {
+					setDepthByPixel(accessorTexture, 16);
+				}
+
+				accessorNanos[operation] += platform->getExecNanos() - startTime;
+				startTime = platform->getExecNanos();
+
+				if(operation == 0) {
+					bulkTexture.fill(0xFF, 0xFF, 0xFF, 0);
+				} else if(operation == 1) {
+					bulkTexture.blit(&source, 0, 0, size / 2, size / 2, size / 4, size / 4);
+				} else if(operation == 2) {
+					for(uint32_t i = 0; i < size; ++i) {
+						const PixelRGBA* pixels = source.getRowRGBA(i);
+						for(uint32_t p = 0; p < size; ++p)
+							values[p] = pixels[p].red;
+
+						bulkTexture.setRowFromLuminance(i, &values[0]);
+					}
+				} else {
+					bulkTexture.setDepth(16);
+				}
+
+				bulkNanos[operation] += platform->getExecNanos() - startTime;
+
+				if(memcmp(accessorTexture.pixelData, bulkTexture.pixelData, dataSize) != 0)
+					++mismatches[operation];
+			}
+		}
+
+		std::stringstream logMessage;
+		logMessage.precision(4);
+		logMessage <<
+				"Texture benchmark: " << size << "x" << size << " " << (testFormat == FORMAT_RGBA ? "RGBA" : "RGB") <<
+				", ms per pass by pixel accessors versus in bulk:";
+
+		for(size_t operation = 0; operation < 4; ++operation)
+			logMessage <<
+					(operation > 0 ? "," : "") << " " <<
+					operationNames[operation] << " " <<
+					(double) accessorNanos[operation] / 1000000.0 / repeatCount << " vs " <<
+					(double) bulkNanos[operation] / 1000000.0 / repeatCount <<
+					(mismatches[operation] > 0 ? " (MISMATCHED)" : "");
+
+		logMessage << ".";
+
+		// the log is only shown in the game, so report results directly too
+		gameSystem->log(GameSystem::LOG_INFO, logMessage.str());
+		Platform::consoleOut(logMessage.str() + "\n");
+	}
+}
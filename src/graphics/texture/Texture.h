@@ -7,26 +7,113 @@
 #include <png.h>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 class Texture {
 private:
 	png_bytep pixelData;
 
+	// textures loaded from files are cooked into a complete mip chain (block
+	// compressed at the level the loader passes in) and
+	// cached as this header, a table of levels, and their data, which is
+	// mapped straight from the cache file on later loads
+	static const uint32_t cacheVersion = 1;
+
+	struct CacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceModificationTime;
+		uint32_t compression;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	struct CacheLevel {
+		uint32_t width;
+		uint32_t height;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	const void* mappedData;
+	size_t mappedSize;
+
+	bool loadCache(std::string path, size_t sourceSize, int64_t sourceModificationTime, uint32_t compression);
+	void cook(uint32_t compression);
+	void writeCache(std::string path, size_t sourceSize, int64_t sourceModificationTime, uint32_t compression);
+
+	void checkRegion(uint32_t column, uint32_t row, uint32_t regionWidth, uint32_t regionHeight);
+
 public:
 	enum PixelFormat {
 			FORMAT_RGB,
-			FORMAT_RGBA
+			FORMAT_RGBA,
+			FORMAT_DXT1,
+			FORMAT_DXT5
 		};
 
+	// pixels as laid out in the rows of an in-memory texture
+	struct PixelRGB {
+		uint8_t red, green, blue;
+	};
+
+	struct PixelRGBA {
+		uint8_t red, green, blue, alpha;
+	};
+
+	struct Level {
+		uint32_t width, height;
+		const uint8_t* data;
+		size_t size;
+	};
+
 	uint32_t width, height;
 	PixelFormat format;
 
+	// the mip chain of a cooked texture (empty for one built in memory, whose
+	// pixels are the only level and may be accessed individually)
+	std::vector<Level> levels;
+
 	Texture(uint32_t newWidth, uint32_t newHeight, PixelFormat newFormat);
-	Texture(std::string filename);
+	Texture(std::string filename, uint32_t compression);
 	~Texture();
 
-	void* getDataPointer() { return pixelData; }
+	bool isCompressed() { return format == FORMAT_DXT1 || format == FORMAT_DXT5; }
+
+	void* getDataPointer() { return (levels.size() > 0 ? (void*) levels[0].data : (void*) pixelData); }
+
+	// rows of an in-memory texture, each padded to a multiple of four bytes;
+	// these are unchecked, so callers must keep within the texture and use
+	// the view matching its format
+	size_t getPixelSize() { return (format == FORMAT_RGBA ? 4 : 3); }
+	size_t getRowSize() { return (width * getPixelSize() + 3) / 4 * 4; }
+	PixelRGB* getRowRGB(uint32_t row) { return (PixelRGB*) (pixelData + row * getRowSize()); }
+	PixelRGBA* getRowRGBA(uint32_t row) { return (PixelRGBA*) (pixelData + row * getRowSize()); }
 
+	// whole-region operations, which check their bounds once rather than per
+	// pixel (alpha is ignored for, and read as opaque from, RGB textures; a
+	// blit source must not overlap its destination)
+	void fill(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+	void blit(
+			Texture* source,
+			uint32_t sourceColumn,
+			uint32_t sourceRow,
+			uint32_t blitWidth,
+			uint32_t blitHeight,
+			uint32_t destinationColumn,
+			uint32_t destinationRow
+		);
+
+	// fill a row from one byte per pixel, as gray levels or as the coverage
+	// (alpha) of a single color
+	void setRowFromLuminance(uint32_t row, const uint8_t* values);
+	void setRowFromAlpha(uint32_t row, const uint8_t* values, uint8_t red, uint8_t green, uint8_t blue);
+
+	// the single pixel accessors check every call
 	uint8_t getRedValueAt(uint32_t column, uint32_t row);
 	uint8_t getGreenValueAt(uint32_t column, uint32_t row);
 	uint8_t getBlueValueAt(uint32_t column, uint32_t row);
@@ -35,6 +122,9 @@ public:
 	void setColorAt(uint32_t column, uint32_t row, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
 
 	void setDepth(unsigned int depth);
+
+	// times the bulk operations against the single pixel accessors
+	static void benchmark();
 };
 
 #endif // TEXTURE_H
@@ -11,7 +11,9 @@
 #include <utility>
 
 #include "audio/GameAudio.h"
+#include "core/AssetManager.h"
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
 #include "graphics/DrawingMaster.h"
 #include "graphics/GameGraphics.h"
 #include "graphics/2dgraphics/DrawButton.h"
@@ -35,16 +37,58 @@
 #include "platform/Platform.h"
 #include "state/GameState.h"
 
+extern AssetManager* assetManager;
 extern DrawingMaster* drawingMaster;
 extern GameAudio* gameAudio;
 extern GameGraphics* gameGraphics;
 extern GameState* gameState;
 extern GameSystem* gameSystem;
 extern InputHandler* inputHandler;
+extern JobSystem* jobSystem;
 extern Platform* platform;
 extern bool keepProgramAlive;
 extern std::map<MainLoopMember*,unsigned int> mainLoopModules;
 
+// textures the game scene draws with, decoded while a new game loads
+static const char* gameTextures[] = {
+		"gauge/bolt",
+		"gauge/heart",
+		"gauge/shell",
+		"structure/darkcamo",
+		"structure/darkgrain",
+		"structure/lightcamo",
+		"structure/lightgrain",
+		"structure/mediumgrain",
+		"terrain/brown",
+		"terrain/gray",
+		"terrain/green"
+	};
+
+// generates a new game's state (chiefly its island) on a worker thread; the
+// model metadata it reads was loaded at startup along with the renderers
+class NewGameJob : public Job {
+	GameState** destination;
+	GameState::ModelMetrics modelMetrics;
+	GameState* state;
+
+public:
+	// the asset manager is only safe to use from the main thread, so the
+	// model metadata is looked up here rather than in run()
+	NewGameJob(GameState** destination) :
+			Job("new game"),
+			destination(destination),
+			modelMetrics(GameState::getModelMetrics()),
+			state(NULL) { }
+	~NewGameJob() { delete state; }
+
+	void run() { state = new GameState(modelMetrics); }
+
+	void finish() {
+		*destination = state;
+		state = NULL;
+	}
+};
+
 void GameLogic::syncButtonWidths(std::vector<DrawStackEntry*> buttons) {
 	float maxWidth = 0.0f;
 
@@ -259,6 +303,9 @@ void GameLogic::reScheme() {
 			drawingMaster->drawStack.push_back(splashEntry);
 
 			// loading label
+			std::stringstream loadingText;
+			loadingText << "Loading... " << loadingPercent << "%";
+			*((std::string*) loadingEntry.second["text"]) = loadingText.str();
 			*((float*) loadingEntry.second["fontSize"]) = gameSystem->getFloat("fontSizeLarge");
 			((UIMetrics*) loadingEntry.second["metrics"])->size = ((DrawLabel*) drawingMaster->drawers["label"])->getSize(loadingEntry.second);
 			drawingMaster->drawStack.push_back(loadingEntry);
@@ -1448,6 +1495,12 @@ void GameLogic::reScheme() {
 		else
 			stringStream << (float) ((unsigned int) ((gameState->getFiringInterval() / 1000.0f / (float) activeShips) * 100.0f)) / 100.0f;
 		stringStream << "\n";
+		stringStream << "Visible Objects:\t";
+		stringStream << gameGraphics->lastVisibleObjectCount;
+		stringStream << "\n";
+		stringStream << "Culled Objects:\t";
+		stringStream << gameGraphics->lastCulledObjectCount;
+		stringStream << "\n";
 		stringStream << "FPS:\t";
 		stringStream << drawingMaster->runRate;
 		*((std::string*) develStatsEntry.second["text"]) = stringStream.str().c_str();
@@ -1498,20 +1551,35 @@ void GameLogic::reScheme() {
 
 void GameLogic::startNewGame() {
 	currentScheme = SCHEME_LOADING;
+	loadingPercent = 0;
 	reScheme();
 	drawingMaster->execute(true);
 
 	gameAudio->playSound("selectEffect");
 
-	gameState = new GameState();
+	// the rest happens in finishNewGame() once the background work is done
+	jobSystem->submit(new NewGameJob(&loadedState));
+
+	for(size_t i = 0; i < sizeof(gameTextures) / sizeof(gameTextures[0]); ++i)
+		assetManager->prefetchTexture(gameTextures[i]);
+}
+
+void GameLogic::finishNewGame() {
+	gameState = loadedState;
+	loadedState = NULL;
 	mainLoopModules[gameState] = 0;
 
 	mainLoopModules[drawingMaster] = 0;
 	((DrawRadar*) drawingMaster->drawers["radar"])->reloadState();
 	((ExplosionRenderer*) drawingMaster->drawers["explosionRenderer"])->reloadState();
+	((DrawStrikeEffect*) drawingMaster->drawers["strikeEffect"])->reloadState();
 	((TerrainRenderer*) drawingMaster->drawers["terrainRenderer"])->reloadState();
 	gameGraphics->currentCamera = &introCamera;
-	missileCache.clear();
+	eventCursor = 0;
+
+	// upload the decoded textures now rather than during the first frames
+	for(size_t i = 0; i < sizeof(gameTextures) / sizeof(gameTextures[0]); ++i)
+		gameGraphics->getTextureID(gameTextures[i]);
 
 	currentScheme = SCHEME_INTRO;
 	activeMenuSelection = NULL;
@@ -1646,6 +1714,34 @@ void GameLogic::continueFromGameOver(bool forward) {
 	gameAudio->playSound(forward ? "selectEffect" : "backEffect");
 }
 
+void GameLogic::recreateGraphics(bool fullScreen, bool reuseWindow) {
+	Camera* currentCamera = gameGraphics->currentCamera;
+	delete gameGraphics;
+
+	gameGraphics = new GameGraphics(fullScreen, false, reuseWindow);
+	gameGraphics->currentCamera = currentCamera;
+	drawingMaster->newGraphics();
+
+	// the new drawers need their game-specific OpenGL state rebuilt
+	if(currentScheme == SCHEME_PLAYING || currentScheme == SCHEME_INTRO || currentScheme == SCHEME_PAUSED) {
+		((DrawRadar*) drawingMaster->drawers["radar"])->reloadState();
+		((ExplosionRenderer*) drawingMaster->drawers["explosionRenderer"])->reloadState();
+		((DrawStrikeEffect*) drawingMaster->drawers["strikeEffect"])->reloadState();
+		((TerrainRenderer*) drawingMaster->drawers["terrainRenderer"])->reloadState();
+	}
+}
+
+void GameLogic::changeWindow(bool fullScreen) {
+	// keep everything in OpenGL if the platform lets the context survive
+	if(gameGraphics->changeWindow(fullScreen))
+		drawingMaster->resizeGraphics();
+	else
+		recreateGraphics(fullScreen, true);
+
+	inputHandler->execute();
+	mouseMotionListener->wasMoved();
+}
+
 void GameLogic::alterGameLevel(bool increase) {
 	float gameLevel = gameSystem->getFloat("gameStartingLevel") + (increase ? 1.0f : -1.0f);
 	if(gameLevel > 3.0f)
@@ -1670,9 +1766,8 @@ void GameLogic::alterMusicLevel(bool increase) {
 	value += (increase ? 0.1f : -0.1f);
 	if(value > 1.0f) value = 0.0f;
 	if(value < 0.0f) value = 1.0f;
-	SDL_LockAudio();
 	gameSystem->setStandard("audioMusicVolume", value, "");
-	SDL_UnlockAudio();
+	gameAudio->setMusicVolume(value);
 	gameSystem->flushPreferences();
 
 	reScheme();
@@ -1690,6 +1785,7 @@ void GameLogic::alterAudioEffectsLevel(bool increase) {
 	if(value > 1.0f) value = 0.0f;
 	if(value < 0.0f) value = 1.0f;
 	gameSystem->setStandard("audioEffectsVolume", value, "");
+	gameAudio->setEffectsVolume(value);
 	gameSystem->flushPreferences();
 
 	reScheme();
@@ -1746,17 +1842,8 @@ void GameLogic::alterWindowedResolution(bool increase) {
 		gameSystem->setStandard("displayWindowedResolution", resolutionText.str().c_str());
 		gameSystem->flushPreferences();
 
-		if(! gameGraphics->fullScreen) {
-			// recreate the window
-			delete gameGraphics;
-
-			gameGraphics = new GameGraphics(false);
-
-			drawingMaster->newGraphics();
-
-			inputHandler->execute();
-			mouseMotionListener->wasMoved();
-		}
+		if(! gameGraphics->fullScreen)
+			changeWindow(false);
 
 		reScheme();
 		drawingMaster->execute(true);
@@ -1834,12 +1921,14 @@ void GameLogic::alterMultiSamplingLevel(bool increase) {
 
 	gameSystem->flushPreferences();
 
-	bool fullScreen = gameGraphics->fullScreen;
-	delete gameGraphics;
-	gameGraphics = new GameGraphics(fullScreen);
-	drawingMaster->newGraphics();
-	inputHandler->execute();
-	mouseMotionListener->wasMoved();
+	// without offscreen multisampling, only a new window can change it
+	if(gameGraphics->supportsSceneFramebuffer) {
+		gameGraphics->applyMultisamplingLevel();
+	} else {
+		recreateGraphics(gameGraphics->fullScreen);
+		inputHandler->execute();
+		mouseMotionListener->wasMoved();
+	}
 
 	reScheme();
 	drawingMaster->execute(true);
@@ -1898,15 +1987,33 @@ void GameLogic::resetHighScores() {
 	gameAudio->playSound("selectEffect");
 }
 
-void GameLogic::playEffectAtDistance(std::string effect, float distance) {
+void GameLogic::playEffectAtPosition(std::string effect, Vector3 position) {
 	float maxDistance = gameSystem->getFloat("audioVolumeDropOffDistance");
+	Vector3 offset = position - gameState->fortress.position;
+	float effectDistance = mag(offset);
 
-	if(distance > maxDistance)
+	if(effectDistance > maxDistance)
 		return;
 
+	// pan by the horizontal bearing relative to where the turret faces
+	// (forward is +X before rotation, so +Z is to the right)
+	Matrix4 rotationMatrix;
+	rotationMatrix.identity();
+	rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), radians(gameState->fortress.rotation), rotationMatrix);
+	Vector4 right = Vector4(0.0f, 0.0f, 1.0f, 0.0f) * rotationMatrix;
+
+	float pan = 0.0f;
+	Vector2 bearing(offset.x, offset.z);
+	if(mag(bearing) > 0.0f) {
+		bearing.norm();
+		pan = dot(bearing, Vector2(right.x, right.z));
+	}
+
 	gameAudio->playSound(
 			effect,
-			(maxDistance - distance) / maxDistance
+			(maxDistance - effectDistance) / maxDistance,
+			pan,
+			GameAudio::PRIORITY_WORLD
 		);
 }
 
@@ -1952,6 +2059,9 @@ GameLogic::GameLogic() :
 		MainLoopMember((unsigned int) gameSystem->getFloat("logicUpdateFrequency")),
 		currentScheme(SCHEME_MAINMENU),
 		activeMenuSelection(&playButtonEntry),
+		loadedState(NULL),
+		loadingPercent(0),
+		eventCursor(0),
 		mouseActive(false),
 		playerName(gameSystem->getString("gameHighScoreName")),
 		deleteKeyPressTime(-1),
@@ -2794,27 +2904,15 @@ unsigned int GameLogic::execute(bool unScheduled) {
 	bool needReScheme = false;
 	bool needRedraw = false;
 
+	// finish any completed background work on this thread
+	jobSystem->finishCompleted();
+
 	// universal logic
 	if(quitKeyListener->popKey() != SDLK_UNKNOWN )
 		keepProgramAlive = false;
 
 	if(fullScreenKeyListener->popKey() != SDLK_UNKNOWN) {
-		bool fullScreenGraphics = ! gameGraphics->fullScreen;
-		Camera* currentCamera = gameGraphics->currentCamera;
-		delete gameGraphics;
-
-		gameGraphics = new GameGraphics(fullScreenGraphics);
-		gameGraphics->currentCamera = currentCamera;
-		drawingMaster->newGraphics();
-
-		inputHandler->execute();
-		mouseMotionListener->wasMoved();
-
-		if(currentScheme == SCHEME_PLAYING || currentScheme == SCHEME_INTRO || currentScheme == SCHEME_PAUSED) {
-			((DrawRadar*) drawingMaster->drawers["radar"])->reloadState();
-			((ExplosionRenderer*) drawingMaster->drawers["explosionRenderer"])->reloadState();
-			((TerrainRenderer*) drawingMaster->drawers["terrainRenderer"])->reloadState();
-		}
+		changeWindow(! gameGraphics->fullScreen);
 
 		needReScheme = true;
 		needRedraw = true;
@@ -2986,6 +3084,15 @@ unsigned int GameLogic::execute(bool unScheduled) {
 				}
 			}
 		}
+	} else if(currentScheme == SCHEME_LOADING) {
+		// wait for the new game's state and textures, showing the progress
+		if(loadedState != NULL && jobSystem->isIdle()) {
+			finishNewGame();
+		} else if((unsigned int) (jobSystem->getProgress() * 100.0f) != loadingPercent) {
+			loadingPercent = (unsigned int) (jobSystem->getProgress() * 100.0f);
+			needReScheme = true;
+			needRedraw = true;
+		}
 	} else if(currentScheme == SCHEME_INTRO) {
 		// button clicks
 		if(primaryFireClickListener1->wasClicked()) {
@@ -3014,10 +3121,6 @@ unsigned int GameLogic::execute(bool unScheduled) {
 			mouseActive = false;
 		}
 	} else if(currentScheme == SCHEME_PLAYING) {
-		// check score
-		if(atoi(((std::string*) scoreLabel.second["text"])->c_str()) != gameState->score)
-			needReScheme = true;
-
 		// check gauges
 		if(
 				(*((std::vector<float>*) gaugePanelEntry.second["progressions"]))[0] != gameState->fortress.health ||
@@ -3155,37 +3258,23 @@ unsigned int GameLogic::execute(bool unScheduled) {
 			}
 		}
 
-		// update missile cache and play effects if necessary
-		for(size_t i = 0; i < gameState->missiles.size(); ++i) {
-			if(! gameState->missiles[i].alive)
-				continue;
+		// play effects for whatever has happened since the last update, and
+		// show the new score for any missile destroyed
+		if(eventCursor < gameState->getOldestEvent())
+			eventCursor = gameState->getOldestEvent();
 
-			bool isInCache = false;
+		for(; eventCursor < gameState->getEventCount(); ++eventCursor) {
+			const GameEvent& event = gameState->getEvent(eventCursor);
 
-			for(size_t p = 0; p < missileCache.size(); ++p) {
-				if(p == i) {
-					isInCache = true;
-
-					break;
-				}
-			}
-
-			if(! isInCache) {
-				missileCache.push_back(i);
-
-				playEffectAtDistance("missileEffect", distance(gameState->fortress.position, gameState->missiles[i].position));
-			}
-		}
-
-		size_t i = 0;
-		while(i < missileCache.size()) {
-			if(! gameState->missiles[missileCache[i]].alive) {
-				playEffectAtDistance("explosionEffect", distance(gameState->fortress.position, gameState->missiles[missileCache[i]].position));
+			if(event.type == GameEvent::MISSILE_LAUNCHED)
+				playEffectAtPosition("missileEffect", event.position);
+			else if(event.type == GameEvent::SHELL_FIRED)
+				gameAudio->playSound("shellEffect");
+			else
+				playEffectAtPosition("explosionEffect", event.position);
 
-				missileCache.erase(missileCache.begin() + i);
-			} else {
-				++i;
-			}
+			if(event.type == GameEvent::MISSILE_SHOT || event.type == GameEvent::MISSILE_EMP)
+				needReScheme = true;
 		}
 
 		// see if we're dead
@@ -3212,12 +3301,8 @@ unsigned int GameLogic::execute(bool unScheduled) {
 				primaryFireClickListener1->wasClicked() ||
 				primaryFireClickListener2->wasClicked() ||
 				primaryFireClickListener3->wasClicked()
-			) {
-			if(gameState->fortress.ammunition >= gameSystem->getFloat("stateAmmoFiringCost")) {
-				gameState->fireShell();
-				gameAudio->playSound("shellEffect");
-			}
-		}
+			)
+			gameState->fireShell();
 		if(secondaryFireClickListener->wasClicked()) {
 			gameState->empIsCharging = ! gameState->empIsCharging;
 
@@ -3234,10 +3319,7 @@ unsigned int GameLogic::execute(bool unScheduled) {
 		KeyListener* activeKeyListener = gameSystem->getBool("developmentMode") ? playingDevelopmentModeKeyListener : playingKeyListener;
 		for(SDLKey key = activeKeyListener->popKey(); key != SDLK_UNKNOWN; key = activeKeyListener->popKey()) {
 			if(key == SDLK_SPACE && gameGraphics->currentCamera == &fortressCamera) {
-				if(gameState->fortress.ammunition >= gameSystem->getFloat("stateAmmoFiringCost")) {
-					gameState->fireShell();
-					gameAudio->playSound("shellEffect");
-				}
+				gameState->fireShell();
 			} else if(key == SDLK_TAB) {
 				gameState->empIsCharging = ! gameState->empIsCharging;
 
@@ -3256,13 +3338,14 @@ unsigned int GameLogic::execute(bool unScheduled) {
 
 				mainLoopModules.erase(mainLoopModules.find(gameState));
 				delete gameState;
-				gameState = new GameState();
+				gameState = new GameState(GameState::getModelMetrics());
 				mainLoopModules[gameState] = 0;
 
 				((DrawRadar*) drawingMaster->drawers["radar"])->reloadState();
 				((ExplosionRenderer*) drawingMaster->drawers["explosionRenderer"])->reloadState();
+				((DrawStrikeEffect*) drawingMaster->drawers["strikeEffect"])->reloadState();
 				((TerrainRenderer*) drawingMaster->drawers["terrainRenderer"])->reloadState();
-				missileCache.clear();
+				eventCursor = 0;
 			} else if(key == SDLK_BACKSLASH) {
 				if(gameGraphics->currentCamera == &fortressCamera) {
 					gameGraphics->currentCamera = &orbitCamera;
@@ -14,6 +14,8 @@
 #include "input/Keyboard.h"
 #include "input/Mouse.h"
 #include "logic/Camera.h"
+#include "math/VectorMath.h"
+#include "state/GameState.h"
 
 class GameLogic : public MainLoopMember {
 private:
@@ -36,11 +38,14 @@ private:
 
 	// logic helper functions resulting from clicks or enter key
 	void startNewGame();
+	void finishNewGame();
 	void bumpStartFromIntro();
 	void pauseGame();
 	void resumeGame();
 	void endGameFromPause();
 	void continueFromGameOver(bool forward = true);
+	void recreateGraphics(bool fullScreen, bool reuseWindow = false);
+	void changeWindow(bool fullScreen);
 	void alterGameLevel(bool increase = true);
 	void alterMusicLevel(bool increase = true);
 	void alterAudioEffectsLevel(bool increase = true);
@@ -52,7 +57,7 @@ private:
 	void alterDevelopmentMode(bool increase = true);
 	void resetHighScores();
 
-	void playEffectAtDistance(std::string effect, float distance);
+	void playEffectAtPosition(std::string effect, Vector3 position);
 	std::string getZeroPaddedHighScoresList();
 
 public:
@@ -90,6 +95,8 @@ public:
 
 	// loading
 	DrawStackEntry loadingEntry;
+	GameState* loadedState;
+	unsigned int loadingPercent;
 
 	// intro
 	KeyListener* introKeyListener;
@@ -216,8 +223,9 @@ public:
 	PresentationCamera presentationCamera;
 	RoamingCamera roamingCamera;
 
-	// missile cache for audio effects
-	std::vector<size_t> missileCache;
+	// number of the next game state event to read for audio effects and
+	// score changes
+	size_t eventCursor;
 
 	// general logic info
 	bool mouseActive;
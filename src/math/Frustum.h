@@ -0,0 +1,45 @@
+// Frustum.h
+// Dominicus
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cmath>
+
+#include "math/MatrixMath.h"
+#include "math/VectorMath.h"
+
+class Frustum {
+public:
+	// left, right, bottom, top, near, far; each is normalized so that its
+	// equation gives the distance of a point from it, positive on the inside
+	Vector4 planes[6];
+
+	// constructors
+	Frustum() { }
+	Frustum(const Matrix4& mat) {
+		// extract the planes from a combined modelview and projection matrix
+		// (Gribb and Hartmann), which for our row vectors means combining
+		// its columns
+		planes[0] = Vector4(mat.m14 + mat.m11, mat.m24 + mat.m21, mat.m34 + mat.m31, mat.m44 + mat.m41);
+		planes[1] = Vector4(mat.m14 - mat.m11, mat.m24 - mat.m21, mat.m34 - mat.m31, mat.m44 - mat.m41);
+		planes[2] = Vector4(mat.m14 + mat.m12, mat.m24 + mat.m22, mat.m34 + mat.m32, mat.m44 + mat.m42);
+		planes[3] = Vector4(mat.m14 - mat.m12, mat.m24 - mat.m22, mat.m34 - mat.m32, mat.m44 - mat.m42);
+		planes[4] = Vector4(mat.m14 + mat.m13, mat.m24 + mat.m23, mat.m34 + mat.m33, mat.m44 + mat.m43);
+		planes[5] = Vector4(mat.m14 - mat.m13, mat.m24 - mat.m23, mat.m34 - mat.m33, mat.m44 - mat.m43);
+
+		for(size_t i = 0; i < 6; ++i)
+			planes[i] *= 1.0f / sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+	}
+
+	// tests
+	bool intersectsSphere(const Vector3& center, float radius) const {
+		for(size_t i = 0; i < 6; ++i)
+			if(planes[i].x * center.x + planes[i].y * center.y + planes[i].z * center.z + planes[i].w < -radius)
+				return false;
+
+		return true;
+	}
+};
+
+#endif // FRUSTUM_H
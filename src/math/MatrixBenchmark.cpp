@@ -0,0 +1,233 @@
+// MatrixBenchmark.cpp
+// Dominicus
+
+#include "math/MatrixBenchmark.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "core/GameSystem.h"
+#include "math/MatrixMath.h"
+#include "math/ScalarMath.h"
+#include "math/VectorMath.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern Platform* platform;
+
+// plain scalar arithmetic for each Matrix4 operation that MatrixMath.h now
+// vectorizes (the benchmark reports how far the vector results drift from
+// these)
+static Matrix4 multiplyByElement(const Matrix4& old, const Matrix4& mat) {
+	return Matrix4(
+			old.m11 * mat.m11 + old.m12 * mat.m21 + old.m13 * mat.m31 + old.m14 * mat.m41,
+			old.m11 * mat.m12 + old.m12 * mat.m22 + old.m13 * mat.m32 + old.m14 * mat.m42,
+			old.m11 * mat.m13 + old.m12 * mat.m23 + old.m13 * mat.m33 + old.m14 * mat.m43,
+			old.m11 * mat.m14 + old.m12 * mat.m24 + old.m13 * mat.m34 + old.m14 * mat.m44,
+
+			old.m21 * mat.m11 + old.m22 * mat.m21 + old.m23 * mat.m31 + old.m24 * mat.m41,
+			old.m21 * mat.m12 + old.m22 * mat.m22 + old.m23 * mat.m32 + old.m24 * mat.m42,
+			old.m21 * mat.m13 + old.m22 * mat.m23 + old.m23 * mat.m33 + old.m24 * mat.m43,
+			old.m21 * mat.m14 + old.m22 * mat.m24 + old.m23 * mat.m34 + old.m24 * mat.m44,
+
+			old.m31 * mat.m11 + old.m32 * mat.m21 + old.m33 * mat.m31 + old.m34 * mat.m41,
+			old.m31 * mat.m12 + old.m32 * mat.m22 + old.m33 * mat.m32 + old.m34 * mat.m42,
+			old.m31 * mat.m13 + old.m32 * mat.m23 + old.m33 * mat.m33 + old.m34 * mat.m43,
+			old.m31 * mat.m14 + old.m32 * mat.m24 + old.m33 * mat.m34 + old.m34 * mat.m44,
+
+			old.m41 * mat.m11 + old.m42 * mat.m21 + old.m43 * mat.m31 + old.m44 * mat.m41,
+			old.m41 * mat.m12 + old.m42 * mat.m22 + old.m43 * mat.m32 + old.m44 * mat.m42,
+			old.m41 * mat.m13 + old.m42 * mat.m23 + old.m43 * mat.m33 + old.m44 * mat.m43,
+			old.m41 * mat.m14 + old.m42 * mat.m24 + old.m43 * mat.m34 + old.m44 * mat.m44
+		);
+}
+
+static Vector4 transformByElement(const Vector4 vec, const Matrix4& mat) {
+	return Vector4(
+			vec.x * mat.m11 + vec.y * mat.m21 + vec.z * mat.m31 + vec.w * mat.m41,
+			vec.x * mat.m12 + vec.y * mat.m22 + vec.z * mat.m32 + vec.w * mat.m42,
+			vec.x * mat.m13 + vec.y * mat.m23 + vec.z * mat.m33 + vec.w * mat.m43,
+			vec.x * mat.m14 + vec.y * mat.m24 + vec.z * mat.m34 + vec.w * mat.m44
+		);
+}
+
+static void rotateByElement(const Vector3 axis, float angle, Matrix4& mat) {
+	mat = multiplyByElement(mat, Matrix4(
+			axis.x * axis.x * (1.0f - cos(angle)) + cos(angle),
+			axis.x * axis.y * (1.0f - cos(angle)) + axis.z * sin(angle),
+			axis.x * axis.z * (1.0f - cos(angle)) - axis.y * sin(angle),
+			0.0f,
+
+			axis.y * axis.x * (1.0f - cos(angle)) - axis.z * sin(angle),
+			axis.y * axis.y * (1.0f - cos(angle)) + cos(angle),
+			axis.y * axis.z * (1.0f - cos(angle)) + axis.x * sin(angle),
+			0.0f,
+
+			axis.z * axis.x * (1.0f - cos(angle)) + axis.y * sin(angle),
+			axis.z * axis.y * (1.0f - cos(angle)) - axis.x * sin(angle),
+			axis.z * axis.z * (1.0f - cos(angle)) + cos(angle),
+			0.0f,
+
+			0.0f,
+			0.0f,
+			0.0f,
+			1.0f
+		));
+}
+
+static void translateByElement(float x, float y, float z, Matrix4& mat) {
+	mat = multiplyByElement(mat, Matrix4(
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			x, y, z, 1.0f
+		));
+}
+
+static float getDifference(const float* values1, const float* values2, size_t count) {
+	float difference = 0.0f;
+	for(size_t i = 0; i < count; ++i)
+		difference = maximum(difference, absolute(values1[i] - values2[i]));
+
+	return difference;
+}
+
+void benchmarkMatrixMath() {
+	// a missile-like workload: place each object by two rotations and a
+	// translation, bring it into the camera's space, and transform a point
+	const size_t objectCount = 4096;
+	const unsigned int repeatCount = 1000;
+	const char* operationNames[] = { "compose", "multiply", "batch multiply", "transform", "batch transform" };
+
+	unsigned int seed = 1;
+	std::vector<Vector3> positions(objectCount);
+	std::vector<float> tilts(objectCount), rotations(objectCount);
+
+	for(size_t i = 0; i < objectCount; ++i) {
+		positions[i] = Vector3(
+				(float) rand_r(&seed) / RAND_MAX * 1000.0f - 500.0f,
+				(float) rand_r(&seed) / RAND_MAX * 100.0f,
+				(float) rand_r(&seed) / RAND_MAX * 1000.0f - 500.0f
+			);
+		tilts[i] = radians((float) rand_r(&seed) / RAND_MAX * 90.0f);
+		rotations[i] = radians((float) rand_r(&seed) / RAND_MAX * 360.0f);
+	}
+
+	Matrix4 cameraMatrix; cameraMatrix.identity();
+	translateByElement(-10.0f, -20.0f, 30.0f, cameraMatrix);
+	rotateByElement(Vector3(0.0f, 1.0f, 0.0f), radians(40.0f), cameraMatrix);
+	rotateByElement(Vector3(1.0f, 0.0f, 0.0f), radians(-20.0f), cameraMatrix);
+	translateByElement(0.0f, 0.0f, 60.0f, cameraMatrix);
+
+	std::vector<Matrix4> elementModels(objectCount), models(objectCount);
+	std::vector<Matrix4> elementViews(objectCount), views(objectCount);
+	std::vector<Vector4> elementPoints(objectCount), points(objectCount);
+
+	uint64_t elementNanos[5] = { 0, 0, 0, 0, 0 }, simdNanos[5] = { 0, 0, 0, 0, 0 };
+	float differences[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for(unsigned int repeat = 0; repeat < repeatCount; ++repeat) {
+		// compose
+		uint64_t startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i) {
+			Matrix4& mat = elementModels[i];
+			mat.identity();
+			rotateByElement(Vector3(0.0f, 0.0f, 1.0f), tilts[i], mat);
+			rotateByElement(Vector3(0.0f, 1.0f, 0.0f), rotations[i], mat);
+			translateByElement(positions[i].x, positions[i].y, positions[i].z, mat);
+		}
+
+		elementNanos[0] += platform->getExecNanos() - startTime;
+		startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i) {
+			Matrix3 rotation; rotation.identity();
+			rotateMatrix(Vector3(0.0f, 0.0f, 1.0f), tilts[i], rotation);
+			rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), rotations[i], rotation);
+
+			models[i] = transformMatrix(Vector3(1.0f, 1.0f, 1.0f), rotation, positions[i]);
+		}
+
+		simdNanos[0] += platform->getExecNanos() - startTime;
+		differences[0] = maximum(differences[0], getDifference(elementModels[0].getArray(), models[0].getArray(), objectCount * 16));
+
+		// multiply one at a time, then all at once
+		startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i)
+			elementViews[i] = multiplyByElement(elementModels[i], cameraMatrix);
+
+		elementNanos[1] += platform->getExecNanos() - startTime;
+		startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i)
+			views[i] = elementModels[i] * cameraMatrix;
+
+		simdNanos[1] += platform->getExecNanos() - startTime;
+		differences[1] = maximum(differences[1], getDifference(elementViews[0].getArray(), views[0].getArray(), objectCount * 16));
+
+		startTime = platform->getExecNanos();
+
+		multiplyMatrices(&elementModels[0], objectCount, cameraMatrix, &views[0]);
+
+		simdNanos[2] += platform->getExecNanos() - startTime;
+		differences[2] = maximum(differences[2], getDifference(elementViews[0].getArray(), views[0].getArray(), objectCount * 16));
+
+		// transform one at a time, then all at once
+		startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i)
+			elementPoints[i] = transformByElement(Vector4(positions[i].x, positions[i].y, positions[i].z, 1.0f), cameraMatrix);
+
+		elementNanos[3] += platform->getExecNanos() - startTime;
+		startTime = platform->getExecNanos();
+
+		for(size_t i = 0; i < objectCount; ++i)
+			points[i] = Vector4(positions[i].x, positions[i].y, positions[i].z, 1.0f) * cameraMatrix;
+
+		simdNanos[3] += platform->getExecNanos() - startTime;
+		differences[3] = maximum(differences[3], getDifference(&elementPoints[0].x, &points[0].x, objectCount * 4));
+
+		startTime = platform->getExecNanos();
+
+		transformPoints(&positions[0], objectCount, cameraMatrix, &points[0]);
+
+		simdNanos[4] += platform->getExecNanos() - startTime;
+		differences[4] = maximum(differences[4], getDifference(&elementPoints[0].x, &points[0].x, objectCount * 4));
+	}
+
+	// the batch operations are compared with the same element by element loops
+	elementNanos[2] = elementNanos[1];
+	elementNanos[4] = elementNanos[3];
+
+	std::stringstream logMessage;
+	logMessage.precision(4);
+	logMessage <<
+			"Matrix benchmark: " << objectCount << " objects, ms per pass element by element versus " <<
+#if defined(MATRIXMATH_SSE)
+			"SSE" <<
+#elif defined(MATRIXMATH_NEON)
+			"NEON" <<
+#else
+			"scalar fallback" <<
+#endif
+			" (largest difference):";
+
+	for(size_t operation = 0; operation < 5; ++operation)
+		logMessage <<
+				(operation > 0 ? "," : "") << " " <<
+				operationNames[operation] << " " <<
+				(double) elementNanos[operation] / 1000000.0 / repeatCount << " vs " <<
+				(double) simdNanos[operation] / 1000000.0 / repeatCount <<
+				" (" << differences[operation] << ")";
+
+	logMessage << ".";
+
+	// the log is only shown in the game, so report results directly too
+	gameSystem->log(GameSystem::LOG_INFO, logMessage.str());
+	Platform::consoleOut(logMessage.str() + "\n");
+}
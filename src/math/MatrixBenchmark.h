@@ -0,0 +1,11 @@
+// MatrixBenchmark.h
+// Dominicus
+
+#ifndef MATRIXBENCHMARK_H
+#define MATRIXBENCHMARK_H
+
+// times the matrix operations against the element by element versions they
+// replaced, and reports both along with how far apart their results are
+void benchmarkMatrixMath();
+
+#endif // MATRIXBENCHMARK_H
@@ -5,10 +5,28 @@
 #define MATRIXMATH_H
 
 #include <cmath>
+#include <cstdlib>
 #include <math.h>
 
 #include "math/VectorMath.h"
 
+// the 4x4 operations use SSE or NEON where available; rows are loaded and
+// stored unaligned, so this works for any matrix, but they're declared
+// aligned so that the compiler places them well
+#if defined(__SSE__) || defined(_M_X64)
+#define MATRIXMATH_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MATRIXMATH_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef __GNUC__
+#define MATRIXMATH_ALIGNED __attribute__((aligned(16)))
+#else
+#define MATRIXMATH_ALIGNED
+#endif
+
 class Matrix3 {
 public:
 	// public data
@@ -167,9 +185,59 @@ inline void rotateMatrix(const Vector3 axis, float angle, Matrix3& mat) {
 		);
 }
 
-class Matrix4 {
+// multiplies each of a run of four-float rows by a 4x4 matrix (row-major),
+// which may be done in place since each row is read before it is written;
+// the sums are taken in the same order either way, so results match exactly
+inline void multiplyMatrixRows(const float* rows, size_t rowCount, const float* mat, float* results) {
+#if defined(MATRIXMATH_SSE)
+	__m128 matRow1 = _mm_loadu_ps(mat);
+	__m128 matRow2 = _mm_loadu_ps(mat + 4);
+	__m128 matRow3 = _mm_loadu_ps(mat + 8);
+	__m128 matRow4 = _mm_loadu_ps(mat + 12);
+
+	for(size_t i = 0; i < rowCount; ++i) {
+		__m128 result = _mm_mul_ps(_mm_set1_ps(rows[i * 4]), matRow1);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(rows[i * 4 + 1]), matRow2));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(rows[i * 4 + 2]), matRow3));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(rows[i * 4 + 3]), matRow4));
+
+		_mm_storeu_ps(results + i * 4, result);
+	}
+#elif defined(MATRIXMATH_NEON)
+	float32x4_t matRow1 = vld1q_f32(mat);
+	float32x4_t matRow2 = vld1q_f32(mat + 4);
+	float32x4_t matRow3 = vld1q_f32(mat + 8);
+	float32x4_t matRow4 = vld1q_f32(mat + 12);
+
+	for(size_t i = 0; i < rowCount; ++i) {
+		float32x4_t result = vmulq_n_f32(matRow1, rows[i * 4]);
+		result = vaddq_f32(result, vmulq_n_f32(matRow2, rows[i * 4 + 1]));
+		result = vaddq_f32(result, vmulq_n_f32(matRow3, rows[i * 4 + 2]));
+		result = vaddq_f32(result, vmulq_n_f32(matRow4, rows[i * 4 + 3]));
+
+		vst1q_f32(results + i * 4, result);
+	}
+#else
+	float matCopy[16];
+	for(size_t i = 0; i < 16; ++i)
+		matCopy[i] = mat[i];
+
+	for(size_t i = 0; i < rowCount; ++i) {
+		float x = rows[i * 4], y = rows[i * 4 + 1], z = rows[i * 4 + 2], w = rows[i * 4 + 3];
+
+		results[i * 4] = x * matCopy[0] + y * matCopy[4] + z * matCopy[8] + w * matCopy[12];
+		results[i * 4 + 1] = x * matCopy[1] + y * matCopy[5] + z * matCopy[9] + w * matCopy[13];
+		results[i * 4 + 2] = x * matCopy[2] + y * matCopy[6] + z * matCopy[10] + w * matCopy[14];
+		results[i * 4 + 3] = x * matCopy[3] + y * matCopy[7] + z * matCopy[11] + w * matCopy[15];
+	}
+#endif
+}
+
+class MATRIXMATH_ALIGNED Matrix4 {
 public:
-	// public data
+	// public data, contiguous and row by row, so that getArray() can be
+	// uploaded as is (our row vectors make it the column-major layout OpenGL
+	// expects of column vectors)
 	float m11, m12, m13, m14;
 	float m21, m22, m23, m24;
 	float m31, m32, m33, m34;
@@ -243,55 +311,21 @@ public:
 		return *this;
 	}
 	Matrix4 operator * (const Matrix4& mat) const {
-		return Matrix4(
-				m11 * mat.m11 + m12 * mat.m21 + m13 * mat.m31 + m14 * mat.m41,
-				m11 * mat.m12 + m12 * mat.m22 + m13 * mat.m32 + m14 * mat.m42,
-				m11 * mat.m13 + m12 * mat.m23 + m13 * mat.m33 + m14 * mat.m43,
-				m11 * mat.m14 + m12 * mat.m24 + m13 * mat.m34 + m14 * mat.m44,
-
-				m21 * mat.m11 + m22 * mat.m21 + m23 * mat.m31 + m24 * mat.m41,
-				m21 * mat.m12 + m22 * mat.m22 + m23 * mat.m32 + m24 * mat.m42,
-				m21 * mat.m13 + m22 * mat.m23 + m23 * mat.m33 + m24 * mat.m43,
-				m21 * mat.m14 + m22 * mat.m24 + m23 * mat.m34 + m24 * mat.m44,
-
-				m31 * mat.m11 + m32 * mat.m21 + m33 * mat.m31 + m34 * mat.m41,
-				m31 * mat.m12 + m32 * mat.m22 + m33 * mat.m32 + m34 * mat.m42,
-				m31 * mat.m13 + m32 * mat.m23 + m33 * mat.m33 + m34 * mat.m43,
-				m31 * mat.m14 + m32 * mat.m24 + m33 * mat.m34 + m34 * mat.m44,
-
-				m41 * mat.m11 + m42 * mat.m21 + m43 * mat.m31 + m44 * mat.m41,
-				m41 * mat.m12 + m42 * mat.m22 + m43 * mat.m32 + m44 * mat.m42,
-				m41 * mat.m13 + m42 * mat.m23 + m43 * mat.m33 + m44 * mat.m43,
-				m41 * mat.m14 + m42 * mat.m24 + m43 * mat.m34 + m44 * mat.m44
-			);
+		Matrix4 result;
+		multiplyMatrixRows(&m11, 4, &mat.m11, &result.m11);
+
+		return result;
 	}
 
 	Matrix4& operator *= (const Matrix4& mat) {
-		Matrix4 old(*this);
-
-		m11 = old.m11 * mat.m11 + old.m12 * mat.m21 + old.m13 * mat.m31 + old.m14 * mat.m41;
-		m12 = old.m11 * mat.m12 + old.m12 * mat.m22 + old.m13 * mat.m32 + old.m14 * mat.m42;
-		m13 = old.m11 * mat.m13 + old.m12 * mat.m23 + old.m13 * mat.m33 + old.m14 * mat.m43;
-		m14 = old.m11 * mat.m14 + old.m12 * mat.m24 + old.m13 * mat.m34 + old.m14 * mat.m44;
-
-		m21 = old.m21 * mat.m11 + old.m22 * mat.m21 + old.m23 * mat.m31 + old.m24 * mat.m41;
-		m22 = old.m21 * mat.m12 + old.m22 * mat.m22 + old.m23 * mat.m32 + old.m24 * mat.m42;
-		m23 = old.m21 * mat.m13 + old.m22 * mat.m23 + old.m23 * mat.m33 + old.m24 * mat.m43;
-		m24 = old.m21 * mat.m14 + old.m22 * mat.m24 + old.m23 * mat.m34 + old.m24 * mat.m44;
-
-		m31 = old.m31 * mat.m11 + old.m32 * mat.m21 + old.m33 * mat.m31 + old.m34 * mat.m41;
-		m32 = old.m31 * mat.m12 + old.m32 * mat.m22 + old.m33 * mat.m32 + old.m34 * mat.m42;
-		m33 = old.m31 * mat.m13 + old.m32 * mat.m23 + old.m33 * mat.m33 + old.m34 * mat.m43;
-		m34 = old.m31 * mat.m14 + old.m32 * mat.m24 + old.m33 * mat.m34 + old.m34 * mat.m44;
-
-		m41 = old.m41 * mat.m11 + old.m42 * mat.m21 + old.m43 * mat.m31 + old.m44 * mat.m41;
-		m42 = old.m41 * mat.m12 + old.m42 * mat.m22 + old.m43 * mat.m32 + old.m44 * mat.m42;
-		m43 = old.m41 * mat.m13 + old.m42 * mat.m23 + old.m43 * mat.m33 + old.m44 * mat.m43;
-		m44 = old.m41 * mat.m14 + old.m42 * mat.m24 + old.m43 * mat.m34 + old.m44 * mat.m44;
+		multiplyMatrixRows(&m11, 4, &mat.m11, &m11);
 
 		return *this;
 	}
 
+	// access
+	const float* getArray() const { return &m11; }
+
 	// matrix operation functions
 	void transpose() {
 		float oldVals[] = {
@@ -324,12 +358,59 @@ public:
 
 // non-member matrix-related arithmetic functions
 inline Vector4 operator * (const Vector4 vec, const Matrix4& mat) {
-	return Vector4(
-			vec.x * mat.m11 + vec.y * mat.m21 + vec.z * mat.m31 + vec.w * mat.m41,
-			vec.x * mat.m12 + vec.y * mat.m22 + vec.z * mat.m32 + vec.w * mat.m42,
-			vec.x * mat.m13 + vec.y * mat.m23 + vec.z * mat.m33 + vec.w * mat.m43,
-			vec.x * mat.m14 + vec.y * mat.m24 + vec.z * mat.m34 + vec.w * mat.m44
-		);
+	Vector4 result;
+	multiplyMatrixRows(&vec.x, 1, &mat.m11, &result.x);
+
+	return result;
+}
+
+// batch arithmetic functions, giving the same results as the operators
+// element by element (the matrices may be multiplied in place)
+inline void multiplyMatrices(const Matrix4* mats, size_t count, const Matrix4& mat, Matrix4* results) {
+	multiplyMatrixRows(&mats[0].m11, count * 4, &mat.m11, &results[0].m11);
+}
+inline void transformPoints(const Vector3* points, size_t count, const Matrix4& mat, Vector4* results) {
+	// with w always one, its term is just the last row, added last as before
+#if defined(MATRIXMATH_SSE)
+	__m128 matRow1 = _mm_loadu_ps(&mat.m11);
+	__m128 matRow2 = _mm_loadu_ps(&mat.m21);
+	__m128 matRow3 = _mm_loadu_ps(&mat.m31);
+	__m128 matRow4 = _mm_loadu_ps(&mat.m41);
+
+	for(size_t i = 0; i < count; ++i) {
+		__m128 result = _mm_mul_ps(_mm_set1_ps(points[i].x), matRow1);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[i].y), matRow2));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(points[i].z), matRow3));
+		result = _mm_add_ps(result, matRow4);
+
+		_mm_storeu_ps(&results[i].x, result);
+	}
+#elif defined(MATRIXMATH_NEON)
+	float32x4_t matRow1 = vld1q_f32(&mat.m11);
+	float32x4_t matRow2 = vld1q_f32(&mat.m21);
+	float32x4_t matRow3 = vld1q_f32(&mat.m31);
+	float32x4_t matRow4 = vld1q_f32(&mat.m41);
+
+	for(size_t i = 0; i < count; ++i) {
+		float32x4_t result = vmulq_n_f32(matRow1, points[i].x);
+		result = vaddq_f32(result, vmulq_n_f32(matRow2, points[i].y));
+		result = vaddq_f32(result, vmulq_n_f32(matRow3, points[i].z));
+		result = vaddq_f32(result, matRow4);
+
+		vst1q_f32(&results[i].x, result);
+	}
+#else
+	for(size_t i = 0; i < count; ++i) {
+		float x = points[i].x, y = points[i].y, z = points[i].z;
+
+		results[i] = Vector4(
+				x * mat.m11 + y * mat.m21 + z * mat.m31 + mat.m41,
+				x * mat.m12 + y * mat.m22 + z * mat.m32 + mat.m42,
+				x * mat.m13 + y * mat.m23 + z * mat.m33 + mat.m43,
+				x * mat.m14 + y * mat.m24 + z * mat.m34 + mat.m44
+			);
+	}
+#endif
 }
 
 // non-member matrix manipulation functions
@@ -373,4 +454,36 @@ inline void translateMatrix(float x, float y, float z, Matrix4& mat) {
 		);
 }
 
+// builds the matrix that scaleMatrix(), rotateMatrix() and translateMatrix()
+// would in turn from an identity matrix, without the multiplications
+inline Matrix4 transformMatrix(const Vector3 scale, const Matrix3& rotation, const Vector3 translation) {
+	return Matrix4(
+			scale.x * rotation.m11, scale.x * rotation.m12, scale.x * rotation.m13, 0.0f,
+			scale.y * rotation.m21, scale.y * rotation.m22, scale.y * rotation.m23, 0.0f,
+			scale.z * rotation.m31, scale.z * rotation.m32, scale.z * rotation.m33, 0.0f,
+			translation.x, translation.y, translation.z, 1.0f
+		);
+}
+inline Matrix4 transformMatrix(const Vector3 scale, const Vector3 axis, float angle, const Vector3 translation) {
+	float cosine = cos(angle), sine = sin(angle);
+
+	return transformMatrix(
+			scale,
+			Matrix3(
+					axis.x * axis.x * (1.0f - cosine) + cosine,
+					axis.x * axis.y * (1.0f - cosine) + axis.z * sine,
+					axis.x * axis.z * (1.0f - cosine) - axis.y * sine,
+
+					axis.y * axis.x * (1.0f - cosine) - axis.z * sine,
+					axis.y * axis.y * (1.0f - cosine) + cosine,
+					axis.y * axis.z * (1.0f - cosine) + axis.x * sine,
+
+					axis.z * axis.x * (1.0f - cosine) + axis.y * sine,
+					axis.z * axis.y * (1.0f - cosine) - axis.x * sine,
+					axis.z * axis.z * (1.0f - cosine) + cosine
+				),
+			translation
+		);
+}
+
 #endif // MATRIXMATH_H
@@ -14,7 +14,9 @@
 #include "GL/glew.h"
 #include <GL/gl.h>
 #else
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
+#include <GL/glext.h>
 #endif
 
 #endif // OPENGLHEADERS_H
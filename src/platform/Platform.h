@@ -22,11 +22,21 @@
 	#define PROGRAM_ARCH_STR "Unknown"
 #endif
 
+#include <map>
+#include <stdint.h>
 #include <string>
 
 class Platform {
+#ifdef PROGRAM_ARCH_LINUX
+private:
+	std::string preferencesPath;
+	std::map<std::string, std::string> preferences;
+	bool preferencesDirty;
+#endif
+
 public:
 	std::string dataPath;
+	std::string cachePath;
 
 	Platform();
 
@@ -35,13 +45,23 @@ public:
 
 	// time functions
 	unsigned int getExecMills();
+	uint64_t getExecNanos();
 	void sleepMills(unsigned int mills);
 
+	// processor information
+	static unsigned int getProcessorCount();
+
+	// file access
+	bool getFileInfo(const char* path, size_t* size, int64_t* modificationTime);
+	const void* mapFile(const char* path, size_t* size);
+	void unmapFile(const void* address, size_t size);
+
 	// application preferences
 	std::string getPreferenceString(const char* key);
 	float getPreferenceFloat(const char* key);
 	void setPreference(const char* key, const char* value);
 	void setPreference(const char* key, float value);
+	void flushPreferences();
 };
 
 #endif // PLATFORM_H
@@ -0,0 +1,307 @@
+// Platform.cpp
+// Dominicus
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <limits.h>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core/GameSystem.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+
+// preference values are stored one per line as "key=value", so line breaks,
+// tabs and backslashes within values must be escaped
+static std::string escapePreference(const std::string& value) {
+	std::string escaped;
+	escaped.reserve(value.length());
+
+	for(size_t i = 0; i < value.length(); ++i) {
+		if(value[i] == '\\')
+			escaped += "\\\\";
+		else if(value[i] == '\n')
+			escaped += "\\n";
+		else if(value[i] == '\r')
+			escaped += "\\r";
+		else if(value[i] == '\t')
+			escaped += "\\t";
+		else
+			escaped += value[i];
+	}
+
+	return escaped;
+}
+
+static std::string unescapePreference(const std::string& value) {
+	std::string unescaped;
+	unescaped.reserve(value.length());
+
+	for(size_t i = 0; i < value.length(); ++i) {
+		if(value[i] == '\\' && i < value.length() - 1) {
+			++i;
+			if(value[i] == 'n')
+				unescaped += '\n';
+			else if(value[i] == 'r')
+				unescaped += '\r';
+			else if(value[i] == 't')
+				unescaped += '\t';
+			else
+				unescaped += value[i];
+		} else {
+			unescaped += value[i];
+		}
+	}
+
+	return unescaped;
+}
+
+Platform::Platform() : preferencesDirty(false) {
+	// determine the resource directory path (an environment override, or else
+	// the directory containing the executable)
+	const char* dataPathOverride = getenv("DOMINICUS_DATA_PATH");
+
+	if(dataPathOverride != NULL && strlen(dataPathOverride) > 0) {
+		dataPath = dataPathOverride;
+	} else {
+		char executablePath[PATH_MAX];
+		ssize_t pathLength = readlink("/proc/self/exe", executablePath, PATH_MAX - 1);
+
+		if(pathLength <= 0) {
+			// no GameSystem yet to log so just print and exit
+			std::cout << "Could not get path for resource directory." << std::endl;
+			exit(1);
+		}
+		executablePath[pathLength] = '\0';
+
+		dataPath = executablePath;
+		dataPath = dataPath.substr(0, dataPath.rfind('/'));
+	}
+
+	// determine the preferences file path, creating its directory if needed
+	std::string configPath;
+	const char* xdgConfigHome = getenv("XDG_CONFIG_HOME");
+	const char* home = getenv("HOME");
+
+	if(xdgConfigHome != NULL && strlen(xdgConfigHome) > 0)
+		configPath = xdgConfigHome;
+	else if(home != NULL && strlen(home) > 0)
+		configPath = std::string(home) + "/.config";
+	else
+		configPath = ".";
+
+	mkdir(configPath.c_str(), 0755);
+	configPath += "/dominicus";
+	mkdir(configPath.c_str(), 0755);
+
+	preferencesPath = configPath + "/preferences.ini";
+
+	// determine the per-user cache directory path, creating it if needed
+	const char* xdgCacheHome = getenv("XDG_CACHE_HOME");
+
+	if(xdgCacheHome != NULL && strlen(xdgCacheHome) > 0)
+		cachePath = xdgCacheHome;
+	else if(home != NULL && strlen(home) > 0)
+		cachePath = std::string(home) + "/.cache";
+	else
+		cachePath = ".";
+
+	mkdir(cachePath.c_str(), 0755);
+	cachePath += "/dominicus";
+	mkdir(cachePath.c_str(), 0755);
+
+	// load any existing preferences into memory
+	std::ifstream preferencesFile(preferencesPath.c_str());
+	std::string line;
+
+	while(std::getline(preferencesFile, line)) {
+		if(line.length() == 0 || line[0] == '#' || line[0] == ';' || line[0] == '[')
+			continue;
+
+		size_t separator = line.find('=');
+		if(separator == std::string::npos)
+			continue;
+
+		preferences[line.substr(0, separator)] = unescapePreference(line.substr(separator + 1));
+	}
+
+	// initialize the random number generator
+	srand(time(NULL));
+}
+
+void Platform::consoleOut(std::string output) {
+	std::cout << output;
+}
+
+unsigned int Platform::getExecMills() {
+	return (unsigned int) (getExecNanos() / 1000000);
+}
+
+uint64_t Platform::getExecNanos() {
+	static timespec beginning = { 0, 0 };
+	static bool beginningSet = false;
+	timespec now;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+		if(gameSystem != NULL) {
+			gameSystem->log(GameSystem::LOG_FATAL,
+					"An error occurred when attempting to retrieve the time.");
+		} else {
+			std::cout << "An error occurred when attempting to retrieve the time." << std::endl;
+			exit(1);
+		}
+	}
+
+	if(! beginningSet) {
+		beginning = now;
+		beginningSet = true;
+	}
+
+	return
+			(uint64_t) (now.tv_sec - beginning.tv_sec) * 1000000000 +
+			(int64_t) (now.tv_nsec - beginning.tv_nsec);
+}
+
+void Platform::sleepMills(unsigned int mills) {
+	timespec delayTime;
+	delayTime.tv_sec = mills / 1000;
+	delayTime.tv_nsec = (mills % 1000) * 1000000;
+
+	// resume the sleep if a signal interrupts it
+	while(nanosleep(&delayTime, &delayTime) == -1 && errno == EINTR) { }
+}
+
+unsigned int Platform::getProcessorCount() {
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (processorCount > 0 ? (unsigned int) processorCount : 1);
+}
+
+bool Platform::getFileInfo(const char* path, size_t* size, int64_t* modificationTime) {
+	struct stat fileInfo;
+	if(stat(path, &fileInfo) != 0)
+		return false;
+
+	*size = (size_t) fileInfo.st_size;
+	*modificationTime = (int64_t) fileInfo.st_mtime;
+
+	return true;
+}
+
+const void* Platform::mapFile(const char* path, size_t* size) {
+	int fileDescriptor = open(path, O_RDONLY);
+	if(fileDescriptor == -1)
+		return NULL;
+
+	struct stat fileInfo;
+	if(fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size <= 0) {
+		close(fileDescriptor);
+
+		return NULL;
+	}
+
+	void* address = mmap(NULL, (size_t) fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if(address == MAP_FAILED)
+		return NULL;
+
+	*size = (size_t) fileInfo.st_size;
+
+	return address;
+}
+
+void Platform::unmapFile(const void* address, size_t size) {
+	if(address != NULL)
+		munmap(const_cast<void*>(address), size);
+}
+
+std::string Platform::getPreferenceString(const char* key) {
+	std::map<std::string, std::string>::iterator itr = preferences.find(key);
+
+	if(itr == preferences.end())
+		return std::string("");
+
+	return itr->second;
+}
+
+float Platform::getPreferenceFloat(const char* key) {
+	return atof(getPreferenceString(key).c_str());
+}
+
+void Platform::setPreference(const char* key, const char* value) {
+	std::string stringValue = value;
+
+	// the Mac OS X backend parses values as property list strings, so strip
+	// surrounding quotes the same way for consistent stored values
+	if(stringValue.length() >= 2 && stringValue[0] == '"' && stringValue[stringValue.length() - 1] == '"')
+		stringValue = stringValue.substr(1, stringValue.length() - 2);
+
+	std::map<std::string, std::string>::iterator itr = preferences.find(key);
+
+	if(itr != preferences.end() && itr->second == stringValue)
+		return;
+
+	preferences[key] = stringValue;
+	preferencesDirty = true;
+}
+
+void Platform::setPreference(const char* key, float value) {
+	std::stringstream stringValue;
+	stringValue << value;
+	setPreference(key, stringValue.str().c_str());
+}
+
+void Platform::flushPreferences() {
+	if(! preferencesDirty)
+		return;
+
+	// write everything to a temporary file and rename it over the old one, so
+	// the preferences file is replaced atomically in a single write
+	std::stringstream contents;
+	contents << "[Dominicus]\n";
+	for(
+			std::map<std::string, std::string>::iterator itr = preferences.begin();
+			itr != preferences.end();
+			++itr
+		)
+		contents << itr->first << "=" << escapePreference(itr->second) << "\n";
+
+	std::string contentsString = contents.str();
+	std::string temporaryPath = preferencesPath + ".tmp";
+
+	FILE* preferencesFile = fopen(temporaryPath.c_str(), "w");
+	if(preferencesFile == NULL) {
+		if(gameSystem != NULL)
+			gameSystem->log(GameSystem::LOG_INFO, "Could not open preferences file for writing: " + temporaryPath);
+
+		return;
+	}
+
+	bool writeSucceeded =
+			fwrite(contentsString.c_str(), 1, contentsString.length(), preferencesFile) == contentsString.length() &&
+			fflush(preferencesFile) == 0 &&
+			fsync(fileno(preferencesFile)) == 0;
+
+	if(fclose(preferencesFile) != 0 || ! writeSucceeded || rename(temporaryPath.c_str(), preferencesPath.c_str()) != 0) {
+		if(gameSystem != NULL)
+			gameSystem->log(GameSystem::LOG_INFO, "Could not write preferences file: " + preferencesPath);
+		unlink(temporaryPath.c_str());
+
+		return;
+	}
+
+	preferencesDirty = false;
+}
@@ -3,12 +3,17 @@
 
 #include <CoreFoundation/CoreFoundation.h>
 #include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <mach/mach_time.h>
 #include <sstream>
 #include <stdint.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "core/GameSystem.h"
 #include "platform/Platform.h"
@@ -31,6 +36,22 @@ Platform::Platform() {
 
 	dataPath = detectedDataPath;
 
+	// determine the per-user cache directory path, creating it if needed
+	const char* home = getenv("HOME");
+	CFStringRef bundleIdentifier = CFBundleGetIdentifier(bundle);
+	char identifier[256] = "Dominicus";
+	if(bundleIdentifier != NULL)
+		CFStringGetCString(bundleIdentifier, identifier, 256, kCFStringEncodingASCII);
+
+	if(home != NULL && strlen(home) > 0) {
+		cachePath = std::string(home) + "/Library/Caches";
+		mkdir(cachePath.c_str(), 0755);
+		cachePath += std::string("/") + identifier;
+	} else {
+		cachePath = std::string("/tmp/") + identifier;
+	}
+	mkdir(cachePath.c_str(), 0755);
+
 	// initialize the random number generator
 	srand(time(NULL));
 }
@@ -40,35 +61,87 @@ void Platform::consoleOut(std::string output) {
 }
 
 unsigned int Platform::getExecMills() {
+	return (unsigned int) (getExecNanos() / 1000000);
+}
+
+uint64_t Platform::getExecNanos() {
 	static uint64_t beginning = mach_absolute_time();
+	static mach_timebase_info_data_t timeInfo = { 0, 0 };
 	uint64_t now = mach_absolute_time();
-	mach_timebase_info_data_t timeInfo;
-	kern_return_t error = mach_timebase_info(&timeInfo);
-
-	if(error) {
-		if(gameSystem != NULL) {
-			gameSystem->log(GameSystem::LOG_FATAL,
-					"An error occurred when attempting to retrieve the time.");
-		} else {
-			std::cout << "An error occurred when attempting to retrieve the time." << std::endl;
+
+	// the timebase never changes while running, so only query it once
+	if(timeInfo.denom == 0) {
+		kern_return_t error = mach_timebase_info(&timeInfo);
+
+		if(error || timeInfo.denom == 0) {
+			if(gameSystem != NULL) {
+				gameSystem->log(GameSystem::LOG_FATAL,
+						"An error occurred when attempting to retrieve the time.");
+			} else {
+				std::cout << "An error occurred when attempting to retrieve the time." << std::endl;
+				exit(1);
+			}
 		}
 	}
 
-	return (unsigned int) (
-			(0.000001 *
-					((double) timeInfo.numer / (double) timeInfo.denom) *
-					(double) (now - beginning)
-				)
+	return (uint64_t) (
+			((double) timeInfo.numer / (double) timeInfo.denom) *
+			(double) (now - beginning)
 		);
 }
 
 void Platform::sleepMills(unsigned int mills) {
 	timespec delayTime;
-	delayTime.tv_sec = 0;
-	delayTime.tv_nsec = mills * 1000000;
+	delayTime.tv_sec = mills / 1000;
+	delayTime.tv_nsec = (mills % 1000) * 1000000;
 	nanosleep(&delayTime, NULL);
 }
 
+unsigned int Platform::getProcessorCount() {
+	long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (processorCount > 0 ? (unsigned int) processorCount : 1);
+}
+
+bool Platform::getFileInfo(const char* path, size_t* size, int64_t* modificationTime) {
+	struct stat fileInfo;
+	if(stat(path, &fileInfo) != 0)
+		return false;
+
+	*size = (size_t) fileInfo.st_size;
+	*modificationTime = (int64_t) fileInfo.st_mtime;
+
+	return true;
+}
+
+const void* Platform::mapFile(const char* path, size_t* size) {
+	int fileDescriptor = open(path, O_RDONLY);
+	if(fileDescriptor == -1)
+		return NULL;
+
+	struct stat fileInfo;
+	if(fstat(fileDescriptor, &fileInfo) != 0 || fileInfo.st_size <= 0) {
+		close(fileDescriptor);
+
+		return NULL;
+	}
+
+	void* address = mmap(NULL, (size_t) fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if(address == MAP_FAILED)
+		return NULL;
+
+	*size = (size_t) fileInfo.st_size;
+
+	return address;
+}
+
+void Platform::unmapFile(const void* address, size_t size) {
+	if(address != NULL)
+		munmap(const_cast<void*>(address), size);
+}
+
 std::string Platform::getPreferenceString(const char* key) {
 	std::string toReturn = std::string("");
 	CFStringRef keyRef = CFStringCreateWithCString(NULL, key, kCFStringEncodingASCII);
@@ -95,7 +168,6 @@ void Platform::setPreference(const char* key, const char* value) {
 	CFDataRef dataRef = CFDataCreate(NULL, (uint8_t*) value, strlen(value));
 	CFPropertyListRef propertyList = CFPropertyListCreateWithData(NULL, dataRef, kCFPropertyListImmutable, NULL, NULL);
 	CFPreferencesSetAppValue(keyRef, propertyList, kCFPreferencesCurrentApplication);
-	CFPreferencesSynchronize(kCFPreferencesCurrentApplication, kCFPreferencesCurrentUser, kCFPreferencesAnyHost);
 
 	CFRelease(keyRef);
 	CFRelease(dataRef);
@@ -108,3 +180,7 @@ void Platform::setPreference(const char* key, float value) {
 	stringValue << value;
 	setPreference(key, stringValue.str().c_str());
 }
+
+void Platform::flushPreferences() {
+	CFPreferencesSynchronize(kCFPreferencesCurrentApplication, kCFPreferencesCurrentUser, kCFPreferencesAnyHost);
+}
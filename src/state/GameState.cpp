@@ -4,16 +4,21 @@
 #include "state/GameState.h"
 
 #include <cmath>
-#include <cstring>
+#include <cstdlib>
+#include <vector>
 
+#include "core/AssetManager.h"
 #include "core/GameSystem.h"
+#include "core/JobSystem.h"
 #include "geometry/DiamondSquare.h"
 #include "math/MatrixMath.h"
 #include "math/MiscMath.h"
 #include "math/ScalarMath.h"
 #include "platform/Platform.h"
 
+extern AssetManager* assetManager;
 extern GameSystem* gameSystem;
+extern JobSystem* jobSystem;
 extern Platform* platform;
 
 void Fortress::addRotation(float value) {
@@ -35,6 +40,110 @@ void Fortress::missileStrike() {
 	if(health < 0.0f) health = 0.0f;
 }
 
+// constants of the missile flight path's two turns
+static const float missileTurnSin45 = sin(radians(45.0f));
+static const float missileTurnCos45 = cos(radians(45.0f));
+static const float missileFinalTurnHeightRange = cos(radians(0.0f)) - cos(radians(45.0f));
+static const float missilePhaseSplitFactor = 1.0f + cos(radians(45.0f)) * 1.0f / (1.0f - sin(radians(45.0f)));
+
+MissileProfile::MissileProfile(Vector3 originPosition, Vector3 fortressPosition) : isReady(true) {
+	// the lateral distance has always been measured to a point using the
+	// fortress's height for depth, which the path's shape depends on
+	float lateralDistanceTofortress = distance(originPosition, Vector3(fortressPosition.x, 0.0f, fortressPosition.y));
+	float initialTurnPhaseLatDist = 1.0f / missilePhaseSplitFactor * lateralDistanceTofortress;
+	float finalTurnPhaseRadius = 1.0f / (1.0f - missileTurnSin45) * initialTurnPhaseLatDist;
+
+	climbEnd = fortressPosition.y;
+	initialTurnLength = 0.5f * initialTurnPhaseLatDist * PI;
+	finalTurnLength = 0.25f * finalTurnPhaseRadius * PI;
+	finalTurnEnd = initialTurnLength + finalTurnLength;
+
+	fortressHeight = fortressPosition.y;
+	initialTurnHeight = initialTurnPhaseLatDist;
+	origin = Vector2(originPosition.x, originPosition.z);
+	initialTurnSpan = Vector2(
+			(1.0f / (missilePhaseSplitFactor)) * (fortressPosition.x - originPosition.x),
+			(1.0f / (missilePhaseSplitFactor)) * (fortressPosition.z - originPosition.z)
+		);
+	finalTurnOrigin = Vector2(origin.x + initialTurnSpan.x, origin.y + initialTurnSpan.y);
+	finalTurnSpan = Vector2(
+			((missilePhaseSplitFactor - 1.0f) / missilePhaseSplitFactor) * (fortressPosition.x - originPosition.x),
+			((missilePhaseSplitFactor - 1.0f) / missilePhaseSplitFactor) * (fortressPosition.z - originPosition.z)
+		);
+}
+
+bool MissileProfile::evaluate(float distanceTraveled, Missile& missile) const {
+	if(distanceTraveled <= climbEnd) {
+		// below fortress altitude
+		missile.position = Vector3(origin.x, distanceTraveled, origin.y);
+
+		return true;
+	}
+
+	float distanceTraveledIntoTurnPhases = distanceTraveled - climbEnd;
+
+	if(distanceTraveledIntoTurnPhases < initialTurnLength) {
+		// initial turn phase, a quarter circle up and toward the fortress
+		float completionFactor = (distanceTraveledIntoTurnPhases / initialTurnLength);
+		float lateralProgress = 1.0f - cos(radians(completionFactor * 90.0f));
+
+		missile.position = Vector3(
+				origin.x + initialTurnSpan.x * lateralProgress,
+				fortressHeight + sin(radians(completionFactor * 90.0f)) * initialTurnHeight,
+				origin.y + initialTurnSpan.y * lateralProgress
+			);
+		missile.tilt = (1.0f - completionFactor) * 90.0f;
+
+		return true;
+	} else if(distanceTraveledIntoTurnPhases < finalTurnEnd) {
+		// final turn phase, an eighth circle down onto the fortress
+		float completionFactor = (distanceTraveledIntoTurnPhases - initialTurnLength) / finalTurnLength;
+		float lateralProgress = sin(radians(completionFactor * 45.0f));
+
+		missile.position = Vector3(
+				finalTurnOrigin.x + finalTurnSpan.x * lateralProgress / missileTurnSin45,
+				fortressHeight + initialTurnHeight * (cos(radians(completionFactor * 45.0f)) - missileTurnCos45) / missileFinalTurnHeightRange,
+				finalTurnOrigin.y + finalTurnSpan.y * lateralProgress / missileTurnSin45
+			);
+		missile.tilt = 0.0f - completionFactor * 45.0f;
+
+		return true;
+	}
+
+	return false;
+}
+
+// one smoothing pass over the wrapping heightmap, in tiles
+class TerrainBlendTask : public RangeTask {
+public:
+	const float* source;
+	float* destination;
+	unsigned int density;
+
+	void run(unsigned int beginX, unsigned int endX, unsigned int beginY, unsigned int endY) {
+		for(unsigned int i = beginY; i < endY; ++i) {
+			for(unsigned int p = beginX; p < endX; ++p) {
+				unsigned int
+							nCoord = (p + 1 == density ? 0 : p + 1),
+							sCoord = (p == 0 ? density - 1 : p - 1),
+							wCoord = (i == 0 ? density - 1 : i - 1),
+							eCoord = (i + 1 == density ? 0 : i + 1);
+
+				destination[i * density + p] =
+						source[i * density + p] * 0.1f +
+						(source[wCoord * density + sCoord] +
+								source[wCoord * density + nCoord] +
+								source[eCoord * density + nCoord] +
+								source[eCoord * density + sCoord]) / 4.0f * 0.4f +
+						(source[wCoord * density + p] +
+								source[i * density + nCoord] +
+								source[eCoord * density + p] +
+								source[i * density + sCoord]) / 4.0f * 0.5;
+			}
+		}
+	}
+};
+
 unsigned int GameState::getGameMills() {
 	// execution time since game began (excluding pauses)
 	if(isPaused)
@@ -43,13 +152,36 @@ unsigned int GameState::getGameMills() {
 		return (unsigned int) (platform->getExecMills() - gameTimeMargin);
 }
 
-GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("stateUpdateFrequency")),
+GameState::ModelMetrics GameState::getModelMetrics() {
+	ModelMetrics metrics;
+
+	metrics.shipMissileOrigin = assetManager->getGroupInfo("ship", "missileorigin").anchor;
+	metrics.turretOrigin = assetManager->getGroupInfo("fortress", "turretorigin").anchor;
+	metrics.shellOrigin = assetManager->getGroupInfo("fortress", "shellorigin").anchor;
+	metrics.shellRadius = assetManager->getGroupInfo("fortress", "shellorigin").anchorRadius;
+
+	const AssetManager::ModelInfo& missileInfo = assetManager->getModelInfo("missile");
+	metrics.missileLength = maximum(missileInfo.boundsMax.x, 0.0f) - minimum(missileInfo.boundsMin.x, 0.0f);
+
+	const AssetManager::GroupInfo& missileBodyInfo = assetManager->getGroupInfo("missile", "lightgrain");
+	metrics.missileRadius = maximum(absolute(missileBodyInfo.boundsMin.y), absolute(missileBodyInfo.boundsMax.y));
+
+	return metrics;
+}
+
+GameState::GameState(const ModelMetrics& modelMetrics) : MainLoopMember((unsigned int) gameSystem->getFloat("stateUpdateFrequency")),
+		eventCount(0),
 		score(0),
+		shipMissileOrigin(modelMetrics.shipMissileOrigin),
+		turretOrigin(modelMetrics.turretOrigin),
+		shellOrigin(modelMetrics.shellOrigin),
 		invertShipOrbit(rand() % 2 == 1 ? true : false),
+		shellRadius(modelMetrics.shellRadius),
+		missileLength(modelMetrics.missileLength),
+		missileRadius(modelMetrics.missileRadius),
 		binoculars(false),
 		recoil(false),
 		empIsCharging(false),
-		lastStrikeTime(0),
 		isPaused(false),
 		lastUpdateGameTime(0) {
 	// randomly generate the island
@@ -64,51 +196,39 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 	float textureStretch = 10.0f;
 
 	// generate the initial diamond-square heightmap (it repeats 2x over width/length)
-	DiamondSquare diamondSquare(density / 2, rough);
+	DiamondSquare diamondSquare(density / 2, rough, (unsigned int) rand());
 
-	// set the initial terrain values from the heightmap and re-map to positive (except sink)
-	float dsHeightMap[density][density];
+	// the heightmaps are kept off the stack, since at high detail they are
+	// too large for the stack of the background thread a new game loads on
+	std::vector<float> dsHeightMap(density * density);
 
+	// set the initial terrain values from the heightmap and re-map to positive (except sink)
 	for(size_t i = 0; i < density; ++i) {
 		for(size_t p = 0; p < density; ++p) {
 			int realI = (i >= density / 2 ? i - density / 2 : i);
 			int realP = (p >= density / 2 ? p - density / 2 : p);
 
-			dsHeightMap[i][p] = (diamondSquare.data[realI][realP] + 1.0f - sink) * (1 / (2.0f - sink));
+			dsHeightMap[i * density + p] = (diamondSquare.data[realI][realP] + 1.0f - sink) * (1 / (2.0f - sink));
 		}
 	}
 
 	// blending
-	for(int q = 0; q < blends; ++q) {
-		float blendData[density][density];
-		memcpy((void*) blendData, (const void*) dsHeightMap, density * density * sizeof(float));
+	std::vector<float> blendData(density * density);
 
-		for(unsigned int i = 0; i < density; ++i) {
-			for(unsigned int p = 0; p < density; ++p) {
-				unsigned int
-							nCoord = (p + 1 == density ? 0 : p + 1),
-							sCoord = (p == 0 ? density - 1 : p - 1),
-							wCoord = (i == 0 ? density - 1 : i - 1),
-							eCoord = (i + 1 == density ? 0 : i + 1);
+	TerrainBlendTask blendTask;
+	blendTask.density = density;
 
-				blendData[i][p] =
-						dsHeightMap[i][p] * 0.1f +
-						(dsHeightMap[wCoord][sCoord] +
-								dsHeightMap[wCoord][nCoord] +
-								dsHeightMap[eCoord][nCoord] +
-								dsHeightMap[eCoord][sCoord]) / 4.0f * 0.4f +
-						(dsHeightMap[wCoord][p] +
-								dsHeightMap[i][nCoord] +
-								dsHeightMap[eCoord][p] +
-								dsHeightMap[i][sCoord]) / 4.0f * 0.5;
-			}
-		}
+	for(int q = 0; q < blends; ++q) {
+		blendTask.source = &dsHeightMap[0];
+		blendTask.destination = &blendData[0];
 
-		memcpy((void*) dsHeightMap, (const void*) blendData, density * density * sizeof(float));
+		jobSystem->parallelFor(blendTask, density, density, density, 64, "terrain blend");
+
+		dsHeightMap.swap(blendData);
 	}
 
 	// generate an "alphaBump" mappings for height variance in island
-	float alphaHeightMap[density][density];
+	std::vector<float> alphaHeightMap(density * density);
 
 	Vector2 midpoint(0.0f, 0.0f);
 
@@ -125,20 +245,20 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 			float dist = distance(coord, midpoint);
 
 			if(dist < 1.0f - gradDist)
-					alphaHeightMap[p][j] = 1.0f;
+					alphaHeightMap[p * density + j] = 1.0f;
 			else if(dist < 1.0f)
-					alphaHeightMap[p][j] = (1.0f - dist) / gradDist;
+					alphaHeightMap[p * density + j] = (1.0f - dist) / gradDist;
 			else
-				alphaHeightMap[p][j] = 0.0f;
+				alphaHeightMap[p * density + j] = 0.0f;
 		}
 	}
 
 	// adjust the heightmap for the alpha values
-	float comboHeightMap[density][density];
+	std::vector<float> comboHeightMap(density * density);
 
 	for(unsigned int i = 0; i < density; ++i)
 		for(unsigned int p = 0; p < density; ++p)
-			comboHeightMap[i][p] = (dsHeightMap[i][p]) * alphaHeightMap[i][p];
+			comboHeightMap[i * density + p] = (dsHeightMap[i * density + p]) * alphaHeightMap[i * density + p];
 
 
 	// re-map all the values to the range 1.0, sink
@@ -146,10 +266,10 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 
 	for(size_t i = 0; i < density; ++i) {
 		for(size_t p = 0; p < density; ++p) {
-			if(comboHeightMap[i][p] > max)
-				max = comboHeightMap[i][p];
-			else if(comboHeightMap[i][p] < min)
-				min = comboHeightMap[i][p];
+			if(comboHeightMap[i * density + p] > max)
+				max = comboHeightMap[i * density + p];
+			else if(comboHeightMap[i * density + p] < min)
+				min = comboHeightMap[i * density + p];
 		}
 	}
 
@@ -157,14 +277,14 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 
 	for(size_t i = 0; i < density; ++i)
 		for(size_t p = 0; p < density; ++p)
-			comboHeightMap[i][p] = (-min + comboHeightMap[i][p]) / range * (1.0f + sink) - sink;
+			comboHeightMap[i * density + p] = (-min + comboHeightMap[i * density + p]) / range * (1.0f + sink) - sink;
 
 	// create a mesh with that terrain data
 	for(unsigned int i = 0; i < density; ++i) {
 		for(unsigned int p = 0; p < density; ++p) {
 			island.addVertex(Vector3(
 					((float) i / (float) density * 2.0f - 1.0f) * diameter / 2.0f,
-					comboHeightMap[i][p] * height - gameSystem->getFloat("terrainDepth"),
+					comboHeightMap[i * density + p] * height - gameSystem->getFloat("terrainDepth"),
 					((float) p / (float) density * 2.0f - 1.0f) * diameter / 2.0f
 				));
 			island.addTexCoord(Vector2(
@@ -206,8 +326,8 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 		}
 	}
 
-	// auto-normal
-	island.autoNormal();
+	// auto-normal, with a slice of the faces for each worker and this thread
+	island.autoNormal(Mesh::WEIGHT_AREA, jobSystem->getWorkerCount() + 1);
 
 	// set the fortress position
 	fortress.position = Vector3(0.0f, 0.0f, 0.0f);
@@ -220,50 +340,11 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 		if(itr->y > fortress.position.y)
 			fortress.position = *itr;
 
-	// determine some state info from models
-	Mesh shipMesh("ship");
-	shipMissileOrigin = (
-			shipMesh.vertices[shipMesh.faceGroups["missileorigin"][0].vertices[0]] +
-			shipMesh.vertices[shipMesh.faceGroups["missileorigin"][0].vertices[1]] +
-			shipMesh.vertices[shipMesh.faceGroups["missileorigin"][0].vertices[2]]
-		) / 3.0f;
-
-	Mesh fortressMesh("fortress");
-	turretOrigin = (
-			fortressMesh.vertices[fortressMesh.faceGroups["turretorigin"][0].vertices[0]] +
-			fortressMesh.vertices[fortressMesh.faceGroups["turretorigin"][0].vertices[1]] +
-			fortressMesh.vertices[fortressMesh.faceGroups["turretorigin"][0].vertices[2]]
-		) / 3.0f;
-
-	shellOrigin = (
-			fortressMesh.vertices[fortressMesh.faceGroups["shellorigin"][0].vertices[0]] +
-			fortressMesh.vertices[fortressMesh.faceGroups["shellorigin"][0].vertices[1]] +
-			fortressMesh.vertices[fortressMesh.faceGroups["shellorigin"][0].vertices[2]]
-		) / 3.0f;
-
-	shellRadius = distance(shellOrigin, fortressMesh.vertices[fortressMesh.faceGroups["shellorigin"][0].vertices[0]]);
-
-	Mesh missileMesh("missile");
-	float minXValue = 0.0f, maxXValue = 0.0f;
-	for(size_t i = 0; i < missileMesh.vertices.size(); ++i) {
-		if(missileMesh.vertices[i].x < minXValue)
-			minXValue = missileMesh.vertices[i].x;
-		if(missileMesh.vertices[i].x > maxXValue)
-			maxXValue = missileMesh.vertices[i].x;
-	}
-	missileLength = maxXValue - minXValue;
+	events.reserve(eventCapacity);
 
-
-	float maxDist = 0.0f;
-	for(size_t i = 0; i < missileMesh.faceGroups["lightgrain"].size(); ++i) {
-		if(absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[0]].y) > maxDist)
-			maxDist = absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[0]].y);
-		if(absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[1]].y) > maxDist)
-			maxDist = absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[1]].y);
-		if(absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[2]].y) > maxDist)
-			maxDist = absolute(missileMesh.vertices[missileMesh.faceGroups["lightgrain"][i].vertices[2]].y);
-	}
-	missileRadius = maxDist;
+	// shells are never added past this, so they are never reallocated
+	shellCapacity = (size_t) maximum(1.0f, gameSystem->getFloat("stateShellCapacity"));
+	shells.reserve(shellCapacity);
 
 	// set start time
 	gameTimeMargin = platform->getExecMills();
@@ -272,6 +353,24 @@ GameState::GameState() : MainLoopMember((unsigned int) gameSystem->getFloat("sta
 GameState::~GameState() {
 }
 
+void GameState::addEvent(GameEvent::Type type, size_t missile, Vector3 position) {
+	GameEvent event(type, lastUpdateGameTime, missile, position);
+
+	// once full, overwrite the oldest
+	if(events.size() < eventCapacity)
+		events.push_back(event);
+	else
+		events[eventCount % eventCapacity] = event;
+
+	++eventCount;
+}
+
+void GameState::removeShell(size_t index) {
+	// order doesn't matter, so fill the gap with the last shell
+	shells[index] = shells.back();
+	shells.pop_back();
+}
+
 unsigned int GameState::execute(bool unScheduled) {
 	// get a delta time for stuff that doesn't use precomputed state
 	unsigned int newGameTime = getGameMills();
@@ -347,6 +446,8 @@ unsigned int GameState::execute(bool unScheduled) {
 		}
 	}
 
+	size_t firstNewMissile = missiles.size();
+
 	for(size_t i = 0; i < ships.size(); ++i) {
 		float shipLifeTime = (float) (lastUpdateGameTime - ships[i].originTime) / 1000.0f;
 
@@ -365,6 +466,7 @@ unsigned int GameState::execute(bool unScheduled) {
 			missile.tilt = 90.0f;
 
 			missiles.push_back(missile);
+			missileProfiles.push_back(MissileProfile());
 		}
 	}
 
@@ -376,23 +478,27 @@ unsigned int GameState::execute(bool unScheduled) {
 	for(size_t i = 0; i < missiles.size(); ++i)
 		previousMissilePositions.push_back(missiles[i].position);
 
-	// do movement
+	// do movement; once a missile leaves its ship its path no longer depends
+	// on anything else, so from then on it just follows its profile
+	const float missileSpeed = gameSystem->getFloat("stateMissileSpeed");
+
 	for(size_t i = 0; i < missiles.size(); ++i) {
 		if(! missiles[i].alive)
 			continue;
 
-		Matrix3 missileOriginMatrix; missileOriginMatrix.identity();
-		rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), radians(ships[missiles[i].originShip].rotation), missileOriginMatrix);
-		Vector3 thisShipMissileOrigin(
-				shipMissileOrigin.x,
-				shipMissileOrigin.y,
-				shipMissileOrigin.z
-			);
-		thisShipMissileOrigin = thisShipMissileOrigin * missileOriginMatrix;
+		float distanceTraveled = (float) (lastUpdateGameTime - missiles[i].launchTime) / 1000.0f * missileSpeed;
 
-		float distanceTraveled = (float) (lastUpdateGameTime - missiles[i].launchTime) / 1000.0f * gameSystem->getFloat("stateMissileSpeed");
 		if(distanceTraveled <= shipMissileOrigin.y) {
 			// still launching from ship
+			Matrix3 missileOriginMatrix; missileOriginMatrix.identity();
+			rotateMatrix(Vector3(0.0f, 1.0f, 0.0f), radians(ships[missiles[i].originShip].rotation), missileOriginMatrix);
+			Vector3 thisShipMissileOrigin(
+					shipMissileOrigin.x,
+					shipMissileOrigin.y,
+					shipMissileOrigin.z
+				);
+			thisShipMissileOrigin = thisShipMissileOrigin * missileOriginMatrix;
+
 			missiles[i].position = Vector3(
 					ships[missiles[i].originShip].position.x + thisShipMissileOrigin.x,
 					distanceTraveled,
@@ -405,50 +511,27 @@ unsigned int GameState::execute(bool unScheduled) {
 					missiles[i].originPosition.x - fortress.position.x,
 					missiles[i].originPosition.z - fortress.position.z
 				)) + 180.0f;
-		} else if(distanceTraveled <= fortress.position.y) {
-			// below fortress altitude
-			missiles[i].position.y = distanceTraveled;
-		} else {
-			// initial turn phase or final turn phase
-			float lateralDistanceTofortress = distance(missiles[i].originPosition, Vector3(fortress.position.x, 0.0f, fortress.position.y));
-			static float phaseSplitFactor = 1.0f + cos(radians(45.0f)) * 1.0f / (1.0f - sin(radians(45.0f)));
-			float initialTurnPhaseLatDist = 1.0f / phaseSplitFactor * lateralDistanceTofortress;
-			float finalTurnPhaseRadius = 1.0f / (1.0f - (sin(radians(45.0f)))) * initialTurnPhaseLatDist;
-			float distanceTraveledIntoTurnPhases = distanceTraveled - fortress.position.y;
-
-			if(distanceTraveledIntoTurnPhases < 0.5f * initialTurnPhaseLatDist * PI) {
-				// initial turn phase
-				float completionFactor = (distanceTraveledIntoTurnPhases / (0.5f * initialTurnPhaseLatDist * PI));
-
-				missiles[i].position = Vector3(
-						missiles[i].originPosition.x + (1.0f / (phaseSplitFactor)) * (fortress.position.x - missiles[i].originPosition.x) * (1.0f - cos(radians(completionFactor * 90.0f))),
-						fortress.position.y + sin(radians(completionFactor * 90.0f)) * initialTurnPhaseLatDist,
-						missiles[i].originPosition.z + (1.0f / (phaseSplitFactor)) * (fortress.position.z - missiles[i].originPosition.z) * (1.0f - cos(radians(completionFactor * 90.0f)))
-					);
-				missiles[i].tilt = (1.0f - completionFactor) * 90.0f;
-			} else if(distanceTraveledIntoTurnPhases < 0.5f * initialTurnPhaseLatDist * PI + 0.25f * finalTurnPhaseRadius * PI) {
-				// final turn phase
-				float completionFactor = (distanceTraveledIntoTurnPhases - 0.5f * initialTurnPhaseLatDist * PI) / (0.25f * finalTurnPhaseRadius * PI);
-
-				missiles[i].position = Vector3(
-						missiles[i].originPosition.x + (1.0f / (phaseSplitFactor)) * (fortress.position.x - missiles[i].originPosition.x) +
-								((phaseSplitFactor - 1.0f) / phaseSplitFactor) * (fortress.position.x - missiles[i].originPosition.x) * sin(radians(completionFactor * 45.0f)) / sin(radians(45.0f)),
-						fortress.position.y + initialTurnPhaseLatDist * (cos(radians(completionFactor * 45.0f)) - cos(radians(45.0f))) / (cos(radians(0.0f)) - cos(radians(45.0f))),
-						missiles[i].originPosition.z + (1.0f / (phaseSplitFactor)) * (fortress.position.z - missiles[i].originPosition.z) +
-								((phaseSplitFactor - 1.0f) / phaseSplitFactor) * (fortress.position.z - missiles[i].originPosition.z) * sin(radians(completionFactor * 45.0f)) / sin(radians(45.0f))
-					);
-				missiles[i].tilt = 0.0f - completionFactor * 45.0f;
-			} else {
-				// end of path... boom
-				missiles[i].alive = false;
 
-				fortress.missileStrike();
+			continue;
+		}
 
-				lastStrikeTime = lastUpdateGameTime;
-			}
+		if(! missileProfiles[i].isReady)
+			missileProfiles[i] = MissileProfile(missiles[i].originPosition, fortress.position);
+
+		if(! missileProfiles[i].evaluate(distanceTraveled, missiles[i])) {
+			// end of path... boom
+			missiles[i].alive = false;
+
+			fortress.missileStrike();
+
+			addEvent(GameEvent::FORTRESS_STRUCK, i, missiles[i].position);
 		}
 	}
 
+	// announce launches once the missiles have left their ships
+	for(size_t i = firstNewMissile; i < missiles.size(); ++i)
+		addEvent(GameEvent::MISSILE_LAUNCHED, i, missiles[i].position);
+
 	// missile/shell collisions
 	for(size_t i = 0; i < missiles.size(); ++i) {
 		if(! missiles[i].alive)
@@ -464,7 +547,7 @@ unsigned int GameState::execute(bool unScheduled) {
 		size_t p = 0;
 		while(p < shells.size()) {
 			Vector3 shellStartPos = shells[p].position;
-			Vector3 shellTravelVec = shells[p].direction * deltaTime * gameSystem->getFloat("stateShellSpeed");
+			Vector3 shellTravelVec = shells[p].velocity * deltaTime;
 
 			// calculate the closest point of approach for these two vectors
 			// not really sure how this works since I ripped it off from a math tutorial, but it seems to do the trick
@@ -495,8 +578,9 @@ unsigned int GameState::execute(bool unScheduled) {
 				) <= missileRadius * gameSystem->getFloat("stateMissileRadiusMultiplier")) {
 				missiles[i].position += missileTravelVec;
 				missiles[i].alive = false;
-				shells.erase(shells.begin() + p);
+				removeShell(p);
 				score += gameSystem->getFloat("gameStartingLevel");
+				addEvent(GameEvent::MISSILE_SHOT, i, missiles[i].position);
 
 				break;
 			}
@@ -506,15 +590,13 @@ unsigned int GameState::execute(bool unScheduled) {
 	}
 
 	// update shell positions
+	for(size_t i = 0; i < shells.size(); ++i)
+		shells[i].position += shells[i].velocity * deltaTime;
+
 	size_t i = 0;
 	while(i < shells.size()) {
-		shells[i].position += shells[i].direction * deltaTime * gameSystem->getFloat("stateShellSpeed");
-
-		if(
-				distance(fortress.position, shells[i].position) >= gameSystem->getFloat("stateShellExpirationDistance") ||
-				shells[i].position.y < 0.0f
-			)
-			shells.erase(shells.begin() + i);
+		if(lastUpdateGameTime >= shells[i].expirationTime)
+			removeShell(i);
 		else
 			++i;
 	}
@@ -587,6 +669,7 @@ unsigned int GameState::execute(bool unScheduled) {
 			if(distance(fortress.position, missiles[i].position) < (1.0f - fortress.emp) * gameSystem->getFloat("stateEMPRange")) {
 				missiles[i].alive = false;
 				score += gameSystem->getFloat("gameStartingLevel");
+				addEvent(GameEvent::MISSILE_EMP, i, missiles[i].position);
 			}
 		}
 	}
@@ -624,7 +707,10 @@ void GameState::bumpStart() {
 }
 
 void GameState::fireShell() {
-	if(fortress.ammunition < gameSystem->getFloat("stateAmmoFiringCost"))
+	if(
+			fortress.ammunition < gameSystem->getFloat("stateAmmoFiringCost") ||
+			shells.size() >= shellCapacity
+		)
 		return;
 
 	Matrix4 shellMatrix; shellMatrix.identity();
@@ -658,8 +744,24 @@ void GameState::fireShell() {
 			shellPosition.z
 		);
 	shell.direction.norm();
+	shell.velocity = shell.direction * gameSystem->getFloat("stateShellSpeed");
+
+	// the path is straight, so find when it leaves the expiration distance
+	// from the fortress or falls below the water in advance
+	float expirationDistance = gameSystem->getFloat("stateShellExpirationDistance");
+	Vector3 fortressOffset = shell.position - fortress.position;
+	float directionOffset = dot(fortressOffset, shell.direction);
+	float travelDistance =
+			-directionOffset +
+			sqrt(maximum(directionOffset * directionOffset - dot(fortressOffset, fortressOffset) + expirationDistance * expirationDistance, 0.0f));
+
+	if(shell.direction.y < 0.0f)
+		travelDistance = minimum(travelDistance, shell.position.y / -shell.direction.y);
+
+	shell.expirationTime = lastUpdateGameTime + (unsigned int) (travelDistance / gameSystem->getFloat("stateShellSpeed") * 1000.0f);
 
 	shells.push_back(shell);
+	addEvent(GameEvent::SHELL_FIRED, 0, shell.position);
 
 	fortress.ammunition -= gameSystem->getFloat("stateAmmoFiringCost");
 
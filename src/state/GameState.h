@@ -39,6 +39,8 @@ class Shell {
 public:
 	Vector3 position;
 	Vector3 direction;
+	Vector3 velocity;
+	unsigned int expirationTime;	// when it will leave range or reach the water
 };
 
 class Ship {
@@ -61,18 +63,83 @@ public:
 	float tilt;
 };
 
+// a missile's path toward the fortress once it has left its ship, fixed at
+// that point, as a function of the distance the missile has traveled
+class MissileProfile {
+public:
+	bool isReady;
+
+	float climbEnd;				// distance traveled at fortress altitude
+	double initialTurnLength;
+	double finalTurnLength;
+	double finalTurnEnd;		// distance into the turns when the flight ends
+
+	float fortressHeight;
+	float initialTurnHeight;
+	Vector2 origin;
+	Vector2 initialTurnSpan;	// lateral movement during the initial turn
+	Vector2 finalTurnOrigin;
+	Vector2 finalTurnSpan;		// lateral movement during the final turn
+
+	MissileProfile() : isReady(false) { }
+	MissileProfile(Vector3 originPosition, Vector3 fortressPosition);
+
+	// sets the missile's position and tilt, returning false at the flight's end
+	bool evaluate(float distanceTraveled, Missile& missile) const;
+};
+
+class GameEvent {
+public:
+	enum Type {
+		MISSILE_LAUNCHED,
+		MISSILE_SHOT,	// by a shell
+		MISSILE_EMP,	// by the EMP
+		FORTRESS_STRUCK,
+		SHELL_FIRED
+	};
+
+	Type type;
+	unsigned int time;
+	size_t missile;		// index into GameState::missiles, if about a missile
+	Vector3 position;
+
+	GameEvent(Type type, unsigned int time, size_t missile, Vector3 position) :
+			type(type),
+			time(time),
+			missile(missile),
+			position(position) { }
+};
+
 class GameState : public MainLoopMember {
 private:
+	std::vector<GameEvent> events;	// a ring, indexed by event number
+	size_t eventCount;
+
 	unsigned int getGameMills();
+	void addEvent(GameEvent::Type type, size_t missile, Vector3 position);
+	void removeShell(size_t index);
 
 public:
 	Mesh island;
 	Fortress fortress;
-	std::vector<Shell> shells;
+	std::vector<Shell> shells;	// unordered, and never grown past shellCapacity
+	size_t shellCapacity;
 	std::vector<Ship> ships;
 	std::vector<Missile> missiles;
+	std::vector<MissileProfile> missileProfiles;	// parallel to missiles
 	unsigned int score;
 
+	// the most recent things to have happened this game, numbered in order
+	// from zero; since the state, logic and drawing all update at their own
+	// rates, each reader keeps the number of the next event it wants rather
+	// than the events being cleared every update, and must start from
+	// getOldestEvent() if it has fallen further behind than eventCapacity
+	static const size_t eventCapacity = 1024;
+
+	size_t getEventCount() { return eventCount; }
+	size_t getOldestEvent() { return (eventCount > eventCapacity ? eventCount - eventCapacity : 0); }
+	const GameEvent& getEvent(size_t number) { return events[number % eventCapacity]; }
+
 	Vector3 shipMissileOrigin;
 	Vector3 turretOrigin;
 	Vector3 shellOrigin;
@@ -84,12 +151,24 @@ public:
 	bool binoculars;
 	float recoil; // > 1 = recoiling, > 0 = recovering, 0 = at rest
 	bool empIsCharging;
-	unsigned int lastStrikeTime;
 	bool isPaused;
 	unsigned int lastUpdateGameTime;
 	int gameTimeMargin;
 
-	GameState();
+	// dimensions taken from the model metadata, which must be looked up on
+	// the main thread since a state may be constructed on a worker
+	struct ModelMetrics {
+		Vector3 shipMissileOrigin;
+		Vector3 turretOrigin;
+		Vector3 shellOrigin;
+		float shellRadius;
+		float missileLength;
+		float missileRadius;
+	};
+
+	static ModelMetrics getModelMetrics();
+
+	GameState(const ModelMetrics& modelMetrics);
 	~GameState();
 
 	unsigned int execute(bool unScheduled = false);
@@ -0,0 +1,136 @@
+// MissileBenchmark.cpp
+// Dominicus
+
+#include "state/MissileBenchmark.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdint.h>
+#include <vector>
+
+#include "core/GameSystem.h"
+#include "math/ScalarMath.h"
+#include "math/VectorMath.h"
+#include "platform/Platform.h"
+
+extern GameSystem* gameSystem;
+extern Platform* platform;
+
+// MissileProfile::evaluate() has to land on exactly what this gives: the
+// original path math, which worked out the turn phases again from the launch
+// point for every missile on every update
+static bool evaluateMissileFlightDirectly(float distanceTraveled, Vector3 fortressPosition, Missile& missile) {
+	if(distanceTraveled <= fortressPosition.y) {
+		missile.position.y = distanceTraveled;
+
+		return true;
+	}
+
+	float lateralDistanceTofortress = distance(missile.originPosition, Vector3(fortressPosition.x, 0.0f, fortressPosition.y));
+	static float phaseSplitFactor = 1.0f + cos(radians(45.0f)) * 1.0f / (1.0f - sin(radians(45.0f)));
+	float initialTurnPhaseLatDist = 1.0f / phaseSplitFactor * lateralDistanceTofortress;
+	float finalTurnPhaseRadius = 1.0f / (1.0f - (sin(radians(45.0f)))) * initialTurnPhaseLatDist;
+	float distanceTraveledIntoTurnPhases = distanceTraveled - fortressPosition.y;
+
+	if(distanceTraveledIntoTurnPhases < 0.5f * initialTurnPhaseLatDist * PI) {
+		float completionFactor = (distanceTraveledIntoTurnPhases / (0.5f * initialTurnPhaseLatDist * PI));
+
+		missile.position = Vector3(
+				missile.originPosition.x + (1.0f / (phaseSplitFactor)) * (fortressPosition.x - missile.originPosition.x) * (1.0f - cos(radians(completionFactor * 90.0f))),
+				fortressPosition.y + sin(radians(completionFactor * 90.0f)) * initialTurnPhaseLatDist,
+				missile.originPosition.z + (1.0f / (phaseSplitFactor)) * (fortressPosition.z - missile.originPosition.z) * (1.0f - cos(radians(completionFactor * 90.0f)))
+			);
+		missile.tilt = (1.0f - completionFactor) * 90.0f;
+
+		return true;
+	} else if(distanceTraveledIntoTurnPhases < 0.5f * initialTurnPhaseLatDist * PI + 0.25f * finalTurnPhaseRadius * PI) {
+		float completionFactor = (distanceTraveledIntoTurnPhases - 0.5f * initialTurnPhaseLatDist * PI) / (0.25f * finalTurnPhaseRadius * PI);
+
+		missile.position = Vector3(
+				missile.originPosition.x + (1.0f / (phaseSplitFactor)) * (fortressPosition.x - missile.originPosition.x) +
+						((phaseSplitFactor - 1.0f) / phaseSplitFactor) * (fortressPosition.x - missile.originPosition.x) * sin(radians(completionFactor * 45.0f)) / sin(radians(45.0f)),
+				fortressPosition.y + initialTurnPhaseLatDist * (cos(radians(completionFactor * 45.0f)) - cos(radians(45.0f))) / (cos(radians(0.0f)) - cos(radians(45.0f))),
+				missile.originPosition.z + (1.0f / (phaseSplitFactor)) * (fortressPosition.z - missile.originPosition.z) +
+						((phaseSplitFactor - 1.0f) / phaseSplitFactor) * (fortressPosition.z - missile.originPosition.z) * sin(radians(completionFactor * 45.0f)) / sin(radians(45.0f))
+			);
+		missile.tilt = 0.0f - completionFactor * 45.0f;
+
+		return true;
+	}
+
+	return false;
+}
+
+void benchmarkMissiles(const GameState& state, size_t missileCount) {
+	// launch a fixed spread of missiles from around the ship orbit, then
+	// follow every one through its whole flight both ways
+	const unsigned int stepCount = 1000;
+	float orbitDistance = gameSystem->getFloat("islandMaximumWidth") * 0.5f + gameSystem->getFloat("stateShipOrbitMargin");
+	unsigned int seed = 1;
+
+	std::vector<Missile> directMissiles(missileCount);
+
+	for(size_t i = 0; i < missileCount; ++i) {
+		float angle = (float) rand_r(&seed) / (float) RAND_MAX * 360.0f;
+		float range = orbitDistance + (float) rand_r(&seed) / (float) RAND_MAX * gameSystem->getFloat("stateShipMargin") * 8.0f;
+
+		directMissiles[i].originPosition = Vector3(cos(radians(angle)) * range, 0.0f, sin(radians(angle)) * range);
+		directMissiles[i].position = directMissiles[i].originPosition;
+		directMissiles[i].tilt = 90.0f;
+	}
+
+	std::vector<Missile> profiledMissiles(directMissiles);
+
+	uint64_t startTime = platform->getExecNanos();
+
+	std::vector<MissileProfile> profiles(missileCount);
+	for(size_t i = 0; i < missileCount; ++i)
+		profiles[i] = MissileProfile(profiledMissiles[i].originPosition, state.fortress.position);
+
+	uint64_t profileNanos = platform->getExecNanos() - startTime;
+
+	// the longest flight sets the distances the steps cover
+	double longestFlight = 0.0;
+	for(size_t i = 0; i < missileCount; ++i)
+		if(profiles[i].climbEnd + profiles[i].finalTurnEnd > longestFlight)
+			longestFlight = profiles[i].climbEnd + profiles[i].finalTurnEnd;
+
+	uint64_t directNanos = 0, profiledNanos = 0;
+	size_t mismatches = 0, flying = 0;
+
+	for(unsigned int step = 0; step <= stepCount; ++step) {
+		float distanceTraveled = (float) (longestFlight * step / stepCount);
+
+		startTime = platform->getExecNanos();
+		for(size_t i = 0; i < missileCount; ++i)
+			evaluateMissileFlightDirectly(distanceTraveled, state.fortress.position, directMissiles[i]);
+		directNanos += platform->getExecNanos() - startTime;
+
+		startTime = platform->getExecNanos();
+		for(size_t i = 0; i < missileCount; ++i)
+			flying += (profiles[i].evaluate(distanceTraveled, profiledMissiles[i]) ? 1 : 0);
+		profiledNanos += platform->getExecNanos() - startTime;
+
+		for(size_t i = 0; i < missileCount; ++i)
+			if(
+					directMissiles[i].position != profiledMissiles[i].position ||
+					directMissiles[i].tilt != profiledMissiles[i].tilt
+				)
+				++mismatches;
+	}
+
+	std::stringstream logMessage;
+	logMessage.precision(4);
+	logMessage <<
+			"Missile benchmark: " << missileCount << " missiles over " << stepCount + 1 << " updates (" <<
+			(double) flying / (stepCount + 1) << " in flight on average), " <<
+			(double) profileNanos / 1000000.0 << " ms building profiles, " <<
+			(double) directNanos / 1000000.0 / (stepCount + 1) << " ms per update computed directly, " <<
+			(double) profiledNanos / 1000000.0 / (stepCount + 1) << " ms per update from profiles, " <<
+			mismatches << " mismatched positions or tilts.";
+
+	// the log is only shown in the game, so report results directly too
+	gameSystem->log(GameSystem::LOG_INFO, logMessage.str());
+	Platform::consoleOut(logMessage.str() + "\n");
+}
@@ -0,0 +1,16 @@
+// MissileBenchmark.h
+// Dominicus
+
+#ifndef MISSILEBENCHMARK_H
+#define MISSILEBENCHMARK_H
+
+#include <cstdlib>
+
+#include "state/GameState.h"
+
+// follows missiles through their whole flight toward the state's fortress,
+// both from profiles and as the flight was computed before them, and
+// reports both along with any mismatch between their results
+void benchmarkMissiles(const GameState& state, size_t missileCount);
+
+#endif // MISSILEBENCHMARK_H